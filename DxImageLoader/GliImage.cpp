@@ -1,14 +1,22 @@
 #include "pch.h"
 #include "GliImage.h"
 #include "compress_interface.h"
-#include "interface.h"
+#include "operation_context.h"
+#include "trace.h"
+#include "format_convert.h"
+#include "thread_pool.h"
 #include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 
 bool is_grayscale(gli::format f);
 
-// mofified copy of gli convert
+// mofified copy of gli convert. Common format pairs are converted row by row with the specialized kernels of FormatConverter.
+// Blocks of rows of all subresources are converted in parallel on the shared thread pool
+// channels rearranges RGBA results in the same pass (only supported by the specialized kernels)
 template <typename texture_type>
-inline texture_type convert_mod(texture_type const& Texture, gli::format Format)
+inline texture_type convert_mod(texture_type const& Texture, gli::format Format, const std::array<int, 4>& channels, OperationContext& ctx)
 {
 	typedef float T;
 	typedef typename gli::texture::extent_type extent_type;
@@ -26,59 +34,97 @@ inline texture_type convert_mod(texture_type const& Texture, gli::format Format)
 	//const auto toNormalized = gli::is_normalized(Format);
     //const auto toInteger = gli::is_integer(Format) || gli::is_scaled(Format); // clamp these values to prevent overflow
 
-	auto [minClamp, maxClamp] = gli::min_max_values(Format);
+	auto [minValues, maxValues] = gli::min_max_values(Format);
+	// structured bindings cannot be captured by the lambda below
+	const auto minClamp = minValues;
+	const auto maxClamp = maxValues;
 
 	assert(!isCompressed); // this should be done by compressonator
 
 	fetch_type Fetch = gli::detail::convert<texture_type, T, gli::defaultp>::call(Texture.format()).Fetch;
 	write_type Write = gli::detail::convert<texture_type, T, gli::defaultp>::call(Format).Write;
+	const image::FormatConverter converter(Texture.format(), Format, channels);
+	if (!converter.isSupported() && channels != std::array<int, 4>{ 0, 1, 2, 3 })
+		throw std::runtime_error("convert_mod: channel shuffle is not supported for this format pair");
 
 	gli::texture Storage(Texture.target(), Format, Texture.texture::extent(), Texture.layers(), Texture.faces(), Texture.levels(), Texture.swizzles());
 	texture_type Copy(Storage);
 
 	extent_type const& baseDim = Texture.texture::extent(0);
-	// divide by 100 for range [0, 100]
-	const size_t numSteps = std::max<size_t>(image::IImage::calcNumPixels(uint32_t(Texture.layers() * Texture.faces()), uint32_t(Texture.levels()), baseDim.x, baseDim.y, baseDim.z) / 100, 1);
-	size_t curSteps = 0;
+	ctx.beginWork(image::IImage::calcNumPixels(uint32_t(Texture.layers() * Texture.faces()), uint32_t(Texture.levels()), baseDim.x, baseDim.y, baseDim.z));
 
+	// independent blocks of rows (row = y + z * height). Each block is written by one thread => same output for any number of threads
+	struct Job
+	{
+		size_type layer, face, level;
+		component_type firstRow, numRows;
+	};
+	constexpr component_type jobPixels = 1 << 16;
+	std::vector<Job> jobs;
 	for (size_type Layer = 0; Layer < Texture.layers(); ++Layer)
 		for (size_type Face = 0; Face < Texture.faces(); ++Face)
 			for (size_type Level = 0; Level < Texture.levels(); ++Level)
 			{
 				extent_type const& Dimensions = Texture.texture::extent(Level);
+				const component_type numRows = Dimensions.y * Dimensions.z;
+				const component_type rowsPerJob = std::max<component_type>(1, jobPixels / Dimensions.x);
+				for (component_type row = 0; row < numRows; row += rowsPerJob)
+					jobs.push_back({ Layer, Face, Level, row, std::min(rowsPerJob, numRows - row) });
+			}
+
+	ThreadPool::get().parallelFor(jobs.size(), [&](size_t jobIndex)
+	{
+		const Job& job = jobs[jobIndex];
+		trace::Scope scope("convert", int(job.layer * Texture.faces() + job.face), int(job.level));
+		extent_type const& Dimensions = Texture.texture::extent(job.level);
+
+		if (converter.isSupported())
+		{
+			// rows are tightly packed
+			const auto srcRowSize = size_t(Dimensions.x) * gli::block_size(Texture.format());
+			const auto dstRowSize = size_t(Dimensions.x) * gli::block_size(Format);
+			auto src = static_cast<const uint8_t*>(static_cast<const gli::texture&>(Texture).data(job.layer, job.face, job.level)) + job.firstRow * srcRowSize;
+			auto dst = static_cast<uint8_t*>(Storage.data(job.layer, job.face, job.level)) + job.firstRow * dstRowSize;
+			for (component_type row = 0; row < job.numRows; ++row, src += srcRowSize, dst += dstRowSize)
+			{
+				converter.convert(src, dst, size_t(Dimensions.x));
+				ctx.addWork(Dimensions.x);
+			}
+			return;
+		}
+
+		for (component_type row = job.firstRow; row < job.firstRow + job.numRows; ++row)
+		{
+			const component_type j = row % Dimensions.y;
+			const component_type k = row / Dimensions.y;
+			for (component_type i = 0; i < Dimensions.x; ++i)
+			{
+				typename texture_type::extent_type const Texelcoord(extent_type(i, j, k));
+				auto texel = Fetch(Texture, Texelcoord, job.layer, job.face, job.level);
 
-				for (component_type k = 0; k < Dimensions.z; ++k)
-					for (component_type j = 0; j < Dimensions.y; ++j)
-					{
-						set_progress(uint32_t(curSteps / numSteps));
-
-						for (component_type i = 0; i < Dimensions.x; ++i)
-						{
-							typename texture_type::extent_type const Texelcoord(extent_type(i, j, k));
-							auto texel = Fetch(Texture, Texelcoord, Layer, Face, Level);
-
-                            texel = gli::clamp(texel, minClamp, maxClamp);
-
-							Write(
-								Copy, Texelcoord, Layer, Face, Level,
-								texel);
-						}
-						curSteps += Dimensions.x;
-					}
-						
+				texel = gli::clamp(texel, minClamp, maxClamp);
+
+				Write(
+					Copy, Texelcoord, job.layer, job.face, job.level,
+					texel);
 			}
+			ctx.addWork(Dimensions.x);
+		}
+	});
 
 	return texture_type(Copy);
 }
 
 bool GliImageBase::requiresGrayscalePostprocess()
 {
+	if (m_postprocessed) return false;
 	// neither compressonator nor gli load grayscale correctly (only red channel filled)
 	return is_grayscale(getOriginalFormat());
 }
 
 bool GliImageBase::requiresBGRPostprocess()
 {
+	if (m_postprocessed) return false;
 	// compressonator already handles this
 	if (is_compressonator_format(m_base.format())) return false;
 
@@ -123,21 +169,67 @@ GliImage::GliImage(const gli::texture& tex)
 	: GliImage(tex, tex.format())
 {}
 
-std::unique_ptr<GliImage> GliImage::convert(gli::format format, int quality)
+std::unique_ptr<GliImage> GliImage::convert(gli::format format, int quality, OperationContext& ctx) const
 {
 	if(is_compressonator_format(format) || is_compressonator_format(m_base.format())) // convert to compressed format
 	{
 		// compressed format, use compressonator to compress
 		auto dst = std::make_unique<GliImage>(format, m_original, m_base.layers(), m_base.faces(), m_base.levels(), m_base.extent().x, m_base.extent().y, m_base.extent().z);
-		compressonator_convert_image(*this, *dst, quality);
+		compressonator_convert_image(*this, *dst, quality, ctx);
 		return dst;
 	}
-	else // uncompressed format => use gli convert method
+	// uncompressed format => use gli convert method
+	return convertUncompressed(format, { 0, 1, 2, 3 }, ctx);
+}
+
+std::unique_ptr<GliImage> GliImage::convertToSupported(OperationContext& ctx)
+{
+	const auto format = image::getSupportedFormat(m_base.format());
+	const auto channels = getPostprocessChannels();
+	if (channels == std::array<int, 4>{ 0, 1, 2, 3 } || !image::FormatConverter(m_base.format(), format, channels).isSupported())
+		return convert(format, 100, ctx); // separate postprocess pass
+
+	auto res = convertUncompressed(format, channels, ctx);
+	res->m_postprocessed = true;
+	return res;
+}
+
+std::unique_ptr<GliImage> GliImage::convertUncompressed(gli::format format, const std::array<int, 4>& channels, OperationContext& ctx) const
+{
+	trace::Scope scope("GliImage::convert");
+	StageTimer timer(ctx.getStats(), Stage::Convert);
+	timer.add(getNumPixels(), m_base.size(), getNumPixels() * gli::block_size(format));
+	if (m_type == Cubes) return std::make_unique<GliImage>(convert_mod(m_cube, format, channels, ctx), m_original);
+	if (m_type == Volume) return std::make_unique<GliImage>(convert_mod(m_volume, format, channels, ctx), m_original);
+	return std::make_unique<GliImage>(convert_mod(m_array, format, channels, ctx), m_original);
+}
+
+std::unique_ptr<GliImage> GliImage::duplicate() const
+{
+	return std::make_unique<GliImage>(gli::duplicate(m_base), m_original);
+}
+
+std::unique_ptr<GliImage> GliImage::copyOf(const image::IImage& image)
+{
+	const auto numLayers = image.getNumLayers();
+	const bool isCube = numLayers == 6 && image.getWidth(0) == image.getHeight(0) && image.getDepth(0) == 1;
+	auto res = std::make_unique<GliImage>(image.getFormat(), image.getOriginalFormat(), isCube ? 1 : numLayers, isCube ? 6 : 1,
+		image.getNumMipmaps(), image.getWidth(0), image.getHeight(0), image.getDepth(0));
+
+	// layers are ordered like the faces of the gli layers (see GliImageBase::getData)
+	for (uint32_t layer = 0; layer < numLayers; ++layer)
 	{
-		if (m_type == Cubes) return std::make_unique<GliImage>(convert_mod(m_cube, format), m_original);
-		if (m_type == Volume) return std::make_unique<GliImage>(convert_mod(m_volume, format), m_original);
-		return std::make_unique<GliImage>(convert_mod(m_array, format), m_original);
+		for (uint32_t mipmap = 0; mipmap < image.getNumMipmaps(); ++mipmap)
+		{
+			size_t srcSize, dstSize;
+			const uint8_t* src = image.getData(layer, mipmap, srcSize);
+			uint8_t* dst = res->getData(layer, mipmap, dstSize);
+			if (srcSize != dstSize)
+				throw std::runtime_error("image data size does not match the gli texture size");
+			std::memcpy(dst, src, dstSize);
+		}
 	}
+	return res;
 }
 
 void GliImage::saveKtx(const char* filename) const
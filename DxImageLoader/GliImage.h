@@ -1,8 +1,10 @@
 #pragma once
-#include <memory>
+#include <memory>
 #include "Image.h"
 #include <gli/gli.hpp>
 
+class OperationContext;
+
 class GliImageBase : public image::IImage
 {
 protected:
@@ -31,6 +33,8 @@ public:
 		return const_cast<GliImageBase*>(this)->getData(layer, mipmap, size);
 	}
 
+	size_t getMemorySize() const override { return m_base.size(); }
+
 	uint8_t* getData() { return reinterpret_cast<uint8_t*>(m_base.data()); }
 	uint32_t getSize() { return uint32_t(m_base.size()); }
 
@@ -42,6 +46,8 @@ public:
 protected:
 	gli::texture& m_base;
 	gli::format m_original;
+	// the postprocess was applied during the format conversion
+	bool m_postprocessed = false;
 };
 
 class GliImage final : public GliImageBase
@@ -52,12 +58,20 @@ public:
 	GliImage(gli::format format, gli::format original, size_t nLayer, size_t nFaces, size_t nLevel, size_t width, size_t height, size_t depth);
 	GliImage(const gli::texture& tex, gli::format original);
 
-	std::unique_ptr<GliImage> convert(gli::format format, int quality);
+	std::unique_ptr<GliImage> convert(gli::format format, int quality, OperationContext& ctx) const;
+	// converts to image::getSupportedFormat and applies the grayscale and BGR postprocess in the same pass if the format pair has a specialized kernel
+	std::unique_ptr<GliImage> convertToSupported(OperationContext& ctx);
+	// deep copy of the image data
+	std::unique_ptr<GliImage> duplicate() const;
+	// deep copy of an image of another loader (e.g. for the gli and ktx exporters). 6 square layers become a cube map
+	static std::unique_ptr<GliImage> copyOf(const image::IImage& image);
 	void saveKtx(const char* filename) const;
 	void saveDds(const char* filename) const;
 	void flip();
 
 private:
+	// conversion of uncompressed formats with convert_mod. channels rearranges RGBA results (see image::FormatConverter)
+	std::unique_ptr<GliImage> convertUncompressed(gli::format format, const std::array<int, 4>& channels, OperationContext& ctx) const;
 	// helper to choose the correct internal format. This is later required for format conversions
 	gli::texture& initTex(size_t nFaces, gli::extent3d size);
 
@@ -1,7 +1,10 @@
 #include "pch.h"
 #include "Image.h"
 #include "convert.h"
+#include "interface.h"
 #include <algorithm>
+#include <stdexcept>
+#include <cstring>
 
 size_t image::IImage::calcNumPixels(uint32_t numLayer, uint32_t numLevels, uint32_t width, uint32_t height,
 	uint32_t depth)
@@ -24,32 +27,353 @@ size_t image::IImage::getNumPixels() const
 	return calcNumPixels(getNumLayers(), getNumMipmaps(), getWidth(0), getHeight(0), getDepth(0));
 }
 
+size_t image::IImage::getMemorySize() const
+{
+	if (!isStagingFormat(getFormat())) return 0;
+	return getNumPixels() * pixelSize(getFormat());
+}
+
 void image::IImage::applyBGRPostprocess()
 {
-	assert(isSupported(getFormat()));
+	assert(isStagingFormat(getFormat()));
+	for (uint32_t layer = 0; layer < getNumLayers(); ++layer)
+		for (uint32_t mip = 0; mip < getNumMipmaps(); ++mip)
+		{
+			size_t size;
+			auto data = getData(layer, mip, size);
+			switch (pixelSize(getFormat()))
+			{
+			case 16: image::swizzleBGRA<4>(data, size); break;
+			case 8: image::swizzleBGRA<2>(data, size); break;
+			default: image::swizzleBGRA<1>(data, size); break;
+			}
+		}
+}
+
+std::array<int, 4> image::IImage::getPostprocessChannels()
+{
+	std::array<int, 4> channels = { 0, 1, 2, 3 };
+	if (requiresBGRPostprocess()) channels = { 2, 1, 0, 3 };
+	// red is copied to green and blue before the swap => the swap has no effect
+	if (requiresGrayscalePostprocess()) channels = { 0, 0, 0, 3 };
+	return channels;
+}
+
+void image::IImage::applyPostprocess()
+{
+	const auto channels = getPostprocessChannels();
+	if (channels == std::array<int, 4>{ 0, 1, 2, 3 }) return;
+
+	assert(isStagingFormat(getFormat()));
 	for (uint32_t layer = 0; layer < getNumLayers(); ++layer)
 		for (uint32_t mip = 0; mip < getNumMipmaps(); ++mip)
 		{
 			size_t size;
 			auto data = getData(layer, mip, size);
-			if (getFormat() == gli::FORMAT_RGBA32_SFLOAT_PACK32)
-				image::swizzleBGRA<4>(data, size);
-			else image::swizzleBGRA<1>(data, size);
+			image::shuffleRGBA(data, size, pixelSize(getFormat()) / 4, channels);
 		}
 }
 
 image::SimpleImage::SimpleImage(gli::format originalFormat, gli::format internalFormat, uint32_t width, uint32_t height,
 	uint32_t pixelByteSize)
 	:
-m_width(width), m_height(height), m_original(originalFormat), m_format(internalFormat)
+m_width(width), m_height(height), m_data(size_t(width) * size_t(height) * size_t(pixelByteSize)),
+m_original(originalFormat), m_format(internalFormat)
+{
+}
+
+image::PooledImage::PooledImage(gli::format format, uint32_t width, uint32_t height, uint32_t depth, uint32_t numLayers,
+	uint32_t numMipmaps)
+	:
+m_width(width), m_height(height), m_depth(depth), m_numLayers(numLayers), m_numMipmaps(numMipmaps), m_format(format)
+{
+	assert(isStagingFormat(format));
+	m_data.reserve(size_t(numLayers) * numMipmaps);
+	for (uint32_t layer = 0; layer < numLayers; ++layer)
+		for (uint32_t mip = 0; mip < numMipmaps; ++mip)
+			m_data.emplace_back(size_t(getWidth(mip)) * size_t(getHeight(mip)) * size_t(getDepth(mip)) * pixelSize(format));
+}
+
+uint32_t image::PooledImage::getWidth(uint32_t mipmap) const
+{
+	return std::max(1u, m_width >> mipmap);
+}
+
+uint32_t image::PooledImage::getHeight(uint32_t mipmap) const
+{
+	return std::max(1u, m_height >> mipmap);
+}
+
+uint32_t image::PooledImage::getDepth(uint32_t mipmap) const
+{
+	return std::max(1u, m_depth >> mipmap);
+}
+
+uint32_t image::channelCount(ChannelLayout layout)
+{
+	switch (layout)
+	{
+	case ChannelLayout::Gray: return 1;
+	case ChannelLayout::GrayAlpha: return 2;
+	case ChannelLayout::RG: return 2;
+	case ChannelLayout::RGB: return 3;
+	case ChannelLayout::RGBA: return 4;
+	}
+	assert(false);
+	return 0;
+}
+
+static uint32_t channelSize(image::ChannelType type)
+{
+	switch (type)
+	{
+	case image::ChannelType::Unorm8: return 1;
+	case image::ChannelType::Unorm16: return 2;
+	case image::ChannelType::Float32: return 4;
+	}
+	assert(false);
+	return 0;
+}
+
+image::CompactImage::CompactImage(gli::format originalFormat, gli::format stagingFormat, ChannelType type,
+	ChannelLayout layout, uint32_t width, uint32_t height, uint32_t depth, uint32_t numLayers)
+	:
+m_width(width), m_height(height), m_depth(depth), m_numLayers(numLayers), m_type(type), m_layout(layout),
+m_compactPixelSize(channelCount(layout) * channelSize(type)), m_original(originalFormat), m_format(stagingFormat),
+m_compact(size_t(width) * size_t(height) * size_t(depth) * size_t(numLayers) * m_compactPixelSize),
+m_staging(numLayers)
+{
+	assert(isStagingFormat(stagingFormat));
+	assert((type == ChannelType::Unorm8) == (pixelSize(stagingFormat) == 4));
+}
+
+// writes count pixels of the layout as RGBA. convert is applied to each stored value
+template<class TSrc, class TDst, class TConvert>
+static void expandToRGBA(const uint8_t* compact, uint8_t* staging, size_t count, image::ChannelLayout layout, TDst one, TConvert convert)
+{
+	auto src = reinterpret_cast<const TSrc*>(compact);
+	auto dst = reinterpret_cast<TDst*>(staging);
+	const auto end = dst + count * 4;
+	switch (layout)
+	{
+	case image::ChannelLayout::Gray:
+		for (; dst != end; dst += 4, src += 1)
+		{
+			dst[0] = dst[1] = dst[2] = convert(src[0]);
+			dst[3] = one;
+		}
+		break;
+	case image::ChannelLayout::GrayAlpha:
+		for (; dst != end; dst += 4, src += 2)
+		{
+			dst[0] = dst[1] = dst[2] = convert(src[0]);
+			dst[3] = convert(src[1]);
+		}
+		break;
+	case image::ChannelLayout::RG:
+		for (; dst != end; dst += 4, src += 2)
+		{
+			dst[0] = convert(src[0]);
+			dst[1] = convert(src[1]);
+			dst[2] = TDst(0);
+			dst[3] = one;
+		}
+		break;
+	case image::ChannelLayout::RGB:
+		for (; dst != end; dst += 4, src += 3)
+		{
+			dst[0] = convert(src[0]);
+			dst[1] = convert(src[1]);
+			dst[2] = convert(src[2]);
+			dst[3] = one;
+		}
+		break;
+	case image::ChannelLayout::RGBA:
+		for (; dst != end; dst += 4, src += 4)
+		{
+			dst[0] = convert(src[0]);
+			dst[1] = convert(src[1]);
+			dst[2] = convert(src[2]);
+			dst[3] = convert(src[3]);
+		}
+		break;
+	}
+}
+
+// same as expandToRGBA for unorm8 values with byte shuffles (see convert.h)
+static void expandUnorm8ToRGBA(const uint8_t* compact, uint8_t* staging, size_t count, image::ChannelLayout layout)
+{
+	const uint8_t constants[4] = { 0, 0, 0, 255 };
+	switch (layout)
+	{
+	case image::ChannelLayout::Gray: image::copyToRGBA(compact, staging, count, 1, 1, { 0, 0, 0, -1 }, constants); break;
+	case image::ChannelLayout::GrayAlpha: image::copyToRGBA(compact, staging, count, 1, 2, { 0, 0, 0, 1 }, constants); break;
+	case image::ChannelLayout::RG: image::copyToRGBA(compact, staging, count, 1, 2, { 0, 1, -1, -1 }, constants); break;
+	case image::ChannelLayout::RGB: image::copyToRGBA(compact, staging, count, 1, 3, { 0, 1, 2, -1 }, constants); break;
+	case image::ChannelLayout::RGBA: memcpy(staging, compact, count * 4); break;
+	}
+}
+
+void image::CompactImage::expand(const uint8_t* src, uint8_t* dst, size_t count) const
+{
+	switch (m_type)
+	{
+	case ChannelType::Unorm8:
+		if (useSimd())
+			expandUnorm8ToRGBA(src, dst, count, m_layout);
+		else
+			expandToRGBA<uint8_t, uint8_t>(src, dst, count, m_layout, uint8_t(255),
+				[](uint8_t v) { return v; });
+		break;
+	case ChannelType::Unorm16:
+		expandToRGBA<uint16_t, float>(src, dst, count, m_layout, 1.0f,
+			[](uint16_t v) { return float(v) * (1.0f / 65535.0f); });
+		break;
+	case ChannelType::Float32:
+		expandToRGBA<float, float>(src, dst, count, m_layout, 1.0f,
+			[](float v) { return v; });
+		break;
+	}
+}
+
+void image::CompactImage::setStagingFormat(gli::format format)
+{
+	assert(m_type != ChannelType::Unorm8);
+	assert(format == gli::FORMAT_RGBA32_SFLOAT_PACK32 || format == gli::FORMAT_RGBA16_SFLOAT_PACK16);
+	std::lock_guard<std::mutex> lock(m_stagingMutex);
+	assert(std::all_of(m_staging.begin(), m_staging.end(), [](const auto& s) { return s.empty(); }));
+	m_format = format;
+}
+
+size_t image::CompactImage::getMemorySize() const
+{
+	std::lock_guard<std::mutex> lock(m_stagingMutex);
+	size_t size = m_compact.size();
+	for (const auto& staging : m_staging)
+		size += staging.size();
+	return size;
+}
+
+size_t image::CompactImage::releaseCaches()
+{
+	std::lock_guard<std::mutex> lock(m_stagingMutex);
+	size_t released = 0;
+	for (auto& staging : m_staging)
+	{
+		released += staging.size();
+		staging.reset();
+	}
+	return released;
+}
+
+void image::CompactImage::setPinned(bool pinned)
+{
+	std::lock_guard<std::mutex> lock(m_stagingMutex);
+	m_pinned = pinned;
+	if (pinned) return;
+	// the layers were copied (or uploaded) by the owner of the pin
+	for (auto& staging : m_staging)
+		staging.reset();
+}
+
+// the pointer stays valid until another layer is requested or until the image is unpinned if it was requested while pinned
+const uint8_t* image::CompactImage::getData(uint32_t layer, uint32_t mipmap, size_t& size) const
+{
+	assert(layer < m_numLayers);
+	assert(mipmap == 0);
+	const size_t numPixels = size_t(m_width) * size_t(m_height) * size_t(m_depth);
+
+	std::lock_guard<std::mutex> lock(m_stagingMutex);
+	if (!m_pinned)
+		for (uint32_t i = 0; i < m_numLayers; ++i)
+			if (i != layer) m_staging[i].reset();
+
+	auto& staging = m_staging[layer];
+	if (staging.empty())
+	{
+		staging = PixelBuffer(numPixels * pixelSize(m_format));
+		const uint8_t* src = m_compact.data() + numPixels * m_compactPixelSize * layer;
+		if (m_format == gli::FORMAT_RGBA16_SFLOAT_PACK16)
+		{
+			// expand blocks of pixels to float and convert them to half
+			const size_t blockSize = 4096;
+			std::vector<float> block(blockSize * 4);
+			auto dst = reinterpret_cast<uint16_t*>(staging.data());
+			for (size_t first = 0; first < numPixels; first += blockSize)
+			{
+				const size_t count = std::min(blockSize, numPixels - first);
+				expand(src + first * m_compactPixelSize, reinterpret_cast<uint8_t*>(block.data()), count);
+				floatToHalf(block.data(), dst + first * 4, count * 4);
+			}
+		}
+		else expand(src, staging.data(), numPixels);
+	}
+
+	size = staging.size();
+	return staging.data();
+}
+
+uint8_t* image::CompactImage::getData(uint32_t layer, uint32_t mipmap, size_t& size)
+{
+	return const_cast<uint8_t*>(static_cast<const CompactImage*>(this)->getData(layer, mipmap, size));
+}
+
+void image::checkRegion(const Region& region, uint32_t numLayers, uint32_t numMipmaps, uint32_t width, uint32_t height)
 {
-	m_data.resize(size_t(width) * size_t(height) * size_t(pixelByteSize));
+	if (region.layer >= numLayers)
+		throw std::runtime_error("region layer is out of range");
+	if (region.mipmap >= numMipmaps)
+		throw std::runtime_error("region mipmap is out of range");
+	if (region.width == 0 || region.height == 0)
+		throw std::runtime_error("region is empty");
+	if (region.x >= width || region.width > width - region.x ||
+		region.y >= height || region.height > height - region.y)
+		throw std::runtime_error("region is outside of the image");
+}
+
+std::unique_ptr<image::IImage> image::extractRegion(const IImage& image, const Region& region)
+{
+	assert(isStagingFormat(image.getFormat()));
+	checkRegion(region, image.getNumLayers(), image.getNumMipmaps(), image.getWidth(region.mipmap), image.getHeight(region.mipmap));
+	if (image.getDepth(region.mipmap) != 1)
+		throw std::runtime_error("expected 2D texture (depth = 1)");
+
+	const uint32_t pixelByteSize = pixelSize(image.getFormat());
+	auto res = std::make_unique<SimpleImage>(image.getOriginalFormat(), image.getFormat(), region.width, region.height, pixelByteSize);
+
+	size_t srcSize, dstSize;
+	const uint8_t* src = image.getData(region.layer, region.mipmap, srcSize);
+	uint8_t* dst = res->getData(0, 0, dstSize);
+
+	const size_t srcStride = size_t(image.getWidth(region.mipmap)) * pixelByteSize;
+	const size_t dstStride = size_t(region.width) * pixelByteSize;
+	src += size_t(region.y) * srcStride + size_t(region.x) * pixelByteSize;
+	for (uint32_t y = 0; y < region.height; ++y)
+	{
+		memcpy(dst, src, dstStride);
+		src += srcStride;
+		dst += dstStride;
+	}
+
+	return res;
+}
+
+bool image::isSupported(gli::format format)
+{
+	if (format == gli::format::FORMAT_RGBA16_SFLOAT_PACK16)
+		return get_global_parameter_i("staging half", 0) != 0;
+	return isStagingFormat(format);
 }
 
 uint32_t image::pixelSize(gli::format format)
 {
-	assert(isSupported(format));
-	return format == gli::format::FORMAT_RGBA32_SFLOAT_PACK32 ? 16 : 4;
+	assert(isStagingFormat(format));
+	switch (format)
+	{
+	case gli::format::FORMAT_RGBA32_SFLOAT_PACK32: return 16;
+	case gli::format::FORMAT_RGBA16_SFLOAT_PACK16: return 8;
+	default: return 4;
+	}
 }
 
 gli::format image::getSupportedFormat(gli::format format)
@@ -1,10 +1,36 @@
 #pragma once
 #include "Layer.h"
 #include "framework.h"
+#include "pixel_buffer.h"
 #include <cassert>
+#include <memory>
+#include <array>
+#include <mutex>
 
 namespace image
 {
+	// header information of an image file (see image_probe). Describes the image as it would be loaded
+	struct Info
+	{
+		gli::format originalFormat = gli::format::FORMAT_UNDEFINED;
+		uint32_t width = 1;
+		uint32_t height = 1;
+		uint32_t depth = 1;
+		uint32_t layers = 1;
+		uint32_t mipmaps = 1;
+	};
+
+	// rectangle of a single layer and mipmap (see image_open_region)
+	struct Region
+	{
+		uint32_t layer = 0;
+		uint32_t mipmap = 0;
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
 	// image interface
 	class IImage
 	{
@@ -16,7 +42,7 @@ namespace image
 		virtual uint32_t getHeight(uint32_t mipmap) const = 0;
 		virtual uint32_t getDepth(uint32_t mipmap) const = 0;
 		
-		// must fulfill isSupported(format)
+		// must fulfill isStagingFormat(format)
 		virtual gli::format getFormat() const = 0;
 		// the original format of the file
 		virtual gli::format getOriginalFormat() const = 0;
@@ -24,6 +50,19 @@ namespace image
 		virtual const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const = 0;
 		virtual float getFps() const { return 0.0f; } // average fps or 0 if no preference
 
+		// memory budget (see ImageStore)
+
+		// bytes of memory that are held by the image
+		virtual size_t getMemorySize() const;
+		// releases data that can be recreated on demand and returns the number of released bytes.
+		// Pointers that were returned by getData may become invalid
+		virtual size_t releaseCaches() { return 0; }
+		// if false, the image is never moved to the scratch file (only its caches are released)
+		virtual bool isSpillable() const { return true; }
+		// called when the first pin is set and when the last pin is removed (see ImageStore::setPinned).
+		// Pointers that were returned by getData while the image is pinned must stay valid until it is unpinned
+		virtual void setPinned(bool /*pinned*/) {}
+
 		// progress helper
 		static size_t calcNumPixels(uint32_t numLayer, uint32_t numLevels, uint32_t width, uint32_t height, uint32_t depth);
 		size_t getNumPixels() const;
@@ -37,9 +76,15 @@ namespace image
 		virtual bool requiresBGRPostprocess() { return false; }
 
 		void applyBGRPostprocess();
+
+		// grayscale and BGR postprocess as one channel shuffle: channel c of the result is channel channels[c] of the loaded image
+		std::array<int, 4> getPostprocessChannels();
+		// applies the grayscale and BGR postprocess in a single pass over the data
+		void applyPostprocess();
 	};
 
-	// default interface that supplies internal storage for a single m_layer/mipmap
+	// default interface that supplies internal storage for a single m_layer/mipmap.
+	// The storage is not initialized, the loader has to write every pixel
 	class SimpleImage final : public IImage
 	{
 	public:
@@ -66,12 +111,129 @@ namespace image
 	private:
 		uint32_t m_width;
 		uint32_t m_height;
-		std::vector<uint8_t> m_data;
+		PixelBuffer m_data;
+		gli::format m_original;
+		gli::format m_format;
+	};
+
+	// uninitialized layers and mipmaps from the pool of pixel buffers (see image_allocate)
+	class PooledImage final : public IImage
+	{
+	public:
+		// format must fulfill isStagingFormat(format)
+		PooledImage(gli::format format, uint32_t width, uint32_t height, uint32_t depth, uint32_t numLayers, uint32_t numMipmaps);
+
+		uint32_t getNumLayers() const override { return m_numLayers; }
+		uint32_t getNumMipmaps() const override { return m_numMipmaps; }
+		uint32_t getWidth(uint32_t mipmap) const override;
+		uint32_t getHeight(uint32_t mipmap) const override;
+		uint32_t getDepth(uint32_t mipmap) const override;
+		gli::format getFormat() const override { return m_format; }
+		gli::format getOriginalFormat() const override { return m_format; }
+		uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) override
+		{
+			auto& buffer = m_data[size_t(layer) * m_numMipmaps + mipmap];
+			size = buffer.size();
+			return buffer.data();
+		}
+		const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const override
+		{
+			return const_cast<PooledImage*>(this)->getData(layer, mipmap, size);
+		}
+
+	private:
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_depth;
+		uint32_t m_numLayers;
+		uint32_t m_numMipmaps;
+		gli::format m_format;
+		std::vector<PixelBuffer> m_data; // mipmaps of the first layer, then of the second layer...
+	};
+
+	// value type of the channels stored in a CompactImage
+	enum class ChannelType
+	{
+		Unorm8, // staged as RGBA8
+		Unorm16, // staged as RGBA32F
+		Float32 // staged as RGBA32F
+	};
+
+	// stored channels of a CompactImage and how they are expanded to RGBA
+	enum class ChannelLayout
+	{
+		Gray, // r => rrr1
+		GrayAlpha, // ra => rrra
+		RG, // rg => rg01
+		RGB, // rgb => rgb1
+		RGBA
+	};
+
+	uint32_t channelCount(ChannelLayout layout);
+
+	// keeps the pixels in the compact layout of the file (e.g. R16 instead of RGBA32F).
+	// getFormat() reports the staging format. A layer is converted to the staging format the first time
+	// its data is requested, the converted data stays valid until the image is destroyed.
+	class CompactImage final : public IImage
+	{
+	public:
+		// stagingFormat must be RGBA8 for Unorm8 and RGBA32F or RGBA16F otherwise
+		CompactImage(gli::format originalFormat, gli::format stagingFormat, ChannelType type, ChannelLayout layout,
+			uint32_t width, uint32_t height, uint32_t depth = 1, uint32_t numLayers = 1);
+
+		uint32_t getNumLayers() const override { return m_numLayers; }
+		uint32_t getNumMipmaps() const override { return 1; }
+		uint32_t getWidth(uint32_t mipmap) const override { return m_width; }
+		uint32_t getHeight(uint32_t mipmap) const override { return m_height; }
+		uint32_t getDepth(uint32_t mipmap) const override { return m_depth; }
+		gli::format getFormat() const override { return m_format; }
+		gli::format getOriginalFormat() const override { return m_original; }
+		uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) override;
+		const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const override;
+
+		// compact storage of all layers (layer after layer, channels interleaved). Loaders write the decoded values here.
+		// The storage is not initialized
+		uint8_t* getCompactData(size_t& size)
+		{
+			size = m_compact.size();
+			return m_compact.data();
+		}
+		// size of a single pixel in the compact storage
+		uint32_t getCompactPixelSize() const { return m_compactPixelSize; }
+
+		// changes the staging format between RGBA32F and RGBA16F. Only valid before the data was requested
+		void setStagingFormat(gli::format format);
+
+		size_t getMemorySize() const override;
+		// releases the converted layers
+		size_t releaseCaches() override;
+		// the compact data is smaller than the staged data that would be written to the scratch file
+		bool isSpillable() const override { return false; }
+		// the converted layers are only kept while the image is pinned (e.g. until they were uploaded)
+		void setPinned(bool pinned) override;
+
+	private:
+		// expands count compact pixels to RGBA8 or RGBA32F
+		void expand(const uint8_t* src, uint8_t* dst, size_t count) const;
+
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_depth;
+		uint32_t m_numLayers;
+		ChannelType m_type;
+		ChannelLayout m_layout;
+		uint32_t m_compactPixelSize;
 		gli::format m_original;
 		gli::format m_format;
+		PixelBuffer m_compact;
+		// converted layers, empty until requested. Unpinned images only keep the last requested layer
+		mutable std::vector<PixelBuffer> m_staging;
+		bool m_pinned = false; // guarded by m_stagingMutex
+		mutable std::mutex m_stagingMutex;
 	};
 
-	inline bool isSupported(gli::format format)
+	// formats of the image data
+	inline bool isStagingFormat(gli::format format)
 	{
 		switch (format)
 		{
@@ -79,12 +241,22 @@ namespace image
 		case gli::format::FORMAT_RGBA8_UNORM_PACK8:
 		case gli::format::FORMAT_RGBA8_SNORM_PACK8:
 		case gli::format::FORMAT_RGBA32_SFLOAT_PACK32:
+		case gli::format::FORMAT_RGBA16_SFLOAT_PACK16: // opt-in with "staging half"
 			return true;
 		}
 		return false;
 	}
 
+	// formats that the loaders keep without conversion (RGBA16F only while the global parameter "staging half" is set)
+	bool isSupported(gli::format format);
+
 	uint32_t pixelSize(gli::format format);
 
 	gli::format getSupportedFormat(gli::format format);
+
+	// throws if the region is empty or not inside an image with the given dimensions (width and height of region.mipmap)
+	void checkRegion(const Region& region, uint32_t numLayers, uint32_t numMipmaps, uint32_t width, uint32_t height);
+
+	// copies the region into a new single layer/mipmap image. image must have a supported format
+	std::unique_ptr<IImage> extractRegion(const IImage& image, const Region& region);
 }
@@ -1,10 +1,11 @@
 #include "pch.h"
 
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <string>
 
-#include "interface.h"
+#include "operation_context.h"
 #include "../dependencies/blue_noise/blue_noise_generator.h"
 #include "../dependencies/blue_noise/blue_noise_generator_parameters.h"
 
@@ -15,16 +16,17 @@
 class CBlueNoiseGenProgress : public IBlueNoiseGenProgressMonitor
 {
 public:
-	CBlueNoiseGenProgress(size_t totalNumIter) : numIterationsToFindDistribution(totalNumIter)
+	CBlueNoiseGenProgress(size_t totalNumIter, OperationContext& ctx) : numIterationsToFindDistribution(totalNumIter), ctx(ctx)
 	{}
 private:
 	size_t numIterationsToFindDistribution;
+	OperationContext& ctx;
 
 private:
 	virtual void OnProgress(size_t iterCount, double bestScore, size_t swapCount, size_t swapAttempt) override
 	{
 		uint32_t newPercent = uint32_t(double(iterCount) / (double(numIterationsToFindDistribution) / 100.0));
-		set_progress(newPercent);
+		ctx.setProgress(newPercent);
 	}
 	virtual void OnStartWhiteNoiseGeneration() override {}
 	virtual void OnStartBlueNoiseGeneration() override {}
@@ -36,7 +38,7 @@ private:
 class BlueNoiseImage final : public image::IImage
 {
 public:
-	BlueNoiseImage(int width, int height, int depth, int layer, int mipmaps)
+	BlueNoiseImage(int width, int height, int depth, int layer, int mipmaps, OperationContext& ctx)
 		: m_width(width)
 		, m_height(height)
 		, m_depth(depth)
@@ -61,7 +63,7 @@ public:
 
 		std::vector<float> whiteNoise;
 		std::vector<float> blueNoise;
-		CBlueNoiseGenProgress progress(params.numIterationsToFindDistribution);
+		CBlueNoiseGenProgress progress(params.numIterationsToFindDistribution, ctx);
 		BlueNoiseGenerator::EResult result = generator.GenerateBlueNoise(params, whiteNoise, blueNoise, &progress);
 		switch (result)
 		{
@@ -71,9 +73,8 @@ public:
 
 		// convert float to uint32_t
 		{
-			std::vector<uint32_t> data;
-			data.resize(blueNoise.size());
-			std::transform(blueNoise.begin(), blueNoise.end(), data.begin(), [](float f)
+			image::PixelBuffer data(blueNoise.size() * sizeof(uint32_t));
+			std::transform(blueNoise.begin(), blueNoise.end(), reinterpret_cast<uint32_t*>(data.data()), [](float f)
 				{
 					return glm::packUnorm4x8(glm::vec4(f, f, f, 1.0));
 				});
@@ -83,8 +84,8 @@ public:
 		// TODO mipmaps, for now leave empty with zeros
 		for (int i = 1; i < mipmaps; ++i)
 		{
-			std::vector<uint32_t> data;
-			data.resize(size_t(getWidth(i)) * size_t(getHeight(i)) * size_t(getDepth(i)));
+			image::PixelBuffer data(size_t(getWidth(i)) * size_t(getHeight(i)) * size_t(getDepth(i)) * sizeof(uint32_t));
+			memset(data.data(), 0, data.size());
 			m_values.push_back(move(data));
 		}
 	}
@@ -98,8 +99,8 @@ public:
 	gli::format getOriginalFormat() const override { return gli::format::FORMAT_RGBA8_UNORM_PACK8; }
 	uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) override
 	{
-		size = m_values.at(mipmap).size() * sizeof(m_values[0][0]);
-		return reinterpret_cast<uint8_t*>(m_values.at(mipmap).data());
+		size = m_values.at(mipmap).size();
+		return m_values.at(mipmap).data();
 	}
 	const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const override
 	{
@@ -114,10 +115,10 @@ private:
 	int m_mipmaps = 0;
 	uint32_t m_size = 0;
 
-	std::vector<std::vector<uint32_t>> m_values;
+	std::vector<image::PixelBuffer> m_values;
 };
 
-std::unique_ptr<image::IImage> noise_get_blue_noise(int width, int height, int depth, int layer, int mipmaps)
+std::unique_ptr<image::IImage> noise_get_blue_noise(int width, int height, int depth, int layer, int mipmaps, OperationContext& ctx)
 {
-	return std::make_unique<BlueNoiseImage>(width, height, depth, layer, mipmaps);
+	return std::make_unique<BlueNoiseImage>(width, height, depth, layer, mipmaps, ctx);
 }
\ No newline at end of file
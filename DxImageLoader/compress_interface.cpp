@@ -4,8 +4,13 @@
 #include "../dependencies/compressonator/cmp_compressonatorlib/compressonator.h"
 #include <thread>
 #include <stdexcept>
+#include "operation_context.h"
+#include "trace.h"
+#include "thread_pool.h"
 #include "interface.h"
 #include <algorithm>
+#include <vector>
+#include <d3d11.h>
 
 struct ExFormatInfo
 {
@@ -19,34 +24,90 @@ struct ExFormatInfo
 	CMP_DWORD widthMultiplier = 0; // 0 for compressed formats. width multiplier to get pitch
 };
 
-struct CompressInfo
+// encoder of compressonator (global parameter "compress backend")
+enum class CompressBackend
 {
-	bool isCompress;
-	// progress tracking
-	size_t curSteps; // number of steps before this compression
-	size_t curStepWeight; // weight of this compression
-	size_t numSteps; // total number of steps
+	Auto = 0, // gpu if a DirectX 11 device is available
+	Cpu = 1,
+	Gpu = 2
 };
 
-static CompressInfo s_currentCompressInfo;
+// speed of the BC1-BC3 encoders (global parameter "compress preset"). The quality argument is always used
+enum class CompressPreset
+{
+	Fast = 0,
+	Normal = 1
+};
 
-bool cmp_feedback_proc(float fProgress, CMP_DWORD_PTR pUser1, CMP_DWORD_PTR pUser2)
+struct EncodeSettings
 {
-	//const CompressInfo* info = reinterpret_cast<CompressInfo*>(pUser1);
-	const CompressInfo* info = &s_currentCompressInfo; // they removed the user parameter passing...
-	const char* desc = "compressing";
-	if (!info->isCompress) desc = "decompressing";
+	float quality; // [0, 1]
+	CMP_Speed speed; // BC1-BC3 (BC6H and BC7 only depend on the quality)
+	bool useGpu; // gpu encoder (DirectX compute) and decoder
+};
+
+// the gpu backend of compressonator needs a DirectX 11 hardware device (not available on some servers and virtual machines).
+// d3d11.dll is loaded on demand, the check must not fail the export if the device can not be created
+static bool has_directx_device()
+{
+	static const bool available = []()
+	{
+		const auto module = LoadLibraryA("d3d11.dll");
+		if (!module) return false;
+		const auto createDevice = reinterpret_cast<PFN_D3D11_CREATE_DEVICE>(GetProcAddress(module, "D3D11CreateDevice"));
+		// no device is created if all outputs are null
+		const bool res = createDevice && SUCCEEDED(createDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, nullptr, nullptr, nullptr));
+		FreeLibrary(module);
+		return res;
+	}();
+	return available;
+}
+
+static EncodeSettings get_encode_settings(int quality)
+{
+	EncodeSettings s;
+	s.quality = quality / 100.0f;
+	s.speed = CompressPreset(get_global_parameter_i("compress preset", int(CompressPreset::Normal))) == CompressPreset::Fast ?
+		CMP_Speed_SuperFast : CMP_Speed_Normal;
 
-	try
+	switch (CompressBackend(get_global_parameter_i("compress backend", int(CompressBackend::Auto))))
 	{
-		set_progress(uint32_t((info->curSteps + size_t(fProgress * 0.01f * float(info->curStepWeight))) / info->numSteps), desc);
+	case CompressBackend::Cpu: s.useGpu = false; break;
+	case CompressBackend::Gpu: s.useGpu = true; break;
+	default: s.useGpu = has_directx_device();
 	}
-	catch (const std::exception&)
+	return s;
+}
+
+// progress of one compressonator call (in pixels). Calls run concurrently => the finished pixels of each call are added to the shared context as differences
+struct CompressInfo
+{
+	OperationContext* ctx = nullptr;
+	size_t weight = 0; // pixels of this call
+	size_t reported = 0; // pixels that were already added to the context
+
+	// adds the pixels of done that were not reported yet
+	void report(size_t done)
 	{
-		return true;
+		done = std::min(done, weight);
+		if (done <= reported) return;
+		ctx->addWorkNoThrow(done - reported);
+		reported = done;
 	}
-	
-	return false; // don't abort compression
+};
+
+// compressonator does not pass user data to the feedback proc => the info of the running call is set for the calling thread
+static thread_local CompressInfo* s_currentCompressInfo = nullptr;
+
+bool cmp_feedback_proc(float fProgress, CMP_DWORD_PTR pUser1, CMP_DWORD_PTR pUser2)
+{
+	//const CompressInfo* info = reinterpret_cast<CompressInfo*>(pUser1);
+	CompressInfo* info = s_currentCompressInfo; // they removed the user parameter passing...
+	if (!info) return false; // not set for this thread (e.g. a worker of compressonator)
+
+	info->report(size_t(fProgress * 0.01f * float(info->weight)));
+	// abort compression if cancelled
+	return info->ctx->isCancelled();
 }
 
 CMP_FORMAT get_cmp_format(gli::format format, ExFormatInfo& exInfo, bool isSource)
@@ -247,10 +308,19 @@ void overwriteAlpha(uint8_t* data, uint32_t size, CMP_FORMAT format, uint8_t /*o
 	}
 }
 
-void copy_level(uint8_t* srcDat, uint8_t* dstDat, uint32_t width, uint32_t height, uint32_t srcSize, uint32_t dstSize,
+void copy_level(const uint8_t* srcDat, uint8_t* dstDat, uint32_t width, uint32_t height, uint32_t srcSize, uint32_t dstSize,
 	CMP_FORMAT srcFormat, CMP_FORMAT dstFormat, 
-	const ExFormatInfo& srcInfo, const ExFormatInfo& dstInfo, float quality, CompressInfo& curCompressInfo)
+	const ExFormatInfo& srcInfo, const ExFormatInfo& dstInfo, const EncodeSettings& settings, uint32_t numThreads, CompressInfo& curCompressInfo)
 {
+	// the channels of the source are swapped in a copy of the level, the source image stays unchanged
+	std::vector<uint8_t> swizzled;
+	if (!srcInfo.isCompressed && (srcInfo.swizzleRGB || dstInfo.swizzleRGB))
+	{
+		swizzled.assign(srcDat, srcDat + srcSize);
+		swizzleMipmap(swizzled.data(), srcSize, srcFormat);
+		srcDat = swizzled.data();
+	}
+
 	// fill out src texture
 	CMP_Texture srcTex;
 	srcTex.dwSize = sizeof(srcTex);
@@ -259,14 +329,12 @@ void copy_level(uint8_t* srcDat, uint8_t* dstDat, uint32_t width, uint32_t heigh
 	srcTex.dwPitch = srcInfo.widthMultiplier * srcTex.dwWidth;
 	srcTex.dwDataSize = CMP_DWORD(srcSize);
 	srcTex.format = srcFormat;
-	srcTex.pData = srcDat;
+	srcTex.pData = const_cast<CMP_BYTE*>(srcDat); // only read by compressonator
 	srcTex.nBlockWidth = srcInfo.bx;
 	srcTex.nBlockHeight = srcInfo.by;
 	srcTex.nBlockDepth = srcInfo.bz;
 	srcTex.pMipSet = nullptr;
 	srcTex.transcodeFormat = CMP_FORMAT_Unknown; // only used if format == CMP_FORMAT_BASIS
-	if (!srcInfo.isCompressed && (srcInfo.swizzleRGB || dstInfo.swizzleRGB))
-		swizzleMipmap(srcDat, srcSize, srcFormat);
 
 	// fill out dst texture
 	CMP_Texture dstTex;
@@ -291,21 +359,29 @@ void copy_level(uint8_t* srcDat, uint8_t* dstDat, uint32_t width, uint32_t heigh
 	// set compress options
 	CMP_CompressOptions options = {};
 	options.dwSize = sizeof(options);
-	options.fquality = quality;
-	static const size_t nThreads = std::thread::hardware_concurrency();
-	options.dwnumThreads = CMP_DWORD(nThreads);
+	options.fquality = settings.quality;
+	options.nCompressionSpeed = settings.speed;
+	options.dwnumThreads = CMP_DWORD(numThreads);
 	options.bDXT1UseAlpha = srcInfo.useDxt1Alpha || dstInfo.useDxt1Alpha;
 	options.nAlphaThreshold = 127;
-	options.bUseCGCompress = true;
-	options.bUseGPUDecompress = true;
-	options.nEncodeWith = CMP_Compute_type::CMP_GPU_DXC;
+	// the cpu backend uses the multithreaded cpu codecs of compressonator
+	options.bUseCGCompress = settings.useGpu;
+	options.bUseGPUDecompress = settings.useGpu;
+	options.nEncodeWith = settings.useGpu ? CMP_Compute_type::CMP_GPU_DXC : CMP_Compute_type::CMP_CPU;
 	options.nGPUDecode = CMP_GPUDecode::GPUDecode_DIRECTX;
 	options.SourceFormat = srcTex.format;
 	options.DestFormat = dstTex.format;
 	
 	// compress texture
-	s_currentCompressInfo = curCompressInfo; // set static compress info since they removed the user parameter...
-	auto status = CMP_ConvertTexture(&srcTex, &dstTex, &options, cmp_feedback_proc);
+	s_currentCompressInfo = &curCompressInfo; // set thread local compress info since they removed the user parameter...
+	CMP_ERROR status;
+	{
+		// the backend shows up in the trace
+		trace::Scope backendScope(settings.useGpu ? "compressonator_gpu" : "compressonator_cpu");
+		status = CMP_ConvertTexture(&srcTex, &dstTex, &options, cmp_feedback_proc);
+	}
+	s_currentCompressInfo = nullptr;
+	curCompressInfo.ctx->throwIfCancelled();
 	if (status != CMP_OK)
 		throw std::runtime_error("texture compression failed");
 
@@ -316,7 +392,7 @@ void copy_level(uint8_t* srcDat, uint8_t* dstDat, uint32_t width, uint32_t heigh
 	    overwriteAlpha(dstDat, dstSize, dstFormat, srcInfo.overwriteAlpha);
 }
 
-void compressonator_convert_image(image::IImage& src, image::IImage& dst, int quality)
+void compressonator_convert_image(const image::IImage& src, image::IImage& dst, int quality, OperationContext& ctx)
 {
 	assert(src.getNumLayers() == dst.getNumLayers());
 	assert(src.getNumMipmaps() == dst.getNumMipmaps());
@@ -327,48 +403,72 @@ void compressonator_convert_image(image::IImage& src, image::IImage& dst, int qu
 	const auto srcFormat = get_cmp_format(src.getFormat(), srcFormatInfo, true);
 	ExFormatInfo dstFormatInfo;
 	const auto dstFormat = get_cmp_format(dst.getFormat(), dstFormatInfo, false);
-	const float fquality = quality / 100.0f;
+	const auto settings = get_encode_settings(quality);
+
+	trace::Scope scope("compressonator_convert_image");
+	StageTimer timer(ctx.getStats(), Stage::Compress);
+	timer.add(src.getNumPixels(), src.getMemorySize(), dst.getMemorySize());
 
-	CompressInfo info;
-	info.isCompress = dstFormatInfo.isCompressed;
-	info.numSteps = std::max<size_t>(src.getNumPixels() / 100, 1); // progress range [0, 100]
-	info.curSteps = 0;
-	for(uint32_t layer = 0; layer < src.getNumLayers(); ++layer)
+	// one job per layer, mipmap and slice
+	struct Job
 	{
-		// copy mipmap levels
-		for(uint32_t mipmap = 0; mipmap < src.getNumMipmaps(); ++mipmap)
-		{
-			const auto depth = src.getDepth(mipmap);
-			const auto width = src.getWidth(mipmap);
-			const auto height = src.getHeight(mipmap);
-			info.curStepWeight = width * height;
-
-			size_t srcSize;
-			auto srcDat = src.getData(layer, mipmap, srcSize);
-			size_t dstSize;
-			auto dstDat = dst.getData(layer, mipmap, dstSize);
-
-			auto srcPlaneSize = srcSize / depth;
-			auto dstPlaneSize = dstSize / depth;
-
-			for (uint32_t z = 0; z < depth; ++z)
-			{
-				copy_level(
-					srcDat + srcPlaneSize * z,
-					dstDat + dstPlaneSize * z,
-					width,
-					height,
-					static_cast<uint32_t>(srcPlaneSize), static_cast<uint32_t>(dstPlaneSize),
-					srcFormat, dstFormat,
-					srcFormatInfo, dstFormatInfo,
-					fquality,
-					info
-				);
-
-				info.curSteps += info.curStepWeight;;
-			}
-		}
-	}
+		uint32_t layer;
+		uint32_t mipmap;
+		uint32_t z;
+		size_t pixels;
+	};
+	std::vector<Job> jobs;
+	for (uint32_t layer = 0; layer < src.getNumLayers(); ++layer)
+		for (uint32_t mipmap = 0; mipmap < src.getNumMipmaps(); ++mipmap)
+			for (uint32_t z = 0; z < src.getDepth(mipmap); ++z)
+				jobs.push_back({ layer, mipmap, z, size_t(src.getWidth(mipmap)) * src.getHeight(mipmap) });
+	// largest first => the tail mipmaps fill up the idle workers at the end
+	std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.pixels > b.pixels; });
+
+	const size_t numPixels = std::max<size_t>(src.getNumPixels(), 1);
+	ctx.beginWork(numPixels, dstFormatInfo.isCompressed ? "compressing" : "decompressing");
+
+	// the gpu encoder and decoder of compressonator share one DirectX device => only the cpu codecs run concurrently
+	const bool parallel = !settings.useGpu;
+	// compressonator threads of a parallel job are proportional to its share of the pixels (a single large level keeps all threads, equal faces get one each)
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	auto runJob = [&](size_t jobIndex)
+	{
+		const auto& job = jobs[jobIndex];
+		trace::Scope jobScope("compress", int(job.layer), int(job.mipmap));
+		const auto depth = src.getDepth(job.mipmap);
+
+		size_t srcSize;
+		auto srcDat = src.getData(job.layer, job.mipmap, srcSize);
+		size_t dstSize;
+		auto dstDat = dst.getData(job.layer, job.mipmap, dstSize);
+
+		auto srcPlaneSize = srcSize / depth;
+		auto dstPlaneSize = dstSize / depth;
+
+		CompressInfo info;
+		info.ctx = &ctx;
+		info.weight = job.pixels;
+		const auto numThreads = parallel ? std::min(hardwareThreads, (hardwareThreads * job.pixels + numPixels - 1) / numPixels) : hardwareThreads;
+		copy_level(
+			srcDat + srcPlaneSize * job.z,
+			dstDat + dstPlaneSize * job.z,
+			src.getWidth(job.mipmap),
+			src.getHeight(job.mipmap),
+			static_cast<uint32_t>(srcPlaneSize), static_cast<uint32_t>(dstPlaneSize),
+			srcFormat, dstFormat,
+			srcFormatInfo, dstFormatInfo,
+			settings,
+			uint32_t(numThreads),
+			info
+		);
+		info.report(info.weight);
+	};
+
+	if (parallel)
+		ThreadPool::get().parallelFor(jobs.size(), runJob);
+	else
+		for (size_t i = 0; i < jobs.size(); ++i) runJob(i);
 }
 
 bool is_compressonator_format(gli::format format)
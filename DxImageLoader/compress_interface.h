@@ -2,6 +2,8 @@
 #include <memory>
 #include "Image.h"
 
-void compressonator_convert_image(image::IImage& src, image::IImage& dst, int quality);
+class OperationContext;
+
+void compressonator_convert_image(const image::IImage& src, image::IImage& dst, int quality, OperationContext& ctx);
 
 bool is_compressonator_format(gli::format format);
\ No newline at end of file
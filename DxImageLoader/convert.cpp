@@ -0,0 +1,1023 @@
+#include "pch.h"
+#include "convert.h"
+#include "interface.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <cmath>
+#include <type_traits>
+#if defined(_M_X64) || defined(_M_IX86)
+#define CONVERT_X86
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(_M_ARM64)
+#define CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef CONVERT_X86
+// F16C instructions are VEX encoded => the os must save the AVX registers as well
+static bool hasF16C()
+{
+	static const bool supported = []()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		const bool f16c = (info[2] & (1 << 29)) != 0;
+		if (!osxsave || !avx || !f16c) return false;
+		return (_xgetbv(0) & 0x6) == 0x6; // xmm and ymm state
+	}();
+	return supported;
+}
+#endif
+
+void image::floatToHalf(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+#ifdef CONVERT_X86
+	if (hasF16C())
+	{
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 values = _mm256_loadu_ps(src + i);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+		dst[i] = glm::packHalf1x16(src[i]);
+}
+
+void image::halfToFloat(const uint16_t* src, float* dst, size_t count)
+{
+	size_t i = 0;
+#ifdef CONVERT_X86
+	if (hasF16C())
+	{
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(values));
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+		dst[i] = glm::unpackHalf1x16(src[i]);
+}
+
+namespace
+{
+	// instruction sets of the pixel shuffles. NEON is treated as Sse41 (128 bit byte shuffle)
+	enum class SimdLevel
+	{
+		Scalar = 0,
+		Sse41 = 1,
+		Avx2 = 2
+	};
+
+	SimdLevel getSupportedLevel()
+	{
+		static const SimdLevel level = []()
+		{
+#if defined(CONVERT_X86)
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+			__cpuid(info, 1);
+			const bool sse41 = (info[2] & (1 << 19)) != 0; // pshufb is ssse3 (included)
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!sse41) return SimdLevel::Scalar;
+			if (maxLeaf < 7 || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return SimdLevel::Sse41;
+			__cpuidex(info, 7, 0);
+			const bool avx2 = (info[1] & (1 << 5)) != 0;
+			return avx2 ? SimdLevel::Avx2 : SimdLevel::Sse41;
+#elif defined(CONVERT_NEON)
+			return SimdLevel::Sse41; // always available on arm64
+#else
+			return SimdLevel::Scalar;
+#endif
+		}();
+		return level;
+	}
+
+	SimdLevel getSimdLevel()
+	{
+		const int requested = get_global_parameter_i("simd", int(SimdLevel::Avx2));
+		return SimdLevel(std::min(std::max(requested, 0), int(getSupportedLevel())));
+	}
+
+	// byte shuffle of one group of 16 bytes: dst[i] = src[mask[i]] | bits[i]. Indices with the highest bit set select 0
+	using Mask = std::array<uint8_t, 16>;
+	constexpr uint8_t s_zero = 0x80;
+
+	// applies the first n entries of the mask (n <= 16). src and dst may overlap
+	void shuffleBytes(const uint8_t* src, uint8_t* dst, const Mask& mask, const Mask& bits, size_t n)
+	{
+		uint8_t tmp[16];
+		for (size_t i = 0; i < n; ++i)
+			tmp[i] = ((mask[i] & s_zero) ? uint8_t(0) : src[mask[i]]) | bits[i];
+		memcpy(dst, tmp, n);
+	}
+
+	// mask for RGBA pixels of 4 * elementSize bytes from pixels with numChannels channels. channels[c] = -1 selects constants[c]
+	void getExpandMask(size_t elementSize, size_t numChannels, const std::array<int, 4>& channels, const uint8_t* constants, Mask& mask, Mask& bits)
+	{
+		const size_t dstPixelSize = 4 * elementSize;
+		for (size_t pixel = 0; pixel < 16 / dstPixelSize; ++pixel)
+			for (size_t c = 0; c < 4; ++c)
+				for (size_t b = 0; b < elementSize; ++b)
+				{
+					const size_t i = pixel * dstPixelSize + c * elementSize + b;
+					if (channels[c] < 0)
+					{
+						mask[i] = s_zero;
+						bits[i] = constants[c * elementSize + b];
+					}
+					else
+					{
+						mask[i] = uint8_t(pixel * numChannels * elementSize + size_t(channels[c]) * elementSize + b);
+						bits[i] = 0;
+					}
+				}
+	}
+
+#ifdef CONVERT_X86
+	inline __m128i load(const Mask& m) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(m.data())); }
+	inline __m128i load16(const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	inline void store16(uint8_t* p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+	// two independent 16 byte groups in the lanes of an avx register
+	inline __m256i load16x2(const uint8_t* lo, const uint8_t* hi) { return _mm256_inserti128_si256(_mm256_castsi128_si256(load16(lo)), load16(hi), 1); }
+#endif
+
+	// applies the mask to each group of 16 bytes in place. pixelSize divides 16 and size is a multiple of pixelSize
+	void shuffleInplace(uint8_t* data, size_t size, size_t pixelSize, const Mask& mask, SimdLevel level)
+	{
+		static const Mask noBits = {};
+		size_t i = 0;
+#if defined(CONVERT_X86)
+		if (level >= SimdLevel::Avx2)
+		{
+			const __m256i m = _mm256_broadcastsi128_si256(load(mask));
+			for (; i + 32 <= size; i += 32)
+			{
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_shuffle_epi8(v, m));
+			}
+		}
+		if (level >= SimdLevel::Sse41)
+		{
+			const __m128i m = load(mask);
+			for (; i + 16 <= size; i += 16)
+				store16(data + i, _mm_shuffle_epi8(load16(data + i), m));
+		}
+#elif defined(CONVERT_NEON)
+		if (level >= SimdLevel::Sse41)
+		{
+			const uint8x16_t m = vld1q_u8(mask.data());
+			for (; i + 16 <= size; i += 16)
+				vst1q_u8(data + i, vqtbl1q_u8(vld1q_u8(data + i), m));
+		}
+#endif
+		// remaining pixels (the first pixel of the mask applies to every pixel)
+		for (; i < size; i += pixelSize)
+			shuffleBytes(data + i, data + i, mask, noBits, pixelSize);
+	}
+
+	// expands numPixels pixels from srcPixelSize to dstPixelSize bytes (dstPixelSize divides 16). The mask describes one group of 16 destination bytes.
+	// In place (src == dst), the pixels are processed backwards: a group reads 16 bytes from its source position that have not been overwritten yet
+	void expandPixels(const uint8_t* src, uint8_t* dst, size_t numPixels, size_t srcPixelSize, size_t dstPixelSize, const Mask& mask, const Mask& bits, SimdLevel level)
+	{
+		const size_t groupPixels = 16 / dstPixelSize;
+		if (src == dst)
+		{
+			size_t p = numPixels;
+			// last pixels that do not fill a group
+			for (; p % groupPixels; --p)
+				shuffleBytes(src + (p - 1) * srcPixelSize, dst + (p - 1) * dstPixelSize, mask, bits, dstPixelSize);
+#if defined(CONVERT_X86)
+			if (level >= SimdLevel::Avx2)
+			{
+				const __m256i m = _mm256_broadcastsi128_si256(load(mask));
+				const __m256i b = _mm256_broadcastsi128_si256(load(bits));
+				for (; p >= 2 * groupPixels; p -= 2 * groupPixels)
+				{
+					const size_t first = p - 2 * groupPixels;
+					const __m256i v = load16x2(src + first * srcPixelSize, src + (first + groupPixels) * srcPixelSize);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + first * dstPixelSize), _mm256_or_si256(_mm256_shuffle_epi8(v, m), b));
+				}
+			}
+			if (level >= SimdLevel::Sse41)
+			{
+				const __m128i m = load(mask);
+				const __m128i b = load(bits);
+				for (; p >= groupPixels; p -= groupPixels)
+				{
+					const size_t first = p - groupPixels;
+					store16(dst + first * dstPixelSize, _mm_or_si128(_mm_shuffle_epi8(load16(src + first * srcPixelSize), m), b));
+				}
+			}
+#elif defined(CONVERT_NEON)
+			if (level >= SimdLevel::Sse41)
+			{
+				const uint8x16_t m = vld1q_u8(mask.data());
+				const uint8x16_t b = vld1q_u8(bits.data());
+				for (; p >= groupPixels; p -= groupPixels)
+				{
+					const size_t first = p - groupPixels;
+					vst1q_u8(dst + first * dstPixelSize, vorrq_u8(vqtbl1q_u8(vld1q_u8(src + first * srcPixelSize), m), b));
+				}
+			}
+#endif
+			for (; p > 0; --p)
+				shuffleBytes(src + (p - 1) * srcPixelSize, dst + (p - 1) * dstPixelSize, mask, bits, dstPixelSize);
+			return;
+		}
+
+		// separate buffers: forward, the 16 byte loads must stay inside of src
+		const size_t srcSize = numPixels * srcPixelSize;
+		size_t p = 0;
+#if defined(CONVERT_X86)
+		if (level >= SimdLevel::Avx2)
+		{
+			const __m256i m = _mm256_broadcastsi128_si256(load(mask));
+			const __m256i b = _mm256_broadcastsi128_si256(load(bits));
+			for (; (p + groupPixels) * srcPixelSize + 16 <= srcSize; p += 2 * groupPixels)
+			{
+				const __m256i v = load16x2(src + p * srcPixelSize, src + (p + groupPixels) * srcPixelSize);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + p * dstPixelSize), _mm256_or_si256(_mm256_shuffle_epi8(v, m), b));
+			}
+		}
+		if (level >= SimdLevel::Sse41)
+		{
+			const __m128i m = load(mask);
+			const __m128i b = load(bits);
+			for (; p * srcPixelSize + 16 <= srcSize; p += groupPixels)
+				store16(dst + p * dstPixelSize, _mm_or_si128(_mm_shuffle_epi8(load16(src + p * srcPixelSize), m), b));
+		}
+#elif defined(CONVERT_NEON)
+		if (level >= SimdLevel::Sse41)
+		{
+			const uint8x16_t m = vld1q_u8(mask.data());
+			const uint8x16_t b = vld1q_u8(bits.data());
+			for (; p * srcPixelSize + 16 <= srcSize; p += groupPixels)
+				vst1q_u8(dst + p * dstPixelSize, vorrq_u8(vqtbl1q_u8(vld1q_u8(src + p * srcPixelSize), m), b));
+		}
+#endif
+		for (; p < numPixels; ++p)
+			shuffleBytes(src + p * srcPixelSize, dst + p * dstPixelSize, mask, bits, dstPixelSize);
+	}
+
+	// copies pixels from srcPixelSize to dstPixelSize <= srcPixelSize bytes (srcPixelSize divides 16). The mask describes the destination bytes of one group of 16 source bytes.
+	// dst may be equal to src: the 16 bytes that are stored for a group end before the source of the next group
+	void compactPixels(const uint8_t* src, uint8_t* dst, size_t numPixels, size_t srcPixelSize, size_t dstPixelSize, const Mask& mask, SimdLevel level)
+	{
+		static const Mask noBits = {};
+		const size_t groupPixels = 16 / srcPixelSize;
+		const size_t dstSize = numPixels * dstPixelSize;
+		size_t p = 0;
+#if defined(CONVERT_X86)
+		if (level >= SimdLevel::Sse41)
+		{
+			const __m128i m = load(mask);
+			for (; p + groupPixels <= numPixels && p * dstPixelSize + 16 <= dstSize; p += groupPixels)
+				store16(dst + p * dstPixelSize, _mm_shuffle_epi8(load16(src + p * srcPixelSize), m));
+		}
+#elif defined(CONVERT_NEON)
+		if (level >= SimdLevel::Sse41)
+		{
+			const uint8x16_t m = vld1q_u8(mask.data());
+			for (; p + groupPixels <= numPixels && p * dstPixelSize + 16 <= dstSize; p += groupPixels)
+				vst1q_u8(dst + p * dstPixelSize, vqtbl1q_u8(vld1q_u8(src + p * srcPixelSize), m));
+		}
+#endif
+		for (; p < numPixels; ++p)
+			shuffleBytes(src + p * srcPixelSize, dst + p * dstPixelSize, mask, noBits, dstPixelSize);
+	}
+}
+
+bool image::useSimd()
+{
+	return getSimdLevel() != SimdLevel::Scalar;
+}
+
+void image::shuffleRGBA(uint8_t* data, size_t size, size_t channelSize, const std::array<int, 4>& channels)
+{
+	assert(channelSize == 1 || channelSize == 2 || channelSize == 4);
+	const size_t pixelSize = 4 * channelSize;
+	assert(size % pixelSize == 0);
+	Mask mask;
+	for (size_t pixel = 0; pixel < 16 / pixelSize; ++pixel)
+		for (size_t c = 0; c < 4; ++c)
+			for (size_t b = 0; b < channelSize; ++b)
+				mask[pixel * pixelSize + c * channelSize + b] = uint8_t(pixel * pixelSize + size_t(channels[c]) * channelSize + b);
+
+	shuffleInplace(data, size, pixelSize, mask, getSimdLevel());
+}
+
+void image::expandToRGBA(uint8_t* data, size_t numPixels, size_t elementSize, size_t numChannels, const std::array<int, 4>& channels, const void* constants)
+{
+	copyToRGBA(data, data, numPixels, elementSize, numChannels, channels, constants);
+}
+
+void image::copyToRGBA(const uint8_t* src, uint8_t* dst, size_t numPixels, size_t elementSize, size_t numChannels, const std::array<int, 4>& channels, const void* constants)
+{
+	assert(elementSize == 1 || elementSize == 2 || elementSize == 4);
+	assert(numChannels <= 4);
+	Mask mask, bits;
+	getExpandMask(elementSize, numChannels, channels, reinterpret_cast<const uint8_t*>(constants), mask, bits);
+	expandPixels(src, dst, numPixels, numChannels * elementSize, 4 * elementSize, mask, bits, getSimdLevel());
+}
+
+void image::copyStrideEx(const uint8_t* src, uint8_t* dst, size_t count, size_t oldStride, size_t bitmask)
+{
+	assert(oldStride <= 16);
+	const auto level = getSimdLevel();
+	// groups of 16 bytes must contain whole elements
+	if (level == SimdLevel::Scalar || 16 % oldStride != 0)
+		return scalar::copyStrideEx(src, dst, count, oldStride, bitmask);
+
+	size_t offsets[16];
+	size_t newStride = 0;
+	for (size_t i = 0; i < oldStride; ++i)
+	{
+		if ((size_t(1) << i) & bitmask)
+			offsets[newStride++] = i;
+	}
+	if (newStride == 0) return;
+
+	Mask mask;
+	mask.fill(s_zero);
+	for (size_t pixel = 0; pixel < 16 / oldStride; ++pixel)
+		for (size_t i = 0; i < newStride; ++i)
+			mask[pixel * newStride + i] = uint8_t(pixel * oldStride + offsets[i]);
+
+	compactPixels(src, dst, count, oldStride, newStride, mask, level);
+}
+
+namespace
+{
+#ifdef CONVERT_X86
+	// loads 4 integers of type T as int32
+	template<class T> __m128i loadInt4(const uint8_t* p);
+	template<> __m128i loadInt4<uint8_t>(const uint8_t* p) { int32_t v; memcpy(&v, p, 4); return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(v)); }
+	template<> __m128i loadInt4<int8_t>(const uint8_t* p) { int32_t v; memcpy(&v, p, 4); return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(v)); }
+	template<> __m128i loadInt4<uint16_t>(const uint8_t* p) { return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+	template<> __m128i loadInt4<int16_t>(const uint8_t* p) { return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+	template<> __m128i loadInt4<int32_t>(const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+#endif
+
+	template<class T>
+	void integerToFloat(const uint8_t* src, float* dst, size_t count, bool normalized, SimdLevel level)
+	{
+		constexpr bool isSigned = std::is_signed<T>::value;
+		const float divisor = normalized ? float(std::numeric_limits<T>::max()) : 1.0f;
+		const bool clampToMinusOne = isSigned && normalized;
+		size_t i = 0;
+#ifdef CONVERT_X86
+		// the int32 to float conversion is signed
+		if constexpr (!std::is_same<T, uint32_t>::value)
+		{
+			if (level >= SimdLevel::Sse41)
+			{
+				const __m128 div = _mm_set1_ps(divisor);
+				const __m128 minusOne = _mm_set1_ps(-1.0f);
+				for (; i + 4 <= count; i += 4)
+				{
+					__m128 f = _mm_div_ps(_mm_cvtepi32_ps(loadInt4<T>(src + i * sizeof(T))), div);
+					if (clampToMinusOne) f = _mm_max_ps(f, minusOne);
+					_mm_storeu_ps(dst + i, f);
+				}
+			}
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			T v;
+			memcpy(&v, src + i * sizeof(T), sizeof(T));
+			float f = float(v) / divisor;
+			if (clampToMinusOne) f = std::max(f, -1.0f);
+			dst[i] = f;
+		}
+	}
+}
+
+void image::integerToFloat(const uint8_t* src, float* dst, size_t count, size_t elementSize, bool isSigned, bool normalized)
+{
+	assert(elementSize == 1 || elementSize == 2 || elementSize == 4);
+	assert(!normalized || elementSize != 4); // there are no normalized 32 bit formats
+	const auto level = getSimdLevel();
+	switch (elementSize)
+	{
+	case 1: return isSigned ? ::integerToFloat<int8_t>(src, dst, count, normalized, level) : ::integerToFloat<uint8_t>(src, dst, count, normalized, level);
+	case 2: return isSigned ? ::integerToFloat<int16_t>(src, dst, count, normalized, level) : ::integerToFloat<uint16_t>(src, dst, count, normalized, level);
+	default: return isSigned ? ::integerToFloat<int32_t>(src, dst, count, normalized, level) : ::integerToFloat<uint32_t>(src, dst, count, normalized, level);
+	}
+}
+
+namespace
+{
+	double srgbToLinearExact(double c)
+	{
+		return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+	}
+
+	double linearToSrgbExact(double c)
+	{
+		return c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+	}
+
+	// float values are assigned to buckets of 7 mantissa bits from 2^-13 (below the first rounding threshold) to 1.
+	// Thresholds are further apart than a bucket => a value is either the result of the bucket start or one more
+	constexpr int s_bucketMantissaBits = 7;
+	constexpr int32_t s_firstBucketBits = (127 - 13) << 23; // 2^-13
+	constexpr size_t s_numBuckets = (13 << s_bucketMantissaBits) + 1; // last bucket is 1.0
+
+	struct SrgbTables
+	{
+		// srgb to linear for color channels (0-255) and alpha (256-511)
+		float toLinear[512];
+		// threshold[i] is the smallest float that is rounded to srgb value i + 1. threshold[255] is never reached
+		float threshold[256];
+		// srgb value of the first float of each bucket (int32 for gathers)
+		int32_t bucketStart[s_numBuckets];
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				toLinear[i] = float(srgbToLinearExact(i / 255.0));
+				toLinear[256 + i] = float(i) / 255.0f;
+			}
+
+			for (int i = 0; i < 255; ++i)
+			{
+				const auto reaches = [i](float v) { return linearToSrgbExact(v) * 255.0 >= i + 0.5; };
+				float t = float(srgbToLinearExact((i + 0.5) / 255.0));
+				while (!reaches(t)) t = std::nextafter(t, 2.0f);
+				while (reaches(std::nextafter(t, 0.0f))) t = std::nextafter(t, 0.0f);
+				threshold[i] = t;
+			}
+			threshold[255] = 2.0f; // above the clamped range
+
+			for (size_t b = 0; b < s_numBuckets; ++b)
+			{
+				const int32_t bits = s_firstBucketBits + int32_t(b << (23 - s_bucketMantissaBits));
+				float v;
+				memcpy(&v, &bits, sizeof(v));
+				bucketStart[b] = int32_t(std::upper_bound(threshold, threshold + 255, v) - threshold);
+			}
+		}
+	};
+
+	const SrgbTables& getSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	uint8_t toSrgb8(float v, const SrgbTables& t)
+	{
+		v = v > 0.0f ? v : 0.0f; // NaN => 0
+		v = v < 1.0f ? v : 1.0f;
+		int32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		const int32_t bucket = std::max((bits - s_firstBucketBits) >> (23 - s_bucketMantissaBits), 0);
+		const int32_t res = t.bucketStart[bucket];
+		return uint8_t(res + (v >= t.threshold[res] ? 1 : 0));
+	}
+
+	uint8_t toUnorm8(float v)
+	{
+		v = v > 0.0f ? v : 0.0f;
+		v = v < 1.0f ? v : 1.0f;
+		return uint8_t(v * 255.0f + 0.5f);
+	}
+}
+
+void image::srgbToLinear(const uint8_t* src, float* dst, size_t numPixels, size_t numChannels)
+{
+	assert(numChannels >= 1 && numChannels <= 4);
+	const auto& t = getSrgbTables();
+	const size_t count = numPixels * numChannels;
+	size_t i = 0;
+#ifdef CONVERT_X86
+	// 8 values are two RGBA pixels
+	if (getSimdLevel() >= SimdLevel::Avx2)
+	{
+		const __m256i offset = numChannels == 4 ? _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256) : _mm256_setzero_si256();
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i idx = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i))), offset);
+			_mm256_storeu_ps(dst + i, _mm256_i32gather_ps(t.toLinear, idx, 4));
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		dst[i] = t.toLinear[src[i] + (numChannels == 4 && i % 4 == 3 ? 256 : 0)];
+}
+
+void image::linearToSrgb(const float* src, uint8_t* dst, size_t numPixels, size_t numChannels)
+{
+	assert(numChannels >= 1 && numChannels <= 4);
+	const auto& t = getSrgbTables();
+	const size_t count = numPixels * numChannels;
+	size_t i = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Avx2)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256i firstBucket = _mm256_set1_epi32(s_firstBucketBits);
+		const __m256i isAlpha = numChannels == 4 ? _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1) : _mm256_setzero_si256();
+		for (; i + 8 <= count; i += 8)
+		{
+			// max returns the second operand for NaN
+			const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), zero), one);
+			const __m256i bucket = _mm256_max_epi32(_mm256_srai_epi32(_mm256_sub_epi32(_mm256_castps_si256(v), firstBucket), 23 - s_bucketMantissaBits), _mm256_setzero_si256());
+			const __m256i start = _mm256_i32gather_epi32(t.bucketStart, bucket, 4);
+			const __m256 threshold = _mm256_i32gather_ps(t.threshold, start, 4);
+			// the comparison mask is -1 => subtracting adds one
+			const __m256i srgb = _mm256_sub_epi32(start, _mm256_castps_si256(_mm256_cmp_ps(v, threshold, _CMP_GE_OQ)));
+			const __m256i alpha = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+			const __m256i res = _mm256_blendv_epi8(srgb, alpha, isAlpha);
+
+			const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(res), _mm256_extracti128_si256(res, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		dst[i] = numChannels == 4 && i % 4 == 3 ? toUnorm8(src[i]) : toSrgb8(src[i], t);
+}
+
+namespace
+{
+	// floor(x + 0.5) for x >= 0. x - floor(x) is exact, x + 0.5 would round values slightly below 0.5 up to 1
+	uint32_t roundHalfUp(float x)
+	{
+		const float r = std::floor(x);
+		return uint32_t(r) + (x - r >= 0.5f ? 1 : 0);
+	}
+
+	// same as glm::round(glm::clamp(v, 0.0f, 1.0f) * maxValue) (round half away from zero). NaN becomes 0
+	uint32_t toUnorm(float v, float maxValue)
+	{
+		v = v > 0.0f ? v : 0.0f;
+		v = v < 1.0f ? v : 1.0f;
+		return roundHalfUp(v * maxValue);
+	}
+
+	uint16_t toUnorm16(float v)
+	{
+		return uint16_t(toUnorm(v, 65535.0f));
+	}
+
+#ifdef CONVERT_X86
+	inline __m128i roundHalfUpx4(__m128 x)
+	{
+		const __m128 r = _mm_floor_ps(x);
+		// the comparison mask is -1 => subtracting adds one
+		return _mm_sub_epi32(_mm_cvttps_epi32(r), _mm_castps_si128(_mm_cmpge_ps(_mm_sub_ps(x, r), _mm_set1_ps(0.5f))));
+	}
+
+	// 4 values of toUnorm as int32
+	inline __m128i toUnormx4(__m128 v, __m128 maxValue)
+	{
+		v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		return roundHalfUpx4(_mm_mul_ps(v, maxValue));
+	}
+
+	// 8 values of toUnorm16 as uint16
+	inline __m128i toUnorm16x8(const float* src, SimdLevel level)
+	{
+		if (level >= SimdLevel::Avx2)
+		{
+			const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src), _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			const __m256 x = _mm256_mul_ps(v, _mm256_set1_ps(65535.0f));
+			const __m256 r = _mm256_floor_ps(x);
+			const __m256i res = _mm256_sub_epi32(_mm256_cvttps_epi32(r), _mm256_castps_si256(_mm256_cmp_ps(_mm256_sub_ps(x, r), _mm256_set1_ps(0.5f), _CMP_GE_OQ)));
+			return _mm_packus_epi32(_mm256_castsi256_si128(res), _mm256_extracti128_si256(res, 1));
+		}
+		const __m128 maxValue = _mm_set1_ps(65535.0f);
+		return _mm_packus_epi32(toUnormx4(_mm_loadu_ps(src), maxValue), toUnormx4(_mm_loadu_ps(src + 4), maxValue));
+	}
+#endif
+}
+
+void image::floatToUnorm16(const float* src, uint8_t* dst, size_t numPixels, size_t bitmask, bool bigEndian)
+{
+	size_t channels[4];
+	size_t numChannels = 0;
+	for (size_t c = 0; c < 4; ++c)
+	{
+		if ((size_t(1) << c) & bitmask)
+			channels[numChannels++] = c;
+	}
+	if (numChannels == 0) return;
+
+	const size_t dstPixelSize = numChannels * 2;
+	const size_t lo = bigEndian ? 1 : 0; // destination byte of the low byte
+	size_t p = 0;
+#ifdef CONVERT_X86
+	const auto level = getSimdLevel();
+	if (level >= SimdLevel::Sse41)
+	{
+		// two groups of two RGBA pixels (8 uint16) are shuffled to the selected channels and byte order.
+		// Up to two channels both groups fit into one store, otherwise the second store overwrites the unused end of the first
+		const size_t groupSize = 2 * dstPixelSize;
+		const bool combine = 2 * groupSize <= 16;
+		Mask first, second;
+		first.fill(s_zero);
+		second.fill(s_zero);
+		for (size_t pixel = 0; pixel < 2; ++pixel)
+			for (size_t i = 0; i < numChannels; ++i)
+				for (size_t b = 0; b < 2; ++b)
+				{
+					const size_t d = pixel * dstPixelSize + i * 2 + (b == 0 ? lo : 1 - lo);
+					const auto s = uint8_t(pixel * 8 + channels[i] * 2 + b);
+					first[d] = s;
+					second[(combine ? groupSize : 0) + d] = s;
+				}
+		const __m128i m0 = load(first);
+		const __m128i m1 = load(second);
+		const size_t dstSize = numPixels * dstPixelSize;
+		const size_t storeEnd = combine ? 16 : groupSize + 16;
+		for (; p + 4 <= numPixels && p * dstPixelSize + storeEnd <= dstSize; p += 4)
+		{
+			const __m128i a = _mm_shuffle_epi8(toUnorm16x8(src + p * 4, level), m0);
+			const __m128i b = _mm_shuffle_epi8(toUnorm16x8(src + p * 4 + 8, level), m1);
+			if (combine)
+				store16(dst + p * dstPixelSize, _mm_or_si128(a, b));
+			else
+			{
+				store16(dst + p * dstPixelSize, a);
+				store16(dst + p * dstPixelSize + groupSize, b);
+			}
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		for (size_t i = 0; i < numChannels; ++i)
+		{
+			const uint16_t v = toUnorm16(src[p * 4 + channels[i]]);
+			dst[p * dstPixelSize + i * 2 + lo] = uint8_t(v & 0xFF);
+			dst[p * dstPixelSize + i * 2 + 1 - lo] = uint8_t(v >> 8);
+		}
+	}
+}
+
+namespace
+{
+	float fromBits(uint32_t bits)
+	{
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	uint32_t toBits(float f)
+	{
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+
+	// clamps to [0, maxValue], NaN becomes 0
+	float clampPositive(float v, float maxValue)
+	{
+		v = v > 0.0f ? v : 0.0f;
+		return v < maxValue ? v : maxValue;
+	}
+
+	// unsigned float with 5 exponent bits (bias 15) and MantissaBits (6 for 11 bit, 5 for 10 bit)
+	template<int MantissaBits>
+	struct SmallFloat
+	{
+		static constexpr int mantissaBits = MantissaBits;
+		static constexpr int shift = 23 - MantissaBits;
+		static constexpr uint32_t mask = (1u << (MantissaBits + 5)) - 1;
+		// difference of the exponent biases 127 - 15
+		static constexpr uint32_t bias = 112u << MantissaBits;
+		static constexpr uint32_t maxBits = (30u << MantissaBits) | ((1u << MantissaBits) - 1);
+		// largest finite value and smallest normal value
+		static float maxValue() { return fromBits((maxBits << shift) + (bias << shift)); }
+		static float minNormal() { return fromBits(113u << 23); }
+		// scales the shifted bits to the float exponent range (normals and denormals). 2^112
+		static float scale() { return fromBits(239u << 23); }
+		// denormal mantissa of a value below minNormal. 2^(14 + MantissaBits)
+		static float denormalScale() { return fromBits(uint32_t(127 + 14 + MantissaBits) << 23); }
+
+		static float unpack(uint32_t x)
+		{
+			if ((x >> MantissaBits) == 31) return fromBits(0x7F800000 | (x << shift)); // inf and NaN
+			return fromBits(x << shift) * scale();
+		}
+
+		// rounds to nearest even
+		static uint32_t pack(float v)
+		{
+			v = clampPositive(v, maxValue());
+			if (v < minNormal()) return uint32_t(std::nearbyint(v * denormalScale()));
+			const uint32_t bits = toBits(v);
+			// a carry of the mantissa increments the exponent
+			return ((bits + (1u << (shift - 1)) - 1 + ((bits >> shift) & 1)) >> shift) - bias;
+		}
+	};
+	using Float11 = SmallFloat<6>;
+	using Float10 = SmallFloat<5>;
+
+	// shared exponent format of EXT_texture_shared_exponent: 9 bit mantissas without implicit one, 5 bit exponent with bias 15
+	constexpr int s_sharedExpBias = 15;
+	constexpr int s_sharedMantissaBits = 9;
+
+	// 2^(e - 24) converts a mantissa with the shared exponent e to float
+	float sharedExpScale(uint32_t e)
+	{
+		return fromBits((e + 127 - s_sharedExpBias - s_sharedMantissaBits) << 23);
+	}
+
+	float maxSharedExpValue()
+	{
+		return 65408.0f; // (2^9 - 1) / 2^9 * 2^16
+	}
+
+	uint32_t packRGB9E5(float r, float g, float b)
+	{
+		r = clampPositive(r, maxSharedExpValue());
+		g = clampPositive(g, maxSharedExpValue());
+		b = clampPositive(b, maxSharedExpValue());
+		const float maxColor = std::max(r, std::max(g, b));
+		// max(-B - 1, floor(log2(maxColor))) + 1 + B with the exponent of the float
+		uint32_t e = uint32_t(std::max(int(toBits(maxColor) >> 23) - 127, -s_sharedExpBias - 1) + 1 + s_sharedExpBias);
+		// the largest mantissa can be rounded up to 2^9 => the next exponent
+		float scale = 1.0f / sharedExpScale(e);
+		if (roundHalfUp(maxColor * scale) == 1u << s_sharedMantissaBits)
+		{
+			++e;
+			scale *= 0.5f;
+		}
+		return roundHalfUp(r * scale) | (roundHalfUp(g * scale) << 9) | (roundHalfUp(b * scale) << 18) | (e << 27);
+	}
+
+	void unpackRGB9E5(uint32_t x, float* dst)
+	{
+		const float scale = sharedExpScale(x >> 27);
+		dst[0] = float(x & 0x1FF) * scale;
+		dst[1] = float((x >> 9) & 0x1FF) * scale;
+		dst[2] = float((x >> 18) & 0x1FF) * scale;
+	}
+
+#ifdef CONVERT_X86
+	// loads 4 pixels with 3 or 4 channels as channel vectors (alpha is only loaded for 4 channels)
+	inline void loadChannels(const float* src, size_t numChannels, __m128& r, __m128& g, __m128& b, __m128& a)
+	{
+		if (numChannels == 4)
+		{
+			r = _mm_loadu_ps(src);
+			g = _mm_loadu_ps(src + 4);
+			b = _mm_loadu_ps(src + 8);
+			a = _mm_loadu_ps(src + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+		}
+		else
+		{
+			r = _mm_setr_ps(src[0], src[3], src[6], src[9]);
+			g = _mm_setr_ps(src[1], src[4], src[7], src[10]);
+			b = _mm_setr_ps(src[2], src[5], src[8], src[11]);
+			a = _mm_set1_ps(1.0f);
+		}
+	}
+
+	// stores 4 pixels with 3 or 4 channels from channel vectors
+	inline void storeChannels(float* dst, size_t numChannels, __m128 r, __m128 g, __m128 b, __m128 a)
+	{
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+		if (numChannels == 4)
+		{
+			_mm_storeu_ps(dst, r);
+			_mm_storeu_ps(dst + 4, g);
+			_mm_storeu_ps(dst + 8, b);
+			_mm_storeu_ps(dst + 12, a);
+			return;
+		}
+		const __m128 pixels[4] = { r, g, b, a };
+		for (size_t i = 0; i < 4; ++i, dst += 3)
+		{
+			_mm_storel_pi(reinterpret_cast<__m64*>(dst), pixels[i]);
+			_mm_store_ss(dst + 2, _mm_movehl_ps(pixels[i], pixels[i]));
+		}
+	}
+
+	inline __m128 clampPositivex4(__m128 v, float maxValue)
+	{
+		// max returns the second operand for NaN
+		return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(maxValue));
+	}
+
+	template<class F>
+	inline __m128 unpackSmallFloatx4(__m128i x)
+	{
+		const __m128i shifted = _mm_slli_epi32(x, F::shift);
+		const __m128 value = _mm_mul_ps(_mm_castsi128_ps(shifted), _mm_set1_ps(F::scale()));
+		const __m128 special = _mm_castsi128_ps(_mm_or_si128(shifted, _mm_set1_epi32(0x7F800000)));
+		const __m128i isSpecial = _mm_cmpeq_epi32(_mm_srli_epi32(x, F::mantissaBits), _mm_set1_epi32(31));
+		return _mm_blendv_ps(value, special, _mm_castsi128_ps(isSpecial));
+	}
+
+	template<class F>
+	inline __m128i packSmallFloatx4(__m128 v)
+	{
+		v = clampPositivex4(v, F::maxValue());
+		const __m128i bits = _mm_castps_si128(v);
+		const __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, F::shift), _mm_set1_epi32(1));
+		const __m128i rounded = _mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32((1 << (F::shift - 1)) - 1)), odd);
+		const __m128i normal = _mm_sub_epi32(_mm_srli_epi32(rounded, F::shift), _mm_set1_epi32(F::bias));
+		// the conversion rounds to nearest even (default rounding mode)
+		const __m128i denormal = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(F::denormalScale())));
+		return _mm_blendv_epi8(normal, denormal, _mm_castps_si128(_mm_cmplt_ps(v, _mm_set1_ps(F::minNormal()))));
+	}
+
+	// 2^(e - 24) for exponents as int32
+	inline __m128 sharedExpScalex4(__m128i e)
+	{
+		return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(127 - s_sharedExpBias - s_sharedMantissaBits)), 23));
+	}
+#endif
+}
+
+void image::unpackRGB9E5(const uint32_t* src, float* dst, size_t numPixels, size_t numChannels)
+{
+	assert(numChannels == 3 || numChannels == 4);
+	size_t p = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Sse41)
+	{
+		const __m128i mantissa = _mm_set1_epi32(0x1FF);
+		for (; p + 4 <= numPixels; p += 4)
+		{
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + p));
+			const __m128 scale = sharedExpScalex4(_mm_srli_epi32(x, 27));
+			const __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(x, mantissa)), scale);
+			const __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(x, 9), mantissa)), scale);
+			const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(x, 18), mantissa)), scale);
+			storeChannels(dst + p * numChannels, numChannels, r, g, b, _mm_set1_ps(1.0f));
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		::unpackRGB9E5(src[p], dst + p * numChannels);
+		if (numChannels == 4) dst[p * 4 + 3] = 1.0f;
+	}
+}
+
+void image::packRGB9E5(const float* src, uint32_t* dst, size_t numPixels, size_t numChannels)
+{
+	assert(numChannels == 3 || numChannels == 4);
+	size_t p = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Sse41)
+	{
+		for (; p + 4 <= numPixels; p += 4)
+		{
+			__m128 r, g, b, a;
+			loadChannels(src + p * numChannels, numChannels, r, g, b, a);
+			r = clampPositivex4(r, maxSharedExpValue());
+			g = clampPositivex4(g, maxSharedExpValue());
+			b = clampPositivex4(b, maxSharedExpValue());
+			const __m128 maxColor = _mm_max_ps(r, _mm_max_ps(g, b));
+			const __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxColor), 23), _mm_set1_epi32(127));
+			__m128i e = _mm_add_epi32(_mm_max_epi32(exponent, _mm_set1_epi32(-s_sharedExpBias - 1)), _mm_set1_epi32(1 + s_sharedExpBias));
+			// 2^(24 - e) and the next exponent if the largest mantissa is rounded up to 2^9
+			__m128 scale = sharedExpScalex4(_mm_sub_epi32(_mm_set1_epi32(2 * (s_sharedExpBias + s_sharedMantissaBits)), e));
+			const __m128i overflow = _mm_cmpeq_epi32(roundHalfUpx4(_mm_mul_ps(maxColor, scale)), _mm_set1_epi32(1 << s_sharedMantissaBits));
+			e = _mm_sub_epi32(e, overflow);
+			scale = _mm_blendv_ps(scale, _mm_mul_ps(scale, _mm_set1_ps(0.5f)), _mm_castsi128_ps(overflow));
+
+			__m128i res = _mm_slli_epi32(e, 27);
+			res = _mm_or_si128(res, roundHalfUpx4(_mm_mul_ps(r, scale)));
+			res = _mm_or_si128(res, _mm_slli_epi32(roundHalfUpx4(_mm_mul_ps(g, scale)), 9));
+			res = _mm_or_si128(res, _mm_slli_epi32(roundHalfUpx4(_mm_mul_ps(b, scale)), 18));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + p), res);
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		const float* pixel = src + p * numChannels;
+		dst[p] = ::packRGB9E5(pixel[0], pixel[1], pixel[2]);
+	}
+}
+
+void image::unpackRG11B10(const uint32_t* src, float* dst, size_t numPixels, size_t numChannels)
+{
+	assert(numChannels == 3 || numChannels == 4);
+	size_t p = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Sse41)
+	{
+		for (; p + 4 <= numPixels; p += 4)
+		{
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + p));
+			const __m128 r = unpackSmallFloatx4<Float11>(_mm_and_si128(x, _mm_set1_epi32(Float11::mask)));
+			const __m128 g = unpackSmallFloatx4<Float11>(_mm_and_si128(_mm_srli_epi32(x, 11), _mm_set1_epi32(Float11::mask)));
+			const __m128 b = unpackSmallFloatx4<Float10>(_mm_srli_epi32(x, 22));
+			storeChannels(dst + p * numChannels, numChannels, r, g, b, _mm_set1_ps(1.0f));
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		float* pixel = dst + p * numChannels;
+		pixel[0] = Float11::unpack(src[p] & Float11::mask);
+		pixel[1] = Float11::unpack((src[p] >> 11) & Float11::mask);
+		pixel[2] = Float10::unpack(src[p] >> 22);
+		if (numChannels == 4) pixel[3] = 1.0f;
+	}
+}
+
+void image::packRG11B10(const float* src, uint32_t* dst, size_t numPixels, size_t numChannels)
+{
+	assert(numChannels == 3 || numChannels == 4);
+	size_t p = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Sse41)
+	{
+		for (; p + 4 <= numPixels; p += 4)
+		{
+			__m128 r, g, b, a;
+			loadChannels(src + p * numChannels, numChannels, r, g, b, a);
+			__m128i res = packSmallFloatx4<Float11>(r);
+			res = _mm_or_si128(res, _mm_slli_epi32(packSmallFloatx4<Float11>(g), 11));
+			res = _mm_or_si128(res, _mm_slli_epi32(packSmallFloatx4<Float10>(b), 22));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + p), res);
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		const float* pixel = src + p * numChannels;
+		dst[p] = Float11::pack(pixel[0]) | (Float11::pack(pixel[1]) << 11) | (Float10::pack(pixel[2]) << 22);
+	}
+}
+
+void image::unpackRGB10A2(const uint32_t* src, float* dst, size_t numPixels)
+{
+	size_t p = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Sse41)
+	{
+		const __m128i mask = _mm_set1_epi32(0x3FF);
+		const __m128 colorMax = _mm_set1_ps(1023.0f);
+		for (; p + 4 <= numPixels; p += 4)
+		{
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + p));
+			const __m128 r = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(x, mask)), colorMax);
+			const __m128 g = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(x, 10), mask)), colorMax);
+			const __m128 b = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(x, 20), mask)), colorMax);
+			const __m128 a = _mm_div_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 30)), _mm_set1_ps(3.0f));
+			storeChannels(dst + p * 4, 4, r, g, b, a);
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		dst[p * 4 + 0] = float(src[p] & 0x3FF) / 1023.0f;
+		dst[p * 4 + 1] = float((src[p] >> 10) & 0x3FF) / 1023.0f;
+		dst[p * 4 + 2] = float((src[p] >> 20) & 0x3FF) / 1023.0f;
+		dst[p * 4 + 3] = float(src[p] >> 30) / 3.0f;
+	}
+}
+
+void image::packRGB10A2(const float* src, uint32_t* dst, size_t numPixels)
+{
+	size_t p = 0;
+#ifdef CONVERT_X86
+	if (getSimdLevel() >= SimdLevel::Sse41)
+	{
+		const __m128 colorMax = _mm_set1_ps(1023.0f);
+		for (; p + 4 <= numPixels; p += 4)
+		{
+			__m128 r, g, b, a;
+			loadChannels(src + p * 4, 4, r, g, b, a);
+			__m128i res = toUnormx4(r, colorMax);
+			res = _mm_or_si128(res, _mm_slli_epi32(toUnormx4(g, colorMax), 10));
+			res = _mm_or_si128(res, _mm_slli_epi32(toUnormx4(b, colorMax), 20));
+			res = _mm_or_si128(res, _mm_slli_epi32(toUnormx4(a, _mm_set1_ps(3.0f)), 30));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + p), res);
+		}
+	}
+#endif
+	for (; p < numPixels; ++p)
+	{
+		const float* pixel = src + p * 4;
+		dst[p] = toUnorm(pixel[0], 1023.0f) | (toUnorm(pixel[1], 1023.0f) << 10) | (toUnorm(pixel[2], 1023.0f) << 20) | (toUnorm(pixel[3], 3.0f) << 30);
+	}
+}
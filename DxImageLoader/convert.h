@@ -2,50 +2,209 @@
 #include <vector>
 #include <assert.h>
 #include <array>
+#include <cstdint>
 
 namespace image
 {
-	/// preforms a change of stride inplace
-	/// => byte array with 4 byte stride (RGBA) can be changed to a 2 byte stride array (RG)
-	inline size_t changeStride(uint8_t* bytes, size_t byteSize, const size_t oldStride, const size_t newStride)
+	// scalar reference implementations of the pixel shuffles below
+	namespace scalar
 	{
-		if (newStride == oldStride) return byteSize;
+		/// preforms a change of stride inplace
+		/// => byte array with 4 byte stride (RGBA) can be changed to a 2 byte stride array (RG)
+		inline size_t changeStride(uint8_t* bytes, size_t byteSize, const size_t oldStride, const size_t newStride)
+		{
+			if (newStride == oldStride) return byteSize;
 
-		assert(newStride < oldStride);
-		assert(byteSize % oldStride == 0);
-		const auto numElements = byteSize / oldStride;
-		for(size_t src = oldStride, dst = newStride; src < byteSize; src += oldStride, dst += newStride)
+			assert(newStride < oldStride);
+			assert(byteSize % oldStride == 0);
+			const auto numElements = byteSize / oldStride;
+			for(size_t src = oldStride, dst = newStride; src < byteSize; src += oldStride, dst += newStride)
+			{
+				for (size_t i = 0; i < newStride; ++i)
+					bytes[dst + i] = bytes[src + i];
+			}
+
+			return newStride * numElements;
+		}
+
+		// performs a change of stride inplace
+		// => byte array with 4 byte stride (RGBA) can be changed to 2 byte stride (RA) when using bitmask = 0b1001
+		inline void changeStrideEx(uint8_t* bytes, size_t byteSize, size_t oldStride, size_t bitmask)
 		{
-			for (size_t i = 0; i < newStride; ++i)
-				bytes[dst + i] = bytes[src + i];
+			const auto numElements = byteSize / oldStride;
+			size_t newStride = 0;
+
+			assert(oldStride <= 16);
+			std::array<uint8_t, 16> offsets;
+
+			// new stride is the number of set bits
+			for(size_t i = 0; i < oldStride; ++i)
+			{
+				size_t mask = 1ull << i;
+				if (mask & bitmask)
+					offsets[newStride++] = uint8_t(i);
+			}
+
+			for(size_t src = 0, dst = 0; src < byteSize; src += oldStride, dst += newStride)
+			{
+				for(size_t i = 0; i < newStride; ++i)
+				{
+					bytes[dst + i] = bytes[src + offsets[i]];
+				}
+			}
 		}
 
-		return newStride * numElements;
-	}
+		// same as changeStrideEx, but writes count elements to dst and leaves src unchanged
+		inline void copyStrideEx(const uint8_t* src, uint8_t* dst, size_t count, size_t oldStride, size_t bitmask)
+		{
+			assert(oldStride <= 16);
+			std::array<uint8_t, 16> offsets;
+			size_t newStride = 0;
+			for (size_t i = 0; i < oldStride; ++i)
+			{
+				if ((size_t(1) << i) & bitmask)
+					offsets[newStride++] = uint8_t(i);
+			}
 
-	// performs a change of stride inplace
-	// => byte array with 4 byte stride (RGBA) can be changed to 2 byte stride (RA) when using bitmask = 0b1001
-	inline void changeStrideEx(uint8_t* bytes, size_t byteSize, size_t oldStride, size_t bitmask)
-	{
-		const auto numElements = byteSize / oldStride;
-		size_t newStride = 0;
+			for (const auto end = src + count * oldStride; src != end; src += oldStride, dst += newStride)
+			{
+				for (size_t i = 0; i < newStride; ++i)
+					dst[i] = src[offsets[i]];
+			}
+		}
 
-		assert(oldStride <= 16);
-		std::array<uint8_t, 16> offsets;
+		template<size_t channelSize>
+		inline void copyRedToGreenBlue(uint8_t* bytes, size_t size)
+		{
+			for(auto end = bytes + size; bytes < end; bytes += 4 * channelSize)
+			{
+				size_t off = channelSize;
+				for(size_t i = 0; i < 2; ++i) // loop for green and blue
+				{
+					for(size_t j = 0 ; j < channelSize; ++j) // loop through channel size
+					{
+						bytes[off++] = bytes[j];
+					}
+				}
+			}
+		}
 
-		// new stride is the number of set bits
-		for(size_t i = 0; i < oldStride; ++i)
+		template<class T>
+		inline void expandRGBtoRGBA(T* data, size_t numPixels, T alphaValue)
 		{
-			size_t mask = 1ull << i;
-			if (mask & bitmask)
-				offsets[newStride++] = uint8_t(i);
+			T* curEnd = data + numPixels * 3;
+			T* actualEnd = data + numPixels * 4;
+			// move to last pixel
+			curEnd -= 3;
+			actualEnd -= 4;
+
+			while(curEnd >= data)
+			{
+				auto r = curEnd[0];
+				auto g = curEnd[1];
+				auto b = curEnd[2];
+				actualEnd[0] = r;
+				actualEnd[1] = g;
+				actualEnd[2] = b;
+				actualEnd[3] = alphaValue;
+
+				// move one pixel left
+				curEnd -= 3;
+				actualEnd -= 4;
+			}
+			assert(curEnd + 3 == data);
+			assert(actualEnd + 4 == data);
 		}
 
-		for(size_t src = 0, dst = 0; src < byteSize; src += oldStride, dst += newStride)
+		template<class T>
+		inline void expandRGtoRGBA(T* data, size_t numPixels, T blueValue, T alphaValue)
 		{
-			for(size_t i = 0; i < newStride; ++i)
+			T* curEnd = data + numPixels * 2;
+			T* actualEnd = data + numPixels * 4;
+			// move to last pixel
+			curEnd -= 2;
+			actualEnd -= 4;
+
+			while (curEnd >= data)
 			{
-				bytes[dst + i] = bytes[src + offsets[i]];
+				auto r = curEnd[0];
+				auto g = curEnd[1];
+				actualEnd[0] = r;
+				actualEnd[1] = g;
+				actualEnd[2] = blueValue;
+				actualEnd[3] = alphaValue;
+
+				// move one pixel left
+				curEnd -= 2;
+				actualEnd -= 4;
+			}
+			assert(curEnd + 2 == data);
+			assert(actualEnd + 4 == data);
+		}
+
+		template<class T>
+		inline void expandRtoRGBA(T* data, size_t numPixels, T alphaValue)
+		{
+			T* curEnd = data + numPixels;
+			T* actualEnd = data + numPixels * 4;
+			// move to last pixel
+			curEnd -= 1;
+			actualEnd -= 4;
+
+			while (curEnd >= data)
+			{
+				auto r = curEnd[0];
+				actualEnd[0] = r;
+				actualEnd[1] = r;
+				actualEnd[2] = r;
+				actualEnd[3] = alphaValue;
+
+				// move one pixel left
+				curEnd -= 1;
+				actualEnd -= 4;
+			}
+			assert(curEnd + 1 == data);
+			assert(actualEnd + 4 == data);
+		}
+
+		template<class T>
+		inline void expandBGRtoRGBA(T* data, size_t numPixels, T alphaValue)
+		{
+			T* curEnd = data + numPixels * 3;
+			T* actualEnd = data + numPixels * 4;
+			// move to last pixel
+			curEnd -= 3;
+			actualEnd -= 4;
+
+			while (curEnd >= data)
+			{
+				auto b = curEnd[0];
+				auto g = curEnd[1];
+				auto r = curEnd[2];
+				actualEnd[0] = r;
+				actualEnd[1] = g;
+				actualEnd[2] = b;
+				actualEnd[3] = alphaValue;
+
+				// move one pixel left
+				curEnd -= 3;
+				actualEnd -= 4;
+			}
+
+			assert(curEnd + 3 == data);
+			assert(actualEnd + 4 == data);
+		}
+
+		// swaps BGRA format to RGBA format inplace. channelSize is the size of a single pixel component (e.g. red). The image is assumed to have 4 components (RGBA)
+		template<size_t channelSize>
+		inline void swizzleBGRA(uint8_t* data, size_t size)
+		{
+			for (auto end = data + size; data < end; data += 4 * channelSize)
+			{
+				for (size_t j = 0; j < channelSize; ++j) // loop through channel size
+				{
+					std::swap(data[0 + j], data[2 * channelSize + j]);
+				}
 			}
 		}
 	}
@@ -58,138 +217,125 @@ namespace image
 		return uval[0] == 1;
 	}
 
+	// Pixel shuffles with SSE4.1 or AVX2 (NEON on arm64) byte shuffles, selected at runtime by cpuid (see convert.cpp).
+	// The global parameter "simd" limits the instruction set: 0 = scalar reference, 1 = SSE4.1/NEON, 2 = AVX2 (default)
+
+	// returns false if the scalar reference implementations should be used
+	bool useSimd();
+
+	// rearranges the channels of each RGBA pixel in place. channels[c] is the source channel of channel c. channelSize is 1, 2 or 4 bytes
+	void shuffleRGBA(uint8_t* data, size_t size, size_t channelSize, const std::array<int, 4>& channels);
+
+	// expands pixels with numChannels channels of elementSize bytes (1, 2 or 4) in place to RGBA (the buffer must hold numPixels RGBA pixels).
+	// channels[c] is the source channel of channel c or -1 for the value constants[c] (4 elements)
+	void expandToRGBA(uint8_t* data, size_t numPixels, size_t elementSize, size_t numChannels, const std::array<int, 4>& channels, const void* constants);
+
+	// same as expandToRGBA, but writes numPixels RGBA pixels to dst and leaves src unchanged
+	void copyToRGBA(const uint8_t* src, uint8_t* dst, size_t numPixels, size_t elementSize, size_t numChannels, const std::array<int, 4>& channels, const void* constants);
+
+	// writes the bytes of bitmask of count elements to dst. dst may be equal to src
+	// => byte array with 4 byte stride (RGBA) can be changed to 2 byte stride (RA) when using bitmask = 0b1001
+	void copyStrideEx(const uint8_t* src, uint8_t* dst, size_t count, size_t oldStride, size_t bitmask);
+
+	/// preforms a change of stride inplace
+	/// => byte array with 4 byte stride (RGBA) can be changed to a 2 byte stride array (RG)
+	inline size_t changeStride(uint8_t* bytes, size_t byteSize, const size_t oldStride, const size_t newStride)
+	{
+		if (newStride == oldStride) return byteSize;
+
+		assert(newStride < oldStride);
+		assert(byteSize % oldStride == 0);
+		const auto numElements = byteSize / oldStride;
+		copyStrideEx(bytes, bytes, numElements, oldStride, (size_t(1) << newStride) - 1);
+		return newStride * numElements;
+	}
+
+	// performs a change of stride inplace
+	// => byte array with 4 byte stride (RGBA) can be changed to 2 byte stride (RA) when using bitmask = 0b1001
+	inline void changeStrideEx(uint8_t* bytes, size_t byteSize, size_t oldStride, size_t bitmask)
+	{
+		copyStrideEx(bytes, bytes, byteSize / oldStride, oldStride, bitmask);
+	}
+
 	template<size_t channelSize>
 	inline void copyRedToGreenBlue(uint8_t* bytes, size_t size)
 	{
-		for(auto end = bytes + size; bytes < end; bytes += 4 * channelSize)
-		{
-			size_t off = channelSize;
-			for(size_t i = 0; i < 2; ++i) // loop for green and blue
-			{
-				for(size_t j = 0 ; j < channelSize; ++j) // loop through channel size
-				{
-					bytes[off++] = bytes[j];
-				}
-			}
-		}
+		if (!useSimd()) return scalar::copyRedToGreenBlue<channelSize>(bytes, size);
+		shuffleRGBA(bytes, size, channelSize, { 0, 0, 0, 3 });
 	}
 
 	template<class T>
 	inline void expandRGBtoRGBA(T* data, size_t numPixels, T alphaValue)
 	{
-		T* curEnd = data + numPixels * 3;
-		T* actualEnd = data + numPixels * 4;
-		// move to last pixel
-		curEnd -= 3;
-		actualEnd -= 4;
-
-		while(curEnd >= data)
-		{
-			auto r = curEnd[0];
-			auto g = curEnd[1];
-			auto b = curEnd[2];
-			actualEnd[0] = r;
-			actualEnd[1] = g;
-			actualEnd[2] = b;
-			actualEnd[3] = alphaValue;
-
-			// move one pixel left
-			curEnd -= 3;
-			actualEnd -= 4;
-		}
-		assert(curEnd + 3 == data);
-		assert(actualEnd + 4 == data);
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "unsupported element size");
+		if (!useSimd()) return scalar::expandRGBtoRGBA(data, numPixels, alphaValue);
+		const T constants[4] = { T(0), T(0), T(0), alphaValue };
+		expandToRGBA(reinterpret_cast<uint8_t*>(data), numPixels, sizeof(T), 3, { 0, 1, 2, -1 }, constants);
 	}
 
 	template<class T>
 	inline void expandRGtoRGBA(T* data, size_t numPixels, T blueValue, T alphaValue)
 	{
-		T* curEnd = data + numPixels * 2;
-		T* actualEnd = data + numPixels * 4;
-		// move to last pixel
-		curEnd -= 2;
-		actualEnd -= 4;
-
-		while (curEnd >= data)
-		{
-			auto r = curEnd[0];
-			auto g = curEnd[1];
-			actualEnd[0] = r;
-			actualEnd[1] = g;
-			actualEnd[2] = blueValue;
-			actualEnd[3] = alphaValue;
-
-			// move one pixel left
-			curEnd -= 2;
-			actualEnd -= 4;
-		}
-		assert(curEnd + 2 == data);
-		assert(actualEnd + 4 == data);
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "unsupported element size");
+		if (!useSimd()) return scalar::expandRGtoRGBA(data, numPixels, blueValue, alphaValue);
+		const T constants[4] = { T(0), T(0), blueValue, alphaValue };
+		expandToRGBA(reinterpret_cast<uint8_t*>(data), numPixels, sizeof(T), 2, { 0, 1, -1, -1 }, constants);
 	}
 
 	template<class T>
 	inline void expandRtoRGBA(T* data, size_t numPixels, T alphaValue)
 	{
-		T* curEnd = data + numPixels;
-		T* actualEnd = data + numPixels * 4;
-		// move to last pixel
-		curEnd -= 1;
-		actualEnd -= 4;
-
-		while (curEnd >= data)
-		{
-			auto r = curEnd[0];
-			actualEnd[0] = r;
-			actualEnd[1] = r;
-			actualEnd[2] = r;
-			actualEnd[3] = alphaValue;
-
-			// move one pixel left
-			curEnd -= 1;
-			actualEnd -= 4;
-		}
-		assert(curEnd + 1 == data);
-		assert(actualEnd + 4 == data);
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "unsupported element size");
+		if (!useSimd()) return scalar::expandRtoRGBA(data, numPixels, alphaValue);
+		const T constants[4] = { T(0), T(0), T(0), alphaValue };
+		expandToRGBA(reinterpret_cast<uint8_t*>(data), numPixels, sizeof(T), 1, { 0, 0, 0, -1 }, constants);
 	}
 
 	template<class T>
 	inline void expandBGRtoRGBA(T* data, size_t numPixels, T alphaValue)
 	{
-		T* curEnd = data + numPixels * 3;
-		T* actualEnd = data + numPixels * 4;
-		// move to last pixel
-		curEnd -= 3;
-		actualEnd -= 4;
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "unsupported element size");
+		if (!useSimd()) return scalar::expandBGRtoRGBA(data, numPixels, alphaValue);
+		const T constants[4] = { T(0), T(0), T(0), alphaValue };
+		expandToRGBA(reinterpret_cast<uint8_t*>(data), numPixels, sizeof(T), 3, { 2, 1, 0, -1 }, constants);
+	}
 
-		while (curEnd >= data)
-		{
-			auto b = curEnd[0];
-			auto g = curEnd[1];
-			auto r = curEnd[2];
-			actualEnd[0] = r;
-			actualEnd[1] = g;
-			actualEnd[2] = b;
-			actualEnd[3] = alphaValue;
-
-			// move one pixel left
-			curEnd -= 3;
-			actualEnd -= 4;
-		}
+	// converts count floats to half precision. Uses F16C if the cpu supports it
+	void floatToHalf(const float* src, uint16_t* dst, size_t count);
 
-		assert(curEnd + 3 == data);
-		assert(actualEnd + 4 == data);
-	}
+	// converts count half precision values to float. Uses F16C if the cpu supports it
+	void halfToFloat(const uint16_t* src, float* dst, size_t count);
+
+	// converts count integers of elementSize bytes (1, 2 or 4) to float. Normalized values are divided by the maximum of the type
+	// and clamped to -1 (same as glm::compNormalize). Uses SSE4.1 (not for unsigned 32 bit)
+	void integerToFloat(const uint8_t* src, float* dst, size_t count, size_t elementSize, bool isSigned, bool normalized);
+
+	// converts numPixels pixels with numChannels 8 bit srgb channels to linear float with a lookup table. Alpha (fourth channel) is divided by 255
+	void srgbToLinear(const uint8_t* src, float* dst, size_t numPixels, size_t numChannels);
+
+	// converts numPixels pixels with numChannels linear float channels to 8 bit srgb. The result is the correctly rounded srgb value
+	// (found with a bucket table and one threshold comparison, AVX2 gathers). Alpha (fourth channel) is rounded linearly. Values are clamped to [0, 1], NaN becomes 0
+	void linearToSrgb(const float* src, uint8_t* dst, size_t numPixels, size_t numChannels);
+
+	// converts numPixels RGBA float pixels to 16 bit unorm and writes the channels of bitmask (0b1001 => RA) to dst. Values are clamped to [0, 1] and rounded
+	// like glm::round, NaN becomes 0. bigEndian stores the most significant byte first (png). Uses SSE4.1 or AVX2
+	void floatToUnorm16(const float* src, uint8_t* dst, size_t numPixels, size_t bitmask, bool bigEndian);
+
+	// packed formats with red in the lowest bits. RGB9E5 and RG11B10 have 3 channels: numChannels = 4 adds alpha 1 when unpacking and ignores alpha when packing.
+	// Unpacking is exact (10 bit unorm is divided by 1023). Packing clamps to the range of the format (NaN becomes 0) and rounds to nearest:
+	// RGB9E5 with the shared exponent of EXT_texture_shared_exponent, RG11B10 to even, RGB10A2 like glm::round. Uses SSE4.1
+	void unpackRGB9E5(const uint32_t* src, float* dst, size_t numPixels, size_t numChannels);
+	void packRGB9E5(const float* src, uint32_t* dst, size_t numPixels, size_t numChannels);
+	void unpackRG11B10(const uint32_t* src, float* dst, size_t numPixels, size_t numChannels);
+	void packRG11B10(const float* src, uint32_t* dst, size_t numPixels, size_t numChannels);
+	void unpackRGB10A2(const uint32_t* src, float* dst, size_t numPixels);
+	void packRGB10A2(const float* src, uint32_t* dst, size_t numPixels);
 
 	// swaps BGRA format to RGBA format inplace. channelSize is the size of a single pixel component (e.g. red). The image is assumed to have 4 components (RGBA)
 	template<size_t channelSize>
 	inline void swizzleBGRA(uint8_t* data, size_t size)
 	{
-		for (auto end = data + size; data < end; data += 4 * channelSize)
-		{
-			for (size_t j = 0; j < channelSize; ++j) // loop through channel size
-			{
-				std::swap(data[0 + j], data[2 * channelSize + j]);
-			}
-		}
+		if (!useSimd()) return scalar::swizzleBGRA<channelSize>(data, size);
+		shuffleRGBA(data, size, channelSize, { 2, 1, 0, 3 });
 	}
 }
\ No newline at end of file
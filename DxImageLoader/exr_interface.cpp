@@ -4,16 +4,19 @@
 #define TINYEXR_IMPLEMENTATION
 #include "../dependencies/zlib/zlib.h"
 #include "../dependencies/tinyexr/tinyexr.h"
+#include "source.h"
+#include "trace.h"
 
 
-std::unique_ptr<image::IImage> openexr_load(const char* filename)
+std::unique_ptr<image::IImage> openexr_load(const Source& src, OperationContext& ctx)
 {
+	trace::Scope scope("openexr_load");
 	float* out = nullptr; // width * height * RGBA
 	int width = 0;
 	int height = 0;
 	const char* err = nullptr;
 
-	int ret = LoadEXR(&out, &width, &height, filename, &err);
+	int ret = LoadEXRFromMemory(&out, &width, &height, src.data(), src.size(), &err);
 	if (ret != TINYEXR_SUCCESS)
 		throw std::runtime_error(err);
 
@@ -32,3 +35,30 @@ std::unique_ptr<image::IImage> openexr_load(const char* filename)
 
 	return res;
 }
+
+image::Info openexr_probe(const char* filename)
+{
+	EXRVersion version;
+	if (ParseEXRVersionFromFile(&version, filename) != TINYEXR_SUCCESS)
+		throw std::runtime_error("invalid exr file");
+	if (version.multipart)
+		throw std::runtime_error("multipart exr files are not supported");
+
+	EXRHeader header;
+	InitEXRHeader(&header);
+	const char* err = nullptr;
+	if (ParseEXRHeaderFromFile(&header, &version, filename, &err) != TINYEXR_SUCCESS)
+	{
+		std::string msg = err ? err : "could not parse exr header";
+		FreeEXRErrorMessage(err);
+		throw std::runtime_error(msg);
+	}
+
+	image::Info info;
+	info.originalFormat = gli::format::FORMAT_RGBA32_SFLOAT_PACK32; // same as openexr_load
+	info.width = header.data_window.max_x - header.data_window.min_x + 1;
+	info.height = header.data_window.max_y - header.data_window.min_y + 1;
+
+	FreeEXRHeader(&header);
+	return info;
+}
@@ -2,4 +2,8 @@
 #include "Image.h"
 #include <memory>
 
-std::unique_ptr<image::IImage> openexr_load(const char* filename);
\ No newline at end of file
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> openexr_load(const Source& src, OperationContext& ctx);
+image::Info openexr_probe(const char* filename);
\ No newline at end of file
@@ -0,0 +1,413 @@
+#include "pch.h"
+#include "format_convert.h"
+#include "convert.h"
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+	using Kernel = image::FormatConverter::Kernel;
+
+	// component types of the specialized formats
+	enum class Kind
+	{
+		Unorm8,
+		Srgb8,
+		Uint8, // includes uscaled
+		Sint8, // includes sscaled
+		Unorm16,
+		Snorm16,
+		Uint16,
+		Sint16,
+		Sfloat16,
+		Uint32,
+		Sint32,
+		Sfloat32,
+		// packed formats (red in the lowest bits)
+		Rgb9e5,
+		Rg11b10,
+		Rgb10a2
+	};
+
+	struct Layout
+	{
+		Kind kind;
+		size_t channels;
+	};
+
+	// gli fetches the components in memory order (BGR and luminance formats are fixed by the postprocess)
+	bool getLayout(gli::format f, Layout& layout)
+	{
+		switch (f)
+		{
+		case gli::FORMAT_R8_UNORM_PACK8: case gli::FORMAT_L8_UNORM_PACK8: case gli::FORMAT_A8_UNORM_PACK8: layout = { Kind::Unorm8, 1 }; return true;
+		case gli::FORMAT_RG8_UNORM_PACK8: case gli::FORMAT_LA8_UNORM_PACK8: layout = { Kind::Unorm8, 2 }; return true;
+		case gli::FORMAT_RGB8_UNORM_PACK8: case gli::FORMAT_BGR8_UNORM_PACK8: layout = { Kind::Unorm8, 3 }; return true;
+		case gli::FORMAT_RGBA8_UNORM_PACK8: case gli::FORMAT_BGRA8_UNORM_PACK8: layout = { Kind::Unorm8, 4 }; return true;
+
+		case gli::FORMAT_R8_SRGB_PACK8: layout = { Kind::Srgb8, 1 }; return true;
+		case gli::FORMAT_RG8_SRGB_PACK8: layout = { Kind::Srgb8, 2 }; return true;
+		case gli::FORMAT_RGB8_SRGB_PACK8: case gli::FORMAT_BGR8_SRGB_PACK8: layout = { Kind::Srgb8, 3 }; return true;
+		case gli::FORMAT_RGBA8_SRGB_PACK8: case gli::FORMAT_BGRA8_SRGB_PACK8: layout = { Kind::Srgb8, 4 }; return true;
+
+		case gli::FORMAT_R8_UINT_PACK8: case gli::FORMAT_R8_USCALED_PACK8: layout = { Kind::Uint8, 1 }; return true;
+		case gli::FORMAT_RG8_UINT_PACK8: case gli::FORMAT_RG8_USCALED_PACK8: layout = { Kind::Uint8, 2 }; return true;
+		case gli::FORMAT_RGB8_UINT_PACK8: case gli::FORMAT_RGB8_USCALED_PACK8:
+		case gli::FORMAT_BGR8_UINT_PACK8: case gli::FORMAT_BGR8_USCALED_PACK8: layout = { Kind::Uint8, 3 }; return true;
+		case gli::FORMAT_RGBA8_UINT_PACK8: case gli::FORMAT_RGBA8_USCALED_PACK8:
+		case gli::FORMAT_BGRA8_UINT_PACK8: case gli::FORMAT_BGRA8_USCALED_PACK8: layout = { Kind::Uint8, 4 }; return true;
+
+		case gli::FORMAT_R8_SINT_PACK8: case gli::FORMAT_R8_SSCALED_PACK8: layout = { Kind::Sint8, 1 }; return true;
+		case gli::FORMAT_RG8_SINT_PACK8: case gli::FORMAT_RG8_SSCALED_PACK8: layout = { Kind::Sint8, 2 }; return true;
+		case gli::FORMAT_RGB8_SINT_PACK8: case gli::FORMAT_RGB8_SSCALED_PACK8:
+		case gli::FORMAT_BGR8_SINT_PACK8: case gli::FORMAT_BGR8_SSCALED_PACK8: layout = { Kind::Sint8, 3 }; return true;
+		case gli::FORMAT_RGBA8_SINT_PACK8: case gli::FORMAT_RGBA8_SSCALED_PACK8:
+		case gli::FORMAT_BGRA8_SINT_PACK8: case gli::FORMAT_BGRA8_SSCALED_PACK8: layout = { Kind::Sint8, 4 }; return true;
+
+		case gli::FORMAT_R16_UNORM_PACK16: case gli::FORMAT_L16_UNORM_PACK16: case gli::FORMAT_A16_UNORM_PACK16: layout = { Kind::Unorm16, 1 }; return true;
+		case gli::FORMAT_RG16_UNORM_PACK16: case gli::FORMAT_LA16_UNORM_PACK16: layout = { Kind::Unorm16, 2 }; return true;
+		case gli::FORMAT_RGB16_UNORM_PACK16: layout = { Kind::Unorm16, 3 }; return true;
+		case gli::FORMAT_RGBA16_UNORM_PACK16: layout = { Kind::Unorm16, 4 }; return true;
+
+		case gli::FORMAT_R16_SNORM_PACK16: layout = { Kind::Snorm16, 1 }; return true;
+		case gli::FORMAT_RG16_SNORM_PACK16: layout = { Kind::Snorm16, 2 }; return true;
+		case gli::FORMAT_RGB16_SNORM_PACK16: layout = { Kind::Snorm16, 3 }; return true;
+		case gli::FORMAT_RGBA16_SNORM_PACK16: layout = { Kind::Snorm16, 4 }; return true;
+
+		case gli::FORMAT_R16_UINT_PACK16: case gli::FORMAT_R16_USCALED_PACK16: layout = { Kind::Uint16, 1 }; return true;
+		case gli::FORMAT_RG16_UINT_PACK16: case gli::FORMAT_RG16_USCALED_PACK16: layout = { Kind::Uint16, 2 }; return true;
+		case gli::FORMAT_RGB16_UINT_PACK16: case gli::FORMAT_RGB16_USCALED_PACK16: layout = { Kind::Uint16, 3 }; return true;
+		case gli::FORMAT_RGBA16_UINT_PACK16: case gli::FORMAT_RGBA16_USCALED_PACK16: layout = { Kind::Uint16, 4 }; return true;
+
+		case gli::FORMAT_R16_SINT_PACK16: case gli::FORMAT_R16_SSCALED_PACK16: layout = { Kind::Sint16, 1 }; return true;
+		case gli::FORMAT_RG16_SINT_PACK16: case gli::FORMAT_RG16_SSCALED_PACK16: layout = { Kind::Sint16, 2 }; return true;
+		case gli::FORMAT_RGB16_SINT_PACK16: case gli::FORMAT_RGB16_SSCALED_PACK16: layout = { Kind::Sint16, 3 }; return true;
+		case gli::FORMAT_RGBA16_SINT_PACK16: case gli::FORMAT_RGBA16_SSCALED_PACK16: layout = { Kind::Sint16, 4 }; return true;
+
+		case gli::FORMAT_R16_SFLOAT_PACK16: layout = { Kind::Sfloat16, 1 }; return true;
+		case gli::FORMAT_RG16_SFLOAT_PACK16: layout = { Kind::Sfloat16, 2 }; return true;
+		case gli::FORMAT_RGB16_SFLOAT_PACK16: layout = { Kind::Sfloat16, 3 }; return true;
+		case gli::FORMAT_RGBA16_SFLOAT_PACK16: layout = { Kind::Sfloat16, 4 }; return true;
+
+		case gli::FORMAT_R32_UINT_PACK32: layout = { Kind::Uint32, 1 }; return true;
+		case gli::FORMAT_RG32_UINT_PACK32: layout = { Kind::Uint32, 2 }; return true;
+		case gli::FORMAT_RGB32_UINT_PACK32: layout = { Kind::Uint32, 3 }; return true;
+		case gli::FORMAT_RGBA32_UINT_PACK32: layout = { Kind::Uint32, 4 }; return true;
+
+		case gli::FORMAT_R32_SINT_PACK32: layout = { Kind::Sint32, 1 }; return true;
+		case gli::FORMAT_RG32_SINT_PACK32: layout = { Kind::Sint32, 2 }; return true;
+		case gli::FORMAT_RGB32_SINT_PACK32: layout = { Kind::Sint32, 3 }; return true;
+		case gli::FORMAT_RGBA32_SINT_PACK32: layout = { Kind::Sint32, 4 }; return true;
+
+		case gli::FORMAT_R32_SFLOAT_PACK32: layout = { Kind::Sfloat32, 1 }; return true;
+		case gli::FORMAT_RG32_SFLOAT_PACK32: layout = { Kind::Sfloat32, 2 }; return true;
+		case gli::FORMAT_RGB32_SFLOAT_PACK32: layout = { Kind::Sfloat32, 3 }; return true;
+		case gli::FORMAT_RGBA32_SFLOAT_PACK32: layout = { Kind::Sfloat32, 4 }; return true;
+
+		case gli::FORMAT_RGB9E5_UFLOAT_PACK32: layout = { Kind::Rgb9e5, 3 }; return true;
+		case gli::FORMAT_RG11B10_UFLOAT_PACK32: layout = { Kind::Rg11b10, 3 }; return true;
+		case gli::FORMAT_RGB10A2_UNORM_PACK32: layout = { Kind::Rgb10a2, 4 }; return true;
+		}
+		return false;
+	}
+
+	// alpha value of gli for a missing channel (1 in the destination type) given as little endian bit pattern
+	template<class T, uint32_t OneBits>
+	T getOne()
+	{
+		const uint32_t bits = OneBits;
+		T one;
+		memcpy(&one, &bits, sizeof(T));
+		return one;
+	}
+
+	constexpr std::array<int, 4> s_identity = { 0, 1, 2, 3 };
+
+	// shuffle of the source pixels with SrcChannels channels to RGBA. channels[c] is the fetched RGBA channel (missing channels are constants) of channel c
+	template<class T, size_t SrcChannels>
+	void getRGBAShuffle(const std::array<int, 4>& channels, T one, std::array<int, 4>& srcChannels, T constants[4])
+	{
+		const T fetched[4] = { T(0), T(0), T(0), one };
+		for (size_t c = 0; c < 4; ++c)
+		{
+			srcChannels[c] = channels[c] < int(SrcChannels) ? channels[c] : -1;
+			constants[c] = fetched[channels[c]];
+		}
+	}
+
+	// copies the channels of each pixel. Surplus channels are dropped, missing green and blue are 0 and a missing alpha is one.
+	// RGBA destinations are rearranged by channels
+	template<class T, size_t SrcChannels, size_t DstChannels, uint32_t OneBits>
+	void copyChannels(const uint8_t* src, uint8_t* dst, size_t numPixels, const std::array<int, 4>& channels)
+	{
+		constexpr size_t elementSize = sizeof(T);
+		if constexpr (DstChannels == 4)
+		{
+			if (SrcChannels == 4 && channels == s_identity)
+			{
+				memcpy(dst, src, numPixels * 4 * elementSize);
+				return;
+			}
+
+			std::array<int, 4> srcChannels;
+			T constants[4];
+			getRGBAShuffle<T, SrcChannels>(channels, getOne<T, OneBits>(), srcChannels, constants);
+			image::copyToRGBA(src, dst, numPixels, elementSize, SrcChannels, srcChannels, constants);
+		}
+		else if constexpr (SrcChannels == DstChannels)
+		{
+			memcpy(dst, src, numPixels * DstChannels * elementSize);
+		}
+		else if constexpr (SrcChannels > DstChannels)
+		{
+			image::copyStrideEx(src, dst, numPixels, SrcChannels * elementSize, (size_t(1) << (DstChannels * elementSize)) - 1);
+		}
+		else // R to RG or RGB, RG to RGB
+		{
+			for (const auto end = src + numPixels * SrcChannels * elementSize; src != end; src += SrcChannels * elementSize, dst += DstChannels * elementSize)
+			{
+				memcpy(dst, src, SrcChannels * elementSize);
+				memset(dst + SrcChannels * elementSize, 0, (DstChannels - SrcChannels) * elementSize);
+			}
+		}
+	}
+
+	// marks 16 bit float and 8 bit srgb components
+	struct Half { uint16_t bits; };
+	struct Srgb { uint8_t value; };
+
+	// converts the components to float in place of dst and expands them to RGBA (rearranged by channels) if DstChannels is 4
+	template<class T, bool Normalized, size_t SrcChannels, size_t DstChannels>
+	void copyToFloat(const uint8_t* src, uint8_t* dst, size_t numPixels, const std::array<int, 4>& channels)
+	{
+		static_assert(DstChannels == SrcChannels || DstChannels == 4, "channels can only be added up to RGBA");
+		const size_t count = numPixels * SrcChannels;
+		if constexpr (std::is_same<T, Half>::value)
+			image::halfToFloat(reinterpret_cast<const uint16_t*>(src), reinterpret_cast<float*>(dst), count);
+		else if constexpr (std::is_same<T, Srgb>::value)
+			image::srgbToLinear(src, reinterpret_cast<float*>(dst), numPixels, SrcChannels);
+		else
+			image::integerToFloat(src, reinterpret_cast<float*>(dst), count, sizeof(T), std::is_signed<T>::value, Normalized);
+
+		if constexpr (DstChannels == 4)
+		{
+			if (SrcChannels == 4 && channels == s_identity) return;
+			std::array<int, 4> srcChannels;
+			float constants[4];
+			getRGBAShuffle<float, SrcChannels>(channels, 1.0f, srcChannels, constants);
+			image::expandToRGBA(dst, numPixels, sizeof(float), SrcChannels, srcChannels, constants);
+		}
+	}
+
+	template<class T, uint32_t OneBits, size_t SrcChannels>
+	constexpr std::array<Kernel, 4> s_copyKernels = {
+		copyChannels<T, SrcChannels, 1, OneBits>,
+		copyChannels<T, SrcChannels, 2, OneBits>,
+		copyChannels<T, SrcChannels, 3, OneBits>,
+		copyChannels<T, SrcChannels, 4, OneBits>
+	};
+
+	template<class T, uint32_t OneBits>
+	Kernel getCopyKernel(size_t srcChannels, size_t dstChannels)
+	{
+		static constexpr std::array<std::array<Kernel, 4>, 4> kernels = {
+			s_copyKernels<T, OneBits, 1>,
+			s_copyKernels<T, OneBits, 2>,
+			s_copyKernels<T, OneBits, 3>,
+			s_copyKernels<T, OneBits, 4>
+		};
+		return kernels[srcChannels - 1][dstChannels - 1];
+	}
+
+	template<class T, bool Normalized>
+	Kernel getFloatKernel(size_t srcChannels, size_t dstChannels)
+	{
+		if (dstChannels != srcChannels && dstChannels != 4) return nullptr;
+		const bool expand = dstChannels != srcChannels;
+		switch (srcChannels)
+		{
+		case 1: return expand ? copyToFloat<T, Normalized, 1, 4> : copyToFloat<T, Normalized, 1, 1>;
+		case 2: return expand ? copyToFloat<T, Normalized, 2, 4> : copyToFloat<T, Normalized, 2, 2>;
+		case 3: return expand ? copyToFloat<T, Normalized, 3, 4> : copyToFloat<T, Normalized, 3, 3>;
+		case 4: return copyToFloat<T, Normalized, 4, 4>;
+		}
+		return nullptr;
+	}
+
+	// linear float to srgb. Surplus channels are dropped in blocks on the stack
+	template<size_t SrcChannels, size_t DstChannels>
+	void copyToSrgb(const uint8_t* src, uint8_t* dst, size_t numPixels, const std::array<int, 4>&)
+	{
+		static_assert(DstChannels <= SrcChannels, "srgb channels cannot be added");
+		auto values = reinterpret_cast<const float*>(src);
+		if constexpr (SrcChannels == DstChannels)
+		{
+			image::linearToSrgb(values, dst, numPixels, SrcChannels);
+		}
+		else
+		{
+			constexpr size_t blockPixels = 256;
+			uint8_t block[blockPixels * SrcChannels];
+			for (size_t p = 0; p < numPixels; p += blockPixels)
+			{
+				const size_t n = std::min(blockPixels, numPixels - p);
+				image::linearToSrgb(values + p * SrcChannels, block, n, SrcChannels);
+				image::copyStrideEx(block, dst + p * DstChannels, n, SrcChannels, (size_t(1) << DstChannels) - 1);
+			}
+		}
+	}
+
+	Kernel getSrgbKernel(size_t srcChannels, size_t dstChannels)
+	{
+		static constexpr Kernel kernels[4][4] = {
+			{ copyToSrgb<1, 1>, nullptr, nullptr, nullptr },
+			{ copyToSrgb<2, 1>, copyToSrgb<2, 2>, nullptr, nullptr },
+			{ copyToSrgb<3, 1>, copyToSrgb<3, 2>, copyToSrgb<3, 3>, nullptr },
+			{ copyToSrgb<4, 1>, copyToSrgb<4, 2>, copyToSrgb<4, 3>, copyToSrgb<4, 4> }
+		};
+		return kernels[srcChannels - 1][dstChannels - 1];
+	}
+
+	bool isPacked(Kind kind)
+	{
+		return kind == Kind::Rgb9e5 || kind == Kind::Rg11b10 || kind == Kind::Rgb10a2;
+	}
+
+	// packed format to 32 bit float with the same channels or RGBA
+	template<Kind K, size_t DstChannels>
+	void unpackToFloat(const uint8_t* src, uint8_t* dst, size_t numPixels, const std::array<int, 4>&)
+	{
+		auto words = reinterpret_cast<const uint32_t*>(src);
+		auto values = reinterpret_cast<float*>(dst);
+		if constexpr (K == Kind::Rgb9e5) image::unpackRGB9E5(words, values, numPixels, DstChannels);
+		else if constexpr (K == Kind::Rg11b10) image::unpackRG11B10(words, values, numPixels, DstChannels);
+		else image::unpackRGB10A2(words, values, numPixels);
+	}
+
+	// 32 bit float with the same channels or RGBA to a packed format
+	template<Kind K, size_t SrcChannels>
+	void packFromFloat(const uint8_t* src, uint8_t* dst, size_t numPixels, const std::array<int, 4>&)
+	{
+		auto values = reinterpret_cast<const float*>(src);
+		auto words = reinterpret_cast<uint32_t*>(dst);
+		if constexpr (K == Kind::Rgb9e5) image::packRGB9E5(values, words, numPixels, SrcChannels);
+		else if constexpr (K == Kind::Rg11b10) image::packRG11B10(values, words, numPixels, SrcChannels);
+		else image::packRGB10A2(values, words, numPixels);
+	}
+
+	Kernel getUnpackKernel(Kind kind, size_t dstChannels)
+	{
+		switch (kind)
+		{
+		case Kind::Rgb9e5: return dstChannels == 3 ? unpackToFloat<Kind::Rgb9e5, 3> : dstChannels == 4 ? unpackToFloat<Kind::Rgb9e5, 4> : nullptr;
+		case Kind::Rg11b10: return dstChannels == 3 ? unpackToFloat<Kind::Rg11b10, 3> : dstChannels == 4 ? unpackToFloat<Kind::Rg11b10, 4> : nullptr;
+		case Kind::Rgb10a2: return dstChannels == 4 ? unpackToFloat<Kind::Rgb10a2, 4> : nullptr;
+		default: return nullptr;
+		}
+	}
+
+	Kernel getPackKernel(Kind kind, size_t srcChannels)
+	{
+		switch (kind)
+		{
+		case Kind::Rgb9e5: return srcChannels == 3 ? packFromFloat<Kind::Rgb9e5, 3> : srcChannels == 4 ? packFromFloat<Kind::Rgb9e5, 4> : nullptr;
+		case Kind::Rg11b10: return srcChannels == 3 ? packFromFloat<Kind::Rg11b10, 3> : srcChannels == 4 ? packFromFloat<Kind::Rg11b10, 4> : nullptr;
+		case Kind::Rgb10a2: return srcChannels == 4 ? packFromFloat<Kind::Rgb10a2, 4> : nullptr;
+		default: return nullptr;
+		}
+	}
+
+	// same component type. 8 bit snorm, 16 bit float and 32 bit integers change when converted with gli (via float)
+	Kernel getCopyKernel(Kind kind, size_t srcChannels, size_t dstChannels)
+	{
+		switch (kind)
+		{
+		case Kind::Unorm8:
+		case Kind::Srgb8: return getCopyKernel<uint8_t, 0xFF>(srcChannels, dstChannels);
+		case Kind::Uint8: return getCopyKernel<uint8_t, 1>(srcChannels, dstChannels);
+		case Kind::Sint8: return getCopyKernel<int8_t, 1>(srcChannels, dstChannels);
+		case Kind::Unorm16: return getCopyKernel<uint16_t, 0xFFFF>(srcChannels, dstChannels);
+		case Kind::Uint16: return getCopyKernel<uint16_t, 1>(srcChannels, dstChannels);
+		case Kind::Sint16: return getCopyKernel<int16_t, 1>(srcChannels, dstChannels);
+		case Kind::Sfloat32: return getCopyKernel<float, 0x3F800000>(srcChannels, dstChannels);
+		default: return nullptr;
+		}
+	}
+
+	// conversion to 32 bit float
+	Kernel getFloatKernel(Kind kind, size_t srcChannels, size_t dstChannels)
+	{
+		switch (kind)
+		{
+		case Kind::Unorm8: return getFloatKernel<uint8_t, true>(srcChannels, dstChannels);
+		case Kind::Srgb8: return getFloatKernel<Srgb, false>(srcChannels, dstChannels);
+		case Kind::Uint8: return getFloatKernel<uint8_t, false>(srcChannels, dstChannels);
+		case Kind::Sint8: return getFloatKernel<int8_t, false>(srcChannels, dstChannels);
+		case Kind::Unorm16: return getFloatKernel<uint16_t, true>(srcChannels, dstChannels);
+		case Kind::Snorm16: return getFloatKernel<int16_t, true>(srcChannels, dstChannels);
+		case Kind::Uint16: return getFloatKernel<uint16_t, false>(srcChannels, dstChannels);
+		case Kind::Sint16: return getFloatKernel<int16_t, false>(srcChannels, dstChannels);
+		case Kind::Sfloat16: return getFloatKernel<Half, false>(srcChannels, dstChannels);
+		case Kind::Uint32: return getFloatKernel<uint32_t, false>(srcChannels, dstChannels);
+		case Kind::Sint32: return getFloatKernel<int32_t, false>(srcChannels, dstChannels);
+		default: return nullptr;
+		}
+	}
+}
+
+image::FormatConverter::FormatConverter(gli::format src, gli::format dst, const std::array<int, 4>& channels)
+	: m_channels(channels)
+{
+	Layout from, to;
+	if (!getLayout(src, from) || !getLayout(dst, to)) return;
+	if (channels != s_identity && to.channels != 4) return;
+
+	if (isPacked(from.kind) || isPacked(to.kind))
+	{
+		// the packed kernels do not rearrange channels
+		if (channels != s_identity) return;
+		if (to.kind == Kind::Sfloat32)
+			m_kernel = getUnpackKernel(from.kind, to.channels);
+		else if (from.kind == Kind::Sfloat32)
+			m_kernel = getPackKernel(to.kind, from.channels);
+	}
+	else if (from.kind == to.kind)
+		m_kernel = getCopyKernel(from.kind, from.channels, to.channels);
+	else if (to.kind == Kind::Sfloat32)
+		m_kernel = getFloatKernel(from.kind, from.channels, to.channels);
+	else if (from.kind == Kind::Sfloat32 && to.kind == Kind::Srgb8 && channels == s_identity)
+		m_kernel = getSrgbKernel(from.channels, to.channels);
+	if (!m_kernel) return;
+
+	m_dstChannels = to.channels;
+	// integers are always within the float range. srgb and packed destinations are clamped by their kernels
+	m_clamp = to.kind == Kind::Sfloat32 && (from.kind == Kind::Sfloat16 || from.kind == Kind::Sfloat32 || from.kind == Kind::Rg11b10);
+	if (m_clamp)
+	{
+		const auto [minClamp, maxClamp] = gli::min_max_values(dst);
+		m_min = minClamp;
+		m_max = maxClamp;
+	}
+}
+
+void image::FormatConverter::convert(const uint8_t* src, uint8_t* dst, size_t numPixels) const
+{
+	assert(m_kernel);
+	m_kernel(src, dst, numPixels, m_channels);
+	if (!m_clamp) return;
+
+	// same as gli::clamp (NaN is kept)
+	auto values = reinterpret_cast<float*>(dst);
+	for (size_t i = 0; i < numPixels; ++i, values += m_dstChannels)
+	{
+		for (size_t c = 0; c < m_dstChannels; ++c)
+		{
+			float v = values[c];
+			v = v < m_min[int(c)] ? m_min[int(c)] : v;
+			v = m_max[int(c)] < v ? m_max[int(c)] : v;
+			values[c] = v;
+		}
+	}
+}
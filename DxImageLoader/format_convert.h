@@ -0,0 +1,40 @@
+#pragma once
+#include <gli/gli.hpp>
+#include <cstdint>
+#include <array>
+
+namespace image
+{
+	// Row conversion between common uncompressed formats with kernels that are specialized per (source, destination) pair at compile time.
+	// Produces the same texels as the generic gli fetch/write conversion of convert_mod (GliImage.cpp), which remains the fallback for all other pairs
+	// (srgb is computed in double precision instead of the float pow of gli):
+	// - same component type (8/16 bit unorm, srgb, uint, sint or 32 bit float): channels are copied with byte shuffles, missing channels are 0 (alpha 1)
+	// - 8/16/32 bit integer, 16 bit unorm/snorm, 16 bit float or 8 bit srgb (lookup table) to 32 bit float with as many or 4 channels
+	// - 32 bit float to 8 bit srgb with the same or fewer channels (correctly rounded, see image::linearToSrgb)
+	// - RGB9E5, RG11B10 and RGB10A2 unorm from and to 32 bit float with the same channels or RGBA. Unlike gli (truncated mantissas, reciprocal multiplication)
+	//   the values are exact when unpacking and rounded to nearest when packing (see image::packRGB9E5)
+	// Other packed formats and 8 bit snorm (-128 is changed to -127 by gli) are not specialized
+	class FormatConverter
+	{
+	public:
+		// channels rearranges RGBA destinations in the same pass: channels[c] is the fetched channel that is written to channel c
+		// (e.g. the grayscale and BGR postprocess). Other destinations only support the identity
+		FormatConverter(gli::format src, gli::format dst, const std::array<int, 4>& channels = { 0, 1, 2, 3 });
+
+		// false if there is no specialized kernel for the format pair
+		bool isSupported() const { return m_kernel != nullptr; }
+
+		// converts numPixels tightly packed pixels. src and dst must not overlap
+		void convert(const uint8_t* src, uint8_t* dst, size_t numPixels) const;
+
+		using Kernel = void(*)(const uint8_t* src, uint8_t* dst, size_t numPixels, const std::array<int, 4>& channels);
+	private:
+		Kernel m_kernel = nullptr;
+		std::array<int, 4> m_channels;
+		// float sources are clamped to the value range of the destination like in convert_mod
+		bool m_clamp = false;
+		size_t m_dstChannels = 0;
+		gli::vec4 m_min;
+		gli::vec4 m_max;
+	};
+}
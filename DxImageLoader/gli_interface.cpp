@@ -5,15 +5,209 @@
 #include "compress_interface.h"
 #include "ktx_interface.h"
 #include "GliImage.h"
+#include "source.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
 
 
-std::unique_ptr<image::IImage> gli_load(const char* filename)
+std::unique_ptr<image::IImage> gli_load(const Source& src, OperationContext& ctx)
 {
-	auto res = std::make_unique<GliImage>(gli::load(filename));
+	trace::Scope scope("gli_load");
+	auto res = std::make_unique<GliImage>(gli::load(reinterpret_cast<const char*>(src.data()), src.size()));
 
 	if (image::isSupported(res->getFormat())) return res;
 
-	return res->convert(image::getSupportedFormat(res->getFormat()), 100);
+	return res->convertToSupported(ctx);
+}
+
+// dds file layout (see DDS_HEADER and DDS_HEADER_DXT10 of the DirectX documentation)
+namespace dds
+{
+	enum Flags : uint32_t
+	{
+		DDSD_MIPMAPCOUNT = 0x20000,
+		DDSD_DEPTH = 0x800000,
+		DDPF_FOURCC = 0x4,
+		DDSCAPS2_CUBEMAP = 0x200,
+		D3D10_RESOURCE_MISC_TEXTURECUBE = 0x4,
+	};
+
+	struct PixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t bpp;
+		uint32_t mask[4];
+	};
+
+	struct Header
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitch;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		PixelFormat format;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct Header10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t alphaFlags;
+	};
+
+	static_assert(sizeof(Header) == 124, "invalid dds header size");
+	static_assert(sizeof(Header10) == 20, "invalid dx10 header size");
+}
+
+// image info of the parsed dds header. header10 is nullptr if the file has no dx10 header
+static image::Info get_dds_info(const dds::Header& header, const dds::Header10* header10)
+{
+	const bool isDx10 = header10 != nullptr;
+	// same format lookup as gli::load_dds
+	gli::dx DX;
+	gli::format format = gli::FORMAT_UNDEFINED;
+	if (isDx10)
+		format = DX.find(gli::dx::D3DFMT_DX10, gli::dx::dxgi_format_dds(header10->dxgiFormat));
+	else if (header.format.flags & dds::DDPF_FOURCC)
+		format = DX.find(gli::dx::d3dfmt(header.format.fourCC));
+	else
+	{
+		// uncompressed formats are identified by their bit masks
+		for (int f = gli::FORMAT_FIRST; f <= gli::FORMAT_LAST; ++f)
+		{
+			const auto candidate = gli::format(f);
+			if (gli::is_compressed(candidate) || gli::block_size(candidate) * 8 != header.format.bpp) continue;
+			const auto& dxFormat = DX.translate(candidate);
+			if (dxFormat.Mask == glm::u32vec4(header.format.mask[0], header.format.mask[1], header.format.mask[2], header.format.mask[3]))
+			{
+				format = candidate;
+				break;
+			}
+		}
+	}
+
+	image::Info info;
+	info.originalFormat = format;
+	info.width = std::max<uint32_t>(header.width, 1);
+	info.height = std::max<uint32_t>(header.height, 1);
+	if (header.flags & dds::DDSD_DEPTH)
+		info.depth = std::max<uint32_t>(header.depth, 1);
+	if (header.flags & dds::DDSD_MIPMAPCOUNT)
+		info.mipmaps = std::max<uint32_t>(header.mipMapCount, 1);
+
+	uint32_t faces = (header.caps2 & dds::DDSCAPS2_CUBEMAP) ? 6 : 1;
+	if (isDx10)
+	{
+		if (header10->miscFlag & dds::D3D10_RESOURCE_MISC_TEXTURECUBE) faces = 6;
+		info.layers = std::max<uint32_t>(header10->arraySize, 1) * faces;
+	}
+	else info.layers = faces;
+
+	return info;
+}
+
+image::Info gli_probe(const char* filename)
+{
+	FILE* fp = fopen(filename, "rb");
+	if (!fp)
+		throw std::runtime_error("could not open file");
+
+	char magic[4] = {};
+	dds::Header header = {};
+	dds::Header10 header10 = {};
+	bool valid = fread(magic, sizeof(magic), 1, fp) == 1 && strncmp(magic, "DDS ", 4) == 0
+		&& fread(&header, sizeof(header), 1, fp) == 1;
+	const bool isDx10 = valid && (header.format.flags & dds::DDPF_FOURCC) && header.format.fourCC == gli::dx::D3DFMT_DX10;
+	if (isDx10)
+		valid = fread(&header10, sizeof(header10), 1, fp) == 1;
+	fclose(fp);
+
+	if (!valid)
+		throw std::runtime_error("invalid dds header");
+
+	return get_dds_info(header, isDx10 ? &header10 : nullptr);
+}
+
+std::unique_ptr<image::IImage> gli_load_region(const Source& src, image::Region& region, OperationContext& ctx)
+{
+	trace::Scope scope("gli_load_region");
+	const uint8_t* data = src.data();
+	dds::Header header = {};
+	dds::Header10 header10 = {};
+	if (src.size() < 4 + sizeof(header) || memcmp(data, "DDS ", 4) != 0)
+		throw std::runtime_error("invalid dds header");
+	memcpy(&header, data + 4, sizeof(header));
+	size_t offset = 4 + sizeof(header);
+
+	const bool isDx10 = (header.format.flags & dds::DDPF_FOURCC) && header.format.fourCC == gli::dx::D3DFMT_DX10;
+	if (isDx10)
+	{
+		if (src.size() < offset + sizeof(header10))
+			throw std::runtime_error("invalid dds header");
+		memcpy(&header10, data + offset, sizeof(header10));
+		offset += sizeof(header10);
+	}
+
+	const auto info = get_dds_info(header, isDx10 ? &header10 : nullptr);
+	const gli::format format = info.originalFormat;
+	// volume textures are decoded completely and cropped by the caller
+	if (format == gli::FORMAT_UNDEFINED || info.depth != 1)
+		return gli_load(src, ctx);
+
+	const auto mipWidth = [&](uint32_t mip) { return std::max(info.width >> mip, 1u); };
+	const auto mipHeight = [&](uint32_t mip) { return std::max(info.height >> mip, 1u); };
+	image::checkRegion(region, info.layers, info.mipmaps, mipWidth(region.mipmap), mipHeight(region.mipmap));
+
+	// surfaces are stored layer by layer (faces count as layers), each with all mipmaps
+	const auto blockExtent = gli::block_extent(format);
+	const size_t blockSize = gli::block_size(format);
+	const auto rowPitch = [&](uint32_t mip) { return size_t((mipWidth(mip) + blockExtent.x - 1) / blockExtent.x) * blockSize; };
+	const auto surfaceSize = [&](uint32_t mip) { return rowPitch(mip) * size_t((mipHeight(mip) + blockExtent.y - 1) / blockExtent.y); };
+
+	size_t layerSize = 0;
+	for (uint32_t mip = 0; mip < info.mipmaps; ++mip)
+		layerSize += surfaceSize(mip);
+	offset += region.layer * layerSize;
+	for (uint32_t mip = 0; mip < region.mipmap; ++mip)
+		offset += surfaceSize(mip);
+	if (offset > src.size() || src.size() - offset < surfaceSize(region.mipmap))
+		throw std::runtime_error("unexpected end of file");
+
+	// copy only the blocks that cover the region
+	const uint32_t firstBlockX = region.x / blockExtent.x;
+	const uint32_t firstBlockY = region.y / blockExtent.y;
+	const uint32_t endBlockX = (region.x + region.width + blockExtent.x - 1) / blockExtent.x;
+	const uint32_t endBlockY = (region.y + region.height + blockExtent.y - 1) / blockExtent.y;
+
+	gli::texture2d tex(format, gli::extent2d((endBlockX - firstBlockX) * blockExtent.x, (endBlockY - firstBlockY) * blockExtent.y), 1);
+	const size_t dstPitch = (endBlockX - firstBlockX) * blockSize;
+	auto dst = reinterpret_cast<uint8_t*>(tex.data());
+	for (uint32_t by = firstBlockY; by < endBlockY; ++by)
+	{
+		memcpy(dst, data + offset + by * rowPitch(region.mipmap) + firstBlockX * blockSize, dstPitch);
+		dst += dstPitch;
+	}
+
+	region = { 0, 0, region.x - firstBlockX * blockExtent.x, region.y - firstBlockY * blockExtent.y, region.width, region.height };
+
+	auto res = std::make_unique<GliImage>(tex);
+	if (image::isSupported(res->getFormat())) return res;
+
+	return res->convertToSupported(ctx);
 }
 
 std::vector<uint32_t> dds_get_export_formats()
@@ -28,21 +222,21 @@ std::vector<uint32_t> dds_get_export_formats()
 	// gli swizzling gli::format::FORMAT_B5G6R5_UNORM_PACK16,
 	// gli swizzling gli::format::FORMAT_BGR5A1_UNORM_PACK16,
 	gli::format::FORMAT_R8_UNORM_PACK8,
-	gli::format::FORMAT_R8_SNORM_PACK8,
-	gli::FORMAT_R8_UINT_PACK8,
+	gli::format::FORMAT_R8_SNORM_PACK8,
+	gli::FORMAT_R8_UINT_PACK8,
 	gli::FORMAT_R8_SINT_PACK8,
 	gli::format::FORMAT_RG8_UNORM_PACK8,
 	gli::format::FORMAT_RG8_SNORM_PACK8,
-	gli::FORMAT_RG8_UINT_PACK8,
+	gli::FORMAT_RG8_UINT_PACK8,
 	gli::FORMAT_RG8_SINT_PACK8,
 	gli::format::FORMAT_RGBA8_UNORM_PACK8,
 	gli::format::FORMAT_RGBA8_SNORM_PACK8,
 	gli::format::FORMAT_RGBA8_SRGB_PACK8,
-	gli::FORMAT_RGBA8_UINT_PACK8,
+	gli::FORMAT_RGBA8_UINT_PACK8,
 	gli::FORMAT_RGBA8_SINT_PACK8,
 	// gli swizzling gli::format::FORMAT_BGRA8_UNORM_PACK8,
 	// gli swizzling gli::format::FORMAT_BGRA8_SRGB_PACK8,
-		//gli::FORMAT_BGR8_UINT_PACK8,
+		//gli::FORMAT_BGR8_UINT_PACK8,
 		//gli::FORMAT_BGR8_SINT_PACK8,
 	gli::format::FORMAT_RGB10A2_UNORM_PACK32,
 	// this format does not work correctly for some reason
@@ -52,29 +246,29 @@ std::vector<uint32_t> dds_get_export_formats()
 	gli::format::FORMAT_R16_UNORM_PACK16,
 	gli::format::FORMAT_R16_SNORM_PACK16,
 	gli::format::FORMAT_R16_SFLOAT_PACK16,
-	gli::FORMAT_R16_UINT_PACK16,
+	gli::FORMAT_R16_UINT_PACK16,
 	gli::FORMAT_R16_SINT_PACK16,
 	gli::format::FORMAT_RG16_UNORM_PACK16,
 	gli::format::FORMAT_RG16_SNORM_PACK16,
 	gli::format::FORMAT_RG16_SFLOAT_PACK16,
-	gli::FORMAT_RG16_UINT_PACK16,
+	gli::FORMAT_RG16_UINT_PACK16,
 	gli::FORMAT_RG16_SINT_PACK16,
 	gli::format::FORMAT_RGBA16_UNORM_PACK16,
 	gli::format::FORMAT_RGBA16_SNORM_PACK16,
 	gli::format::FORMAT_RGBA16_SFLOAT_PACK16,
-	gli::FORMAT_RGBA16_UINT_PACK16,
+	gli::FORMAT_RGBA16_UINT_PACK16,
 	gli::FORMAT_RGBA16_SINT_PACK16,
 	gli::format::FORMAT_R32_SFLOAT_PACK32,
-	gli::FORMAT_R32_UINT_PACK32,
+	gli::FORMAT_R32_UINT_PACK32,
 	gli::FORMAT_R32_SINT_PACK32,
 	gli::format::FORMAT_RG32_SFLOAT_PACK32,
-	gli::FORMAT_RG32_UINT_PACK32,
+	gli::FORMAT_RG32_UINT_PACK32,
 	gli::FORMAT_RG32_SINT_PACK32,
 	gli::format::FORMAT_RGB32_SFLOAT_PACK32,
-	gli::FORMAT_RGB32_UINT_PACK32,
+	gli::FORMAT_RGB32_UINT_PACK32,
 	gli::FORMAT_RGB32_SINT_PACK32,
 	gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-	gli::FORMAT_RGBA32_UINT_PACK32,
+	gli::FORMAT_RGBA32_UINT_PACK32,
 	gli::FORMAT_RGBA32_SINT_PACK32,
 	gli::format::FORMAT_RG11B10_UFLOAT_PACK32,
 	gli::format::FORMAT_RGB9E5_UFLOAT_PACK32,
@@ -83,84 +277,84 @@ std::vector<uint32_t> dds_get_export_formats()
 	// DXT
 	gli::format::FORMAT_RGBA_DXT1_UNORM_BLOCK8,
 	gli::format::FORMAT_RGBA_DXT1_SRGB_BLOCK8,
-	gli::format::FORMAT_RGBA_DXT3_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_DXT3_UNORM_BLOCK16,
 	gli::format::FORMAT_RGBA_DXT3_SRGB_BLOCK16,
 	gli::format::FORMAT_RGBA_DXT5_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_DXT5_UNORM_BLOCK16,
-	gli::format::FORMAT_R_ATI1N_UNORM_BLOCK8,
-	gli::format::FORMAT_R_ATI1N_SNORM_BLOCK8,
-	gli::format::FORMAT_RG_ATI2N_UNORM_BLOCK16,
-	gli::format::FORMAT_RG_ATI2N_SNORM_BLOCK16,
-	gli::format::FORMAT_RGB_BP_UFLOAT_BLOCK16,
-	gli::format::FORMAT_RGB_BP_SFLOAT_BLOCK16,
-	gli::format::FORMAT_RGBA_BP_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_BP_SRGB_BLOCK16,
-	/*gli::format::FORMAT_RGB_ETC2_UNORM_BLOCK8,
-	gli::format::FORMAT_RGB_ETC2_SRGB_BLOCK8,
-	gli::format::FORMAT_RGBA_ETC2_UNORM_BLOCK8,
-	gli::format::FORMAT_RGBA_ETC2_SRGB_BLOCK8,
-	gli::format::FORMAT_RGBA_ETC2_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ETC2_SRGB_BLOCK16,
-	gli::format::FORMAT_R_EAC_UNORM_BLOCK8,
-	gli::format::FORMAT_R_EAC_SNORM_BLOCK8,
-	gli::format::FORMAT_RG_EAC_UNORM_BLOCK16,
-	gli::format::FORMAT_RG_EAC_SNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_4X4_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_5X4_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_5X4_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_5X5_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_5X5_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_6X5_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_6X5_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_6X6_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_6X6_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_8X5_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_8X5_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_8X6_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_8X6_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_8X8_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_8X8_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X5_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X5_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X6_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X6_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X8_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X8_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X10_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_10X10_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_12X10_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_12X10_SRGB_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_12X12_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ASTC_12X12_SRGB_BLOCK16,
-	gli::format::FORMAT_RGB_PVRTC1_8X8_UNORM_BLOCK32,
-	gli::format::FORMAT_RGB_PVRTC1_8X8_SRGB_BLOCK32,
-	gli::format::FORMAT_RGB_PVRTC1_16X8_UNORM_BLOCK32,
-	gli::format::FORMAT_RGB_PVRTC1_16X8_SRGB_BLOCK32,
-	gli::format::FORMAT_RGBA_PVRTC1_8X8_UNORM_BLOCK32,
-	gli::format::FORMAT_RGBA_PVRTC1_8X8_SRGB_BLOCK32,
-	gli::format::FORMAT_RGBA_PVRTC1_16X8_UNORM_BLOCK32,
-	gli::format::FORMAT_RGBA_PVRTC1_16X8_SRGB_BLOCK32,
-	gli::format::FORMAT_RGBA_PVRTC2_4X4_UNORM_BLOCK8,
-	gli::format::FORMAT_RGBA_PVRTC2_4X4_SRGB_BLOCK8,
-	gli::format::FORMAT_RGBA_PVRTC2_8X4_UNORM_BLOCK8,
-	gli::format::FORMAT_RGBA_PVRTC2_8X4_SRGB_BLOCK8,
-	gli::format::FORMAT_RGB_ETC_UNORM_BLOCK8,
-	gli::format::FORMAT_RGB_ATC_UNORM_BLOCK8,
-	gli::format::FORMAT_RGBA_ATCA_UNORM_BLOCK16,
-	gli::format::FORMAT_RGBA_ATCI_UNORM_BLOCK16,
-	gli::format::FORMAT_L8_UNORM_PACK8,
-	
-	gli::format::FORMAT_LA8_UNORM_PACK8,
-	gli::format::FORMAT_L16_UNORM_PACK16,
-	gli::format::FORMAT_LA16_UNORM_PACK16,
+	gli::format::FORMAT_RGBA_DXT5_UNORM_BLOCK16,
+	gli::format::FORMAT_R_ATI1N_UNORM_BLOCK8,
+	gli::format::FORMAT_R_ATI1N_SNORM_BLOCK8,
+	gli::format::FORMAT_RG_ATI2N_UNORM_BLOCK16,
+	gli::format::FORMAT_RG_ATI2N_SNORM_BLOCK16,
+	gli::format::FORMAT_RGB_BP_UFLOAT_BLOCK16,
+	gli::format::FORMAT_RGB_BP_SFLOAT_BLOCK16,
+	gli::format::FORMAT_RGBA_BP_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_BP_SRGB_BLOCK16,
+	/*gli::format::FORMAT_RGB_ETC2_UNORM_BLOCK8,
+	gli::format::FORMAT_RGB_ETC2_SRGB_BLOCK8,
+	gli::format::FORMAT_RGBA_ETC2_UNORM_BLOCK8,
+	gli::format::FORMAT_RGBA_ETC2_SRGB_BLOCK8,
+	gli::format::FORMAT_RGBA_ETC2_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ETC2_SRGB_BLOCK16,
+	gli::format::FORMAT_R_EAC_UNORM_BLOCK8,
+	gli::format::FORMAT_R_EAC_SNORM_BLOCK8,
+	gli::format::FORMAT_RG_EAC_UNORM_BLOCK16,
+	gli::format::FORMAT_RG_EAC_SNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_4X4_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_5X4_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_5X4_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_5X5_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_5X5_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_6X5_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_6X5_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_6X6_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_6X6_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_8X5_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_8X5_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_8X6_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_8X6_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_8X8_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_8X8_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X5_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X5_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X6_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X6_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X8_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X8_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X10_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_10X10_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_12X10_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_12X10_SRGB_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_12X12_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ASTC_12X12_SRGB_BLOCK16,
+	gli::format::FORMAT_RGB_PVRTC1_8X8_UNORM_BLOCK32,
+	gli::format::FORMAT_RGB_PVRTC1_8X8_SRGB_BLOCK32,
+	gli::format::FORMAT_RGB_PVRTC1_16X8_UNORM_BLOCK32,
+	gli::format::FORMAT_RGB_PVRTC1_16X8_SRGB_BLOCK32,
+	gli::format::FORMAT_RGBA_PVRTC1_8X8_UNORM_BLOCK32,
+	gli::format::FORMAT_RGBA_PVRTC1_8X8_SRGB_BLOCK32,
+	gli::format::FORMAT_RGBA_PVRTC1_16X8_UNORM_BLOCK32,
+	gli::format::FORMAT_RGBA_PVRTC1_16X8_SRGB_BLOCK32,
+	gli::format::FORMAT_RGBA_PVRTC2_4X4_UNORM_BLOCK8,
+	gli::format::FORMAT_RGBA_PVRTC2_4X4_SRGB_BLOCK8,
+	gli::format::FORMAT_RGBA_PVRTC2_8X4_UNORM_BLOCK8,
+	gli::format::FORMAT_RGBA_PVRTC2_8X4_SRGB_BLOCK8,
+	gli::format::FORMAT_RGB_ETC_UNORM_BLOCK8,
+	gli::format::FORMAT_RGB_ATC_UNORM_BLOCK8,
+	gli::format::FORMAT_RGBA_ATCA_UNORM_BLOCK16,
+	gli::format::FORMAT_RGBA_ATCI_UNORM_BLOCK16,
+	gli::format::FORMAT_L8_UNORM_PACK8,
+	
+	gli::format::FORMAT_LA8_UNORM_PACK8,
+	gli::format::FORMAT_L16_UNORM_PACK16,
+	gli::format::FORMAT_LA16_UNORM_PACK16,
 	*/
 	};
 }
 
 
 
-void gli_save_image(const char* filename, GliImage& image, gli::format format, bool ktx, int quality)
+void gli_save_image(const char* filename, const GliImage& image, gli::format format, bool ktx, int quality, OperationContext& ctx)
 {
 
 	if(image.getFormat() == format)
@@ -170,7 +364,7 @@ void gli_save_image(const char* filename, GliImage& image, gli::format format, b
 		return;
 	}
 
-	auto res = image.convert(format, quality);
+	auto res = image.convert(format, quality, ctx);
 	if (ktx) res->saveKtx(filename);
 	else res->saveDds(filename);
 }
@@ -3,11 +3,19 @@
 #include "Image.h"
 #include "GliImage.h"
 
-std::unique_ptr<image::IImage> gli_load(const char* filename);
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> gli_load(const Source& src, OperationContext& ctx);
+// copies the blocks that cover the region and decodes only those (volume textures are decoded completely).
+// region is updated to the position of the requested pixels in the returned image
+std::unique_ptr<image::IImage> gli_load_region(const Source& src, image::Region& region, OperationContext& ctx);
+// reads the dds header without loading the texture data
+image::Info gli_probe(const char* filename);
 
 std::vector<uint32_t> dds_get_export_formats();
 
-void gli_save_image(const char* filename, GliImage& image, gli::format format, bool ktx, int quality);
+void gli_save_image(const char* filename, const GliImage& image, gli::format format, bool ktx, int quality, OperationContext& ctx);
 
 gli::format get_format_from_GL(uint32_t internalFormat, uint32_t externalFormat, uint32_t type);
 uint32_t get_gl_format(gli::format format);
\ No newline at end of file
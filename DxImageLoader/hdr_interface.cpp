@@ -4,48 +4,91 @@
 
 #include "convert.h"
 #include "../dependencies/hdr/rgbe.h"
+#include "source.h"
+#include "trace.h"
+#include <fstream>
+#include <algorithm>
 
-std::unique_ptr<image::IImage> hdr_load(const char* filename)
+std::unique_ptr<image::IImage> hdr_load(const Source& src, OperationContext& ctx)
 {
+	trace::Scope scope("hdr_load");
 	std::unique_ptr<image::IImage> res;
-	FILE* fp = fopen(filename, "rb");
-	if (!fp)
-		throw std::runtime_error("could not open file");
+	rgbe_input in = { src.data(), src.size(), 0 };
 
 	int width, heigth;
 	rgbe_header_info header;
-	try
-	{
-		RGBE_ReadHeader(fp, &width, &heigth, &header);
+	RGBE_ReadHeader(&in, &width, &heigth, &header);
 
-		// create file (add alpha channel for staging purposes)
-		res.reset(new image::SimpleImage(
-			gli::format::FORMAT_RGB32_SFLOAT_PACK32,
-			gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-			width, heigth, 4 * 4
-		));
+	// create file (add alpha channel for staging purposes)
+	res.reset(new image::SimpleImage(
+		gli::format::FORMAT_RGB32_SFLOAT_PACK32,
+		gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
+		width, heigth, 4 * 4
+	));
 
-		
-		size_t dataSize = 0;
-		auto dataPtr = res->getData(0, 0, dataSize);
-		float* floatPtr = reinterpret_cast<float*>(dataPtr);
-		RGBE_ReadPixels_RLE(fp, floatPtr, width, heigth);
+	
+	size_t dataSize = 0;
+	auto dataPtr = res->getData(0, 0, dataSize);
+	float* floatPtr = reinterpret_cast<float*>(dataPtr);
+	RGBE_ReadPixels_RLE(&in, floatPtr, width, heigth, ctx);
 
-		// fix alignment
-		image::expandRGBtoRGBA(floatPtr, width * heigth, 1.0f);
+	// fix alignment
+	image::expandRGBtoRGBA(floatPtr, width * heigth, 1.0f);
 
-		// TODO handle gamma and exposure parameters
-	}
-	catch(...)
-	{
-		fclose(fp);
-		throw;
-	}
-	fclose(fp);
+	// TODO handle gamma and exposure parameters
 
 	return res;
 }
 
+std::unique_ptr<image::IImage> hdr_load_region(const Source& src, image::Region& region, OperationContext& ctx)
+{
+	trace::Scope scope("hdr_load_region");
+	rgbe_input in = { src.data(), src.size(), 0 };
+
+	int width, heigth;
+	rgbe_header_info header;
+	RGBE_ReadHeader(&in, &width, &heigth, &header);
+	image::checkRegion(region, 1, 1, width, heigth);
+
+	auto res = std::make_unique<image::SimpleImage>(
+		gli::format::FORMAT_RGB32_SFLOAT_PACK32,
+		gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
+		region.width, region.height, 4 * 4
+	);
+
+	size_t dataSize = 0;
+	float* floatPtr = reinterpret_cast<float*>(res->getData(0, 0, dataSize));
+	RGBE_ReadPixels_RLE_Region(&in, floatPtr, width, region.y, region.height, region.x, region.width, ctx);
+
+	// fix alignment
+	image::expandRGBtoRGBA(floatPtr, size_t(region.width) * region.height, 1.0f);
+
+	region = { 0, 0, 0, 0, region.width, region.height };
+	return res;
+}
+
+image::Info hdr_probe(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("could not open file");
+
+	// the header is a few text lines at the start of the file
+	std::vector<uint8_t> buffer(64 * 1024);
+	file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+	rgbe_input in = { buffer.data(), size_t(file.gcount()), 0 };
+
+	image::Info info;
+	int width, heigth;
+	rgbe_header_info header;
+	RGBE_ReadHeader(&in, &width, &heigth, &header);
+
+	info.originalFormat = gli::format::FORMAT_RGB32_SFLOAT_PACK32;
+	info.width = width;
+	info.height = heigth;
+	return info;
+}
+
 std::vector<uint32_t> hdr_get_export_formats()
 {
 	return {
@@ -53,16 +96,16 @@ std::vector<uint32_t> hdr_get_export_formats()
 	};
 }
 
-void hdr_write(image::IImage& image, const char* filename)
+void hdr_write(const image::IImage& image, const char* filename, OperationContext& ctx)
 {
-	if(image.getFormat() != gli::FORMAT_RGBA32_SFLOAT_PACK32)
-		throw std::runtime_error("expected RGBA32F image format for hdr export");
+	if(image.getFormat() != gli::FORMAT_RGBA32_SFLOAT_PACK32 && image.getFormat() != gli::FORMAT_RGBA16_SFLOAT_PACK16)
+		throw std::runtime_error("expected RGBA32F or RGBA16F image format for hdr export");
 
+	const bool isHalf = image.getFormat() == gli::FORMAT_RGBA16_SFLOAT_PACK16;
+	const uint32_t width = image.getWidth(0);
+	const uint32_t height = image.getHeight(0);
 	size_t dataSize = 0;
-	auto dataPtr = image.getData(0, 0, dataSize);
-
-	// adjust stride of RGBA float data to RGB float
-	image::changeStride(dataPtr, dataSize, 16, 12);
+	const uint8_t* data = image.getData(0, 0, dataSize);
 
 	FILE* fp = fopen(filename, "wb");
 	if (!fp)
@@ -70,10 +113,34 @@ void hdr_write(image::IImage& image, const char* filename)
 
 	try
 	{
-		RGBE_WriteHeader(fp, image.getWidth(0), image.getHeight(0), nullptr);
+		RGBE_WriteHeader(fp, width, height, nullptr);
+
+		// the rgbe encoder expects RGB float values => convert blocks of scanlines into a scratch buffer.
+		// The encoder works on whole scanlines, so the blocks can be written one after another
+		const uint32_t blockRows = std::max<uint32_t>(1, (1u << 16) / std::max<uint32_t>(width, 1));
+		const size_t blockPixels = size_t(width) * std::min(blockRows, height);
+		std::vector<float> rgba(isHalf ? blockPixels * 4 : 0);
+		std::vector<float> rgb(blockPixels * 3);
+		for (uint32_t y = 0; y < height; y += blockRows)
+		{
+			const uint32_t numRows = std::min(blockRows, height - y);
+			const size_t numPixels = size_t(numRows) * width;
+			const size_t first = size_t(y) * width * 4;
+			const float* src = reinterpret_cast<const float*>(data) + first;
+			if (isHalf)
+			{
+				image::halfToFloat(reinterpret_cast<const uint16_t*>(data) + first, rgba.data(), numPixels * 4);
+				src = rgba.data();
+			}
+			for (size_t i = 0; i < numPixels; ++i)
+			{
+				rgb[i * 3] = src[i * 4];
+				rgb[i * 3 + 1] = src[i * 4 + 1];
+				rgb[i * 3 + 2] = src[i * 4 + 2];
+			}
 
-		auto floatPtr = reinterpret_cast<float*>(dataPtr);
-		RGBE_WritePixels_RLE(fp, floatPtr, image.getWidth(0), image.getHeight(0));
+			RGBE_WritePixels_RLE(fp, rgb.data(), width, numRows, ctx);
+		}
 	}
 	catch(...)
 	{
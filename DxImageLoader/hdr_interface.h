@@ -2,8 +2,15 @@
 #include <memory>
 #include "Image.h"
 
-std::unique_ptr<image::IImage> hdr_load(const char* filename);
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> hdr_load(const Source& src, OperationContext& ctx);
+// decodes the scanlines up to the end of the region and keeps only the region.
+// region is updated to the position of the requested pixels in the returned image
+std::unique_ptr<image::IImage> hdr_load_region(const Source& src, image::Region& region, OperationContext& ctx);
+image::Info hdr_probe(const char* filename);
 
 std::vector<uint32_t> hdr_get_export_formats();
 
-void hdr_write(image::IImage& image, const char* filename);
\ No newline at end of file
+void hdr_write(const image::IImage& image, const char* filename, OperationContext& ctx);
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "pch.h"
+#include "image_store.h"
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "GliImage.h"
+#include "interface.h"
+#include "../dependencies/zlib/zlib.h"
+
+// size of the buffer that holds compressed data while writing and reading the scratch file
+static const size_t s_chunkSize = 1 << 20;
+
+static std::string create_scratch_file()
+{
+	char path[MAX_PATH];
+	char filename[MAX_PATH];
+	const DWORD length = GetTempPathA(MAX_PATH, path);
+	if (length == 0 || length > MAX_PATH || GetTempFileNameA(path, "img", 0, filename) == 0)
+		throw std::runtime_error("could not create scratch file");
+	return filename;
+}
+
+SpilledImage::SpilledImage(const image::IImage& image) :
+	m_format(image.getFormat()),
+	m_original(image.getOriginalFormat()),
+	m_numLayers(image.getNumLayers()),
+	m_numFaces(1),
+	m_numMipmaps(image.getNumMipmaps()),
+	m_width(image.getWidth(0)),
+	m_height(image.getHeight(0)),
+	m_depth(image.getDepth(0))
+{
+	// keep the cube map faces of dds and ktx images
+	if (auto gliImage = dynamic_cast<const GliImageBase*>(&image))
+		m_numFaces = gliImage->getNumFaces();
+
+	m_filename = create_scratch_file();
+	try
+	{
+		std::ofstream file(m_filename, std::ios::binary | std::ios::trunc);
+		if (!file)
+			throw std::runtime_error("could not open scratch file");
+
+		// the data is fast to compress (and to read back) compared to the disk bandwidth
+		z_stream stream = {};
+		if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK)
+			throw std::runtime_error("could not initialize compression");
+
+		std::vector<uint8_t> chunk(s_chunkSize);
+		auto write = [&](int flush)
+		{
+			do
+			{
+				stream.next_out = chunk.data();
+				stream.avail_out = uInt(chunk.size());
+				deflate(&stream, flush);
+				file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() - stream.avail_out);
+			} while (stream.avail_out == 0);
+		};
+
+		for (uint32_t layer = 0; layer < m_numLayers; ++layer)
+			for (uint32_t mip = 0; mip < m_numMipmaps; ++mip)
+			{
+				size_t size;
+				auto data = image.getData(layer, mip, size);
+				// zlib counts in 32 bit => feed large mipmaps in parts
+				for (size_t offset = 0; offset < size; offset += s_chunkSize)
+				{
+					stream.next_in = const_cast<Bytef*>(data + offset);
+					stream.avail_in = uInt(std::min(s_chunkSize, size - offset));
+					write(Z_NO_FLUSH);
+				}
+			}
+		write(Z_FINISH);
+		deflateEnd(&stream);
+
+		if (!file)
+			throw std::runtime_error("could not write scratch file");
+	}
+	catch (...)
+	{
+		DeleteFileA(m_filename.c_str());
+		throw;
+	}
+}
+
+SpilledImage::~SpilledImage()
+{
+	DeleteFileA(m_filename.c_str());
+}
+
+std::unique_ptr<image::IImage> SpilledImage::load() const
+{
+	std::ifstream file(m_filename, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("could not open scratch file");
+
+	auto res = std::make_unique<GliImage>(m_format, m_original, m_numLayers / m_numFaces, m_numFaces, m_numMipmaps, m_width, m_height, m_depth);
+
+	z_stream stream = {};
+	if (inflateInit(&stream) != Z_OK)
+		throw std::runtime_error("could not initialize decompression");
+
+	std::vector<uint8_t> chunk(s_chunkSize);
+	try
+	{
+		for (uint32_t layer = 0; layer < m_numLayers; ++layer)
+			for (uint32_t mip = 0; mip < m_numMipmaps; ++mip)
+			{
+				size_t size;
+				auto data = res->getData(layer, mip, size);
+				for (size_t offset = 0; offset < size;)
+				{
+					if (stream.avail_in == 0)
+					{
+						file.read(reinterpret_cast<char*>(chunk.data()), chunk.size());
+						stream.next_in = chunk.data();
+						stream.avail_in = uInt(file.gcount());
+						if (stream.avail_in == 0)
+							throw std::runtime_error("unexpected end of scratch file");
+					}
+
+					stream.next_out = data + offset;
+					stream.avail_out = uInt(std::min(s_chunkSize, size - offset));
+					const uInt requested = stream.avail_out;
+					const int status = inflate(&stream, Z_NO_FLUSH);
+					if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+						throw std::runtime_error("corrupted scratch file");
+					offset += requested - stream.avail_out;
+					if (status == Z_STREAM_END && offset < size)
+						throw std::runtime_error("unexpected end of scratch file");
+				}
+			}
+	}
+	catch (...)
+	{
+		inflateEnd(&stream);
+		throw;
+	}
+	inflateEnd(&stream);
+
+	return res;
+}
+
+void ImageStore::insert(int id, std::shared_ptr<image::IImage> image)
+{
+	{
+		std::lock_guard<std::mutex> g(m_mutex);
+		auto& e = m_entries[id];
+		e.spilled.reset();
+		e.spilling = false; // a running spill of the previous image is discarded
+		e.image = std::move(image);
+		if (e.pinCount) e.image->setPinned(true);
+		e.memorySize = e.image->getMemorySize();
+		e.lastAccess = ++m_accessCounter;
+	}
+	applyBudget(id);
+}
+
+void ImageStore::erase(int id)
+{
+	std::lock_guard<std::mutex> g(m_mutex);
+	auto it = m_entries.find(id);
+	if (it != m_entries.end())
+		m_entries.erase(it);
+}
+
+std::shared_ptr<image::IImage> ImageStore::find(int id)
+{
+	std::shared_ptr<image::IImage> res;
+	{
+		std::lock_guard<std::mutex> g(m_mutex);
+		auto it = m_entries.find(id);
+		if (it == m_entries.end()) return std::shared_ptr<image::IImage>();
+
+		auto& e = it->second;
+		e.lastAccess = ++m_accessCounter;
+		if (e.image) return e.image;
+
+		try
+		{
+			e.image = e.spilled->load();
+		}
+		catch (const std::exception&)
+		{
+			return std::shared_ptr<image::IImage>();
+		}
+		e.spilled.reset();
+		if (e.pinCount) e.image->setPinned(true);
+		e.memorySize = e.image->getMemorySize();
+		res = e.image;
+	}
+	// the reference in res keeps the image in memory
+	applyBudget(id);
+	return res;
+}
+
+bool ImageStore::setPinned(int id, bool pinned)
+{
+	{
+		std::lock_guard<std::mutex> g(m_mutex);
+		auto it = m_entries.find(id);
+		if (it == m_entries.end()) return false;
+		auto& e = it->second;
+		// the image is only notified about the first pin and the last unpin
+		if (pinned)
+		{
+			if (e.pinCount++ == 0 && e.image) e.image->setPinned(true);
+		}
+		else if (e.pinCount && --e.pinCount == 0 && e.image) e.image->setPinned(false);
+		if (pinned || e.pinCount) return true;
+	}
+	applyBudget(id);
+	return true;
+}
+
+size_t ImageStore::getMemoryUsage()
+{
+	std::lock_guard<std::mutex> g(m_mutex);
+	size_t total = 0;
+	for (auto& [id, e] : m_entries)
+		if (e.image) total += e.image->getMemorySize();
+	return total;
+}
+
+void ImageStore::applyBudget(int keepId)
+{
+	const size_t budget = size_t(std::max(get_global_parameter_i("memory budget", 0), 0)) << 20;
+	if (budget == 0) return;
+
+	// images that are written to a scratch file
+	struct Spill
+	{
+		int id;
+		std::shared_ptr<image::IImage> image;
+	};
+	std::vector<Spill> spills;
+	{
+		std::lock_guard<std::mutex> g(m_mutex);
+
+		// the memory of images grows when caches are filled => update it here
+		size_t total = 0;
+		std::vector<std::pair<int, Entry*>> candidates;
+		for (auto& [id, e] : m_entries)
+		{
+			if (!e.image) continue;
+			e.memorySize = e.image->getMemorySize();
+			total += e.memorySize;
+			// images that are used by a running operation (use_count > 1) can not be released
+			if (id != keepId && e.pinCount == 0 && !e.spilling && e.image.use_count() == 1)
+				candidates.emplace_back(id, &e);
+		}
+		if (total <= budget) return;
+
+		// least recently used first
+		std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b)
+		{
+			return a.second->lastAccess < b.second->lastAccess;
+		});
+
+		// releasing caches is cheap and keeps the image in memory
+		for (auto& [id, e] : candidates)
+		{
+			if (total <= budget) break;
+			const size_t released = std::min(e->image->releaseCaches(), e->memorySize);
+			e->memorySize -= released;
+			total -= released;
+		}
+
+		for (auto& [id, e] : candidates)
+		{
+			if (total <= budget) break;
+			if (!e->image->isSpillable() || e->memorySize == 0) continue;
+			e->spilling = true;
+			spills.push_back({ id, e->image });
+			total -= e->memorySize;
+		}
+	}
+
+	// compressing and writing is slow => other images can be accessed meanwhile
+	for (auto& s : spills)
+	{
+		std::unique_ptr<SpilledImage> spilled;
+		try
+		{
+			spilled = std::make_unique<SpilledImage>(*s.image);
+		}
+		catch (const std::exception&)
+		{
+			// keep the image in memory (e.g. not enough disk space)
+		}
+
+		std::lock_guard<std::mutex> g(m_mutex);
+		auto it = m_entries.find(s.id);
+		// erased or replaced in the meantime
+		if (it == m_entries.end() || it->second.image != s.image) continue;
+		auto& e = it->second;
+		e.spilling = false;
+		// keep images that were pinned or accessed in the meantime (the reference in s is the second one)
+		if (!spilled || e.pinCount || s.image.use_count() > 2) continue;
+		e.spilled = std::move(spilled);
+		e.image.reset();
+		e.memorySize = 0;
+	}
+	spills.clear();
+
+	// the released memory would otherwise stay in the pool of pixel buffers
+	image::trimPixelPool();
+}
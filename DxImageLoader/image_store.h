@@ -0,0 +1,75 @@
+#pragma once
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Image.h"
+
+// pixel data of an image in a compressed scratch file
+class SpilledImage
+{
+public:
+	// writes all layers and mipmaps into a new file in the temp directory. Throws on failure
+	explicit SpilledImage(const image::IImage& image);
+	// deletes the scratch file
+	~SpilledImage();
+	SpilledImage(const SpilledImage&) = delete;
+	SpilledImage& operator=(const SpilledImage&) = delete;
+
+	// reads the data back into a new image. Throws on failure
+	std::unique_ptr<image::IImage> load() const;
+
+private:
+	std::string m_filename;
+	gli::format m_format;
+	gli::format m_original;
+	uint32_t m_numLayers;
+	uint32_t m_numFaces;
+	uint32_t m_numMipmaps;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_depth;
+};
+
+// owns the images of the dll and keeps track of their memory. If the global parameter "memory budget" is exceeded,
+// the caches of the least recently used images are released and spillable images are moved to a scratch file.
+// Pinned images and images that are used by a running operation stay in memory.
+// Spilled images are read back when they are accessed with find.
+class ImageStore
+{
+public:
+	// inserts or replaces the image and applies the memory budget
+	void insert(int id, std::shared_ptr<image::IImage> image);
+
+	// erases the image (if it exists)
+	void erase(int id);
+
+	// attempts to find the image and returns nullptr if not found (or if the scratch file could not be read)
+	std::shared_ptr<image::IImage> find(int id);
+
+	// pinned images are never released or spilled and keep the data returned by getData (see IImage::setPinned).
+	// Pins nest: the image stays pinned until it was unpinned as often as it was pinned. Returns false if the id was not found
+	bool setPinned(int id, bool pinned);
+
+	// bytes of memory that are held by images in memory
+	size_t getMemoryUsage();
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<image::IImage> image; // nullptr if spilled
+		std::unique_ptr<SpilledImage> spilled;
+		size_t memorySize = 0;
+		uint64_t lastAccess = 0;
+		uint32_t pinCount = 0;
+		bool spilling = false; // a scratch file is being written
+	};
+
+	// releases caches and spills images until the budget is met. keepId is the image that is currently accessed.
+	// Must be called without holding m_mutex: the scratch files are written outside of the lock
+	void applyBudget(int keepId);
+
+	std::unordered_map<int, Entry> m_entries;
+	uint64_t m_accessCounter = 0;
+	std::mutex m_mutex;
+};
@@ -4,6 +4,7 @@
 #include <memory>
 #include <algorithm>
 #include <fstream>
+#include <mutex>
 #include "Image.h"
 #include "stbi_interface.h"
 #include "gli_interface.h"
@@ -18,31 +19,34 @@
 #include "numpy_interface.h"
 #include "threadsafe_unordered_map.h"
 #include "webp_interface.h"
+#include "thread_pool.h"
+#include "operation_context.h"
+#include "source.h"
+#include "image_store.h"
+#include "trace.h"
 
 static std::atomic<int> s_currentID = 1;
-static threadsafe_unordered_map<int, image::IImage> s_resources;
+static ImageStore s_resources;
 
-std::string s_error;
-static ProgressCallback s_progress_callback = nullptr;
-static uint32_t s_last_progress = -1;
+// stats of the operations that created and exported each image and of all operations (see image_get_stats)
+static std::unordered_map<int, Stats> s_imageStats;
+static Stats s_loaderStats;
+static std::mutex s_statsMutex;
+
+// context for all functions that are called without an explicit operation context
+static OperationContext s_defaultContext;
+static std::atomic<int> s_currentOperationID = 1;
+static threadsafe_unordered_map<int, OperationContext> s_operations;
+
+// errors for each file of the last image_open_batch call (empty string if the file was opened)
+static std::vector<std::string> s_batchErrors;
+static std::mutex s_batchErrorMutex;
 
 // key = extension (e.g. png), value = DXGI formats
 static std::map<std::string, std::vector<uint32_t>> s_exportFormats;
 static std::unordered_map<std::string, int> s_globalParameteri;
 static std::mutex s_globalParameterMutex;
 
-bool hasEnding(std::string const& fullString, std::string const& ending) {
-	if (fullString.length() >= ending.length()) {
-		return (0 == fullString.compare(fullString.length() - ending.length(), ending.length(), ending));
-	}
-	return false;
-}
-
-inline bool file_exists(const std::string& name) {
-	std::ifstream f(name.c_str());
-	return f.good();
-}
-
 inline void assertSingleLayerMip(const image::IImage& image)
 {
 	if (image.getNumLayers() != 1)
@@ -53,105 +57,435 @@ inline void assertSingleLayerMip(const image::IImage& image)
 		throw std::runtime_error("expected 2D texture (depth = 1)");
 }
 
-int image_open(const char* filename)
+static void apply_postprocess(image::IImage& res, OperationContext& ctx)
 {
-	// try loading the resource
-	// transform filename to lowercase for file extension check
-	s_last_progress = -1;
-	std::string fname = filename;
-	std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
+	// GliImage::convertToSupported already applies the postprocess for most formats
+	if (!res.requiresGrayscalePostprocess() && !res.requiresBGRPostprocess()) return;
+
+	// grayscale and BGR in one pass
+	StageTimer timer(ctx.getStats(), Stage::Postprocess);
+	const uint64_t numBytes = uint64_t(res.getNumPixels()) * image::pixelSize(res.getFormat());
+	timer.add(res.getNumPixels(), numBytes, numBytes);
+	res.applyPostprocess();
+}
 
-	std::unique_ptr<image::IImage> res;
+// converts RGBA32F images to RGBA16F if the global parameter "staging half" is set
+static std::unique_ptr<image::IImage> apply_staging_format(std::unique_ptr<image::IImage> res, OperationContext& ctx)
+{
+	if (res->getFormat() != gli::FORMAT_RGBA32_SFLOAT_PACK32 || get_global_parameter_i("staging half", 0) == 0)
+		return res;
 
-	try
+	// compact images convert directly from the compact values
+	if (auto compact = dynamic_cast<image::CompactImage*>(res.get()))
 	{
-		if (!file_exists(filename))
-			throw std::exception("unable to open file");
+		compact->setStagingFormat(gli::FORMAT_RGBA16_SFLOAT_PACK16);
+		return res;
+	}
 
-		if (hasEnding(fname, ".pfm"))
-		{
-			res = pfm_load(filename);
-		}
-		else if(hasEnding(fname, ".ktx") || hasEnding(fname, ".ktx2"))
-		{
-			res = ktx_load(filename);
-		}
-		else if (hasEnding(fname, ".dds"))
-		{
-			res = gli_load(filename);
-		}
-		else if (hasEnding(fname, ".exr"))
-		{
-			res = openexr_load(filename);
-		}
-		else if(hasEnding(fname, ".png"))
-		{
-			res = png_load(filename);
-		}
-		else if(hasEnding(fname, ".hdr"))
-		{
-			res = hdr_load(filename);
-		}
-		else if(hasEnding(fname, ".npy"))
+	// keep the cube map faces of dds and ktx images
+	size_t nFaces = 1;
+	if (auto gliImage = dynamic_cast<GliImageBase*>(res.get()))
+		nFaces = gliImage->getNumFaces();
+
+	StageTimer timer(ctx.getStats(), Stage::Convert);
+	auto half = std::make_unique<GliImage>(gli::FORMAT_RGBA16_SFLOAT_PACK16, res->getOriginalFormat(),
+		res->getNumLayers() / nFaces, nFaces, res->getNumMipmaps(), res->getWidth(0), res->getHeight(0), res->getDepth(0));
+
+	for (uint32_t layer = 0; layer < res->getNumLayers(); ++layer)
+		for (uint32_t mip = 0; mip < res->getNumMipmaps(); ++mip)
 		{
-			res = numpy_load(filename);
+			size_t srcSize, dstSize;
+			auto src = reinterpret_cast<const float*>(res->getData(layer, mip, srcSize));
+			auto dst = reinterpret_cast<uint16_t*>(half->getData(layer, mip, dstSize));
+			assert(srcSize / sizeof(float) == dstSize / sizeof(uint16_t));
+			image::floatToHalf(src, dst, srcSize / sizeof(float));
+			timer.add(srcSize / 16, srcSize, dstSize);
 		}
-		else if (hasEnding(fname, ".webp"))
+
+	return half;
+}
+
+// decodes the image and applies the postprocessing. Throws on failure
+// formatHint: extension that is used if the format can not be detected from the content (may be nullptr)
+// loaders that reference the encoded data after decoding (webp) share the Source
+static std::unique_ptr<image::IImage> load_image(const std::shared_ptr<const Source>& shared, const char* formatHint, OperationContext& ctx)
+{
+	const Source& src = *shared;
+	std::unique_ptr<image::IImage> res;
+	{
+		StageTimer timer(ctx.getStats(), Stage::Decode);
+		switch (detect_format(src.data(), src.size(), formatHint))
 		{
-			res = webp_load(filename);
+		case FileFormat::Pfm: res = pfm_load(src, ctx); break;
+		case FileFormat::Ktx: res = ktx_load(src, ctx); break;
+		case FileFormat::Dds: res = gli_load(src, ctx); break;
+		case FileFormat::Exr: res = openexr_load(src, ctx); break;
+		case FileFormat::Png: res = png_load(src, ctx); break;
+		case FileFormat::Hdr: res = hdr_load(src, ctx); break;
+		case FileFormat::Npy: res = numpy_load(src, ctx); break;
+		case FileFormat::Webp: res = webp_load(shared, ctx); break;
+		case FileFormat::Stb: res = stb_image_load(src, ctx); break;
 		}
-		else
+		timer.add(res->getNumPixels(), src.size(), res->getMemorySize());
+	}
+
+	apply_postprocess(*res, ctx);
+	return apply_staging_format(std::move(res), ctx);
+}
+
+// decodes a region of a single layer and mipmap. Png, hdr and pfm only decode the rows up to the end of the region
+// and dds only the blocks that cover it. Other formats are decoded completely and cropped. Throws on failure
+static std::unique_ptr<image::IImage> load_region(const std::shared_ptr<const Source>& shared, image::Region region, OperationContext& ctx)
+{
+	const Source& src = *shared;
+	const auto format = detect_format(src.data(), src.size());
+	if (format != FileFormat::Png && format != FileFormat::Hdr && format != FileFormat::Pfm && format != FileFormat::Dds)
+		return image::extractRegion(*load_image(shared, nullptr, ctx), region);
+
+	std::unique_ptr<image::IImage> res;
+	{
+		StageTimer timer(ctx.getStats(), Stage::Decode);
+		switch (format)
 		{
-			res = stb_image_load(filename);
+		case FileFormat::Png: res = png_load_region(src, region, ctx); break;
+		case FileFormat::Hdr: res = hdr_load_region(src, region, ctx); break;
+		case FileFormat::Pfm: res = pfm_load_region(src, region, ctx); break;
+		default: res = gli_load_region(src, region, ctx); break;
 		}
+		// only parts of the file are read (the mapped pages that are touched)
+		timer.add(res->getNumPixels(), 0, res->getMemorySize());
+	}
+
+	apply_postprocess(*res, ctx);
+
+	// the loaders may return a larger image (e.g. whole compressed blocks or a complete interlaced png)
+	if (res->getNumLayers() != 1 || res->getNumMipmaps() != 1 || region.x != 0 || region.y != 0 ||
+		res->getWidth(0) != region.width || res->getHeight(0) != region.height)
+		res = image::extractRegion(*res, region);
+
+	return apply_staging_format(std::move(res), ctx);
+}
+
+// maps the file for the decoders and records the read stage. Throws on failure
+static std::shared_ptr<const Source> read_file(const char* filename, OperationContext& ctx)
+{
+	StageTimer timer(ctx.getStats(), Stage::Read);
+	auto src = std::make_shared<const Source>(filename);
+	timer.add(0, src->size(), 0);
+	return src;
+}
+
+// stores the image together with the stats of the operation that created it. Returns the new id
+static int add_resource(std::unique_ptr<image::IImage> res, const Stats& stats)
+{
+	const int id = s_currentID++;
+	{
+		std::lock_guard<std::mutex> g(s_statsMutex);
+		s_imageStats[id] = stats;
+	}
+	s_resources.insert(id, move(res));
+	return id;
+}
+
+static void add_loader_stats(const Stats& stats)
+{
+	std::lock_guard<std::mutex> g(s_statsMutex);
+	s_loaderStats.add(stats);
+}
+
+// reads the file header with the same format detection as load_image. Throws on failure
+static image::Info probe_file(const char* filename)
+{
+	const auto magic = read_file_header(filename);
+	switch (detect_format(magic.data(), magic.size()))
+	{
+	case FileFormat::Pfm: return pfm_probe(filename);
+	case FileFormat::Ktx: return ktx_probe(filename);
+	case FileFormat::Dds: return gli_probe(filename);
+	case FileFormat::Exr: return openexr_probe(filename);
+	case FileFormat::Png: return png_probe(filename);
+	case FileFormat::Hdr: return hdr_probe(filename);
+	case FileFormat::Npy: return numpy_probe(filename);
+	case FileFormat::Webp: return webp_probe(filename);
+	case FileFormat::Stb: break;
+	}
+	return stb_image_probe(filename);
+}
+
+static bool probe_image(const char* filename, OperationContext& ctx, uint32_t& originalFormat, int& width, int& height, int& depth, int& nLayer, int& nMipmaps)
+{
+	ctx.begin();
+	try
+	{
+		const auto info = probe_file(filename);
+		originalFormat = info.originalFormat;
+		width = int(info.width);
+		height = int(info.height);
+		depth = int(info.depth);
+		nLayer = int(info.layers);
+		nMipmaps = int(info.mipmaps);
+		return true;
 	}
 	catch (const std::exception& e)
 	{
-		set_error(e.what());
+		ctx.setError(e.what());
 	}
+	return false;
+}
+
+static int open_image(const char* filename, OperationContext& ctx)
+{
+	trace::Scope scope("image_open");
+	// try loading the resource
+	ctx.begin();
+	std::unique_ptr<image::IImage> res;
+	try
+	{
+		if (ctx.isCancelled())
+			throw std::runtime_error("aborted by user");
+
+		// the file is read once. The decoder is chosen by the file content, not by the extension
+		const auto src = read_file(filename, ctx);
+		res = load_image(src, nullptr, ctx);
+	}
+	catch (const std::exception& e)
+	{
+		ctx.setError(e.what());
+	}
+	add_loader_stats(ctx.getStats());
 	if (!res) return 0;
 
-	if(res->requiresGrayscalePostprocess())
+	return add_resource(std::move(res), ctx.getStats());
+}
+
+static int open_memory(const void* data, size_t size, const char* formatHint, OperationContext& ctx)
+{
+	trace::Scope scope("image_open_memory");
+	ctx.begin();
+	std::unique_ptr<image::IImage> res;
+	try
 	{
-		assert(image::isSupported(res->getFormat()));
-		for(uint32_t layer = 0; layer < res->getNumLayers(); ++layer)
-			for(uint32_t mip = 0; mip < res->getNumMipmaps(); ++mip)
+		// decoders read directly from the memory of the caller
+		const auto src = std::make_shared<const Source>(data, size);
+		res = load_image(src, formatHint, ctx);
+	}
+	catch (const std::exception& e)
+	{
+		ctx.setError(e.what());
+	}
+	add_loader_stats(ctx.getStats());
+	if (!res) return 0;
+
+	return add_resource(std::move(res), ctx.getStats());
+}
+
+static int open_region(const char* filename, int layer, int mipmap, int x, int y, int width, int height, OperationContext& ctx)
+{
+	trace::Scope scope("image_open_region", layer, mipmap);
+	ctx.begin();
+	std::unique_ptr<image::IImage> res;
+	try
+	{
+		if (layer < 0 || mipmap < 0 || x < 0 || y < 0 || width <= 0 || height <= 0)
+			throw std::runtime_error("invalid region");
+		if (ctx.isCancelled())
+			throw std::runtime_error("aborted by user");
+
+		image::Region region;
+		region.layer = uint32_t(layer);
+		region.mipmap = uint32_t(mipmap);
+		region.x = uint32_t(x);
+		region.y = uint32_t(y);
+		region.width = uint32_t(width);
+		region.height = uint32_t(height);
+
+		const auto src = read_file(filename, ctx);
+		res = load_region(src, region, ctx);
+	}
+	catch (const std::exception& e)
+	{
+		ctx.setError(e.what());
+	}
+	add_loader_stats(ctx.getStats());
+	if (!res) return 0;
+
+	return add_resource(std::move(res), ctx.getStats());
+}
+
+int image_open(const char* filename)
+{
+	return open_image(filename, s_defaultContext);
+}
+
+int image_open_ex(int op, const char* filename)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		s_defaultContext.setError("invalid operation handle");
+		return 0;
+	}
+	return open_image(filename, *ctx);
+}
+
+int image_open_memory(const void* data, size_t size, const char* formatHint)
+{
+	return open_memory(data, size, formatHint, s_defaultContext);
+}
+
+int image_open_memory_ex(int op, const void* data, size_t size, const char* formatHint)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		s_defaultContext.setError("invalid operation handle");
+		return 0;
+	}
+	return open_memory(data, size, formatHint, *ctx);
+}
+
+int image_open_region(const char* filename, int layer, int mipmap, int x, int y, int width, int height)
+{
+	return open_region(filename, layer, mipmap, x, y, width, height, s_defaultContext);
+}
+
+int image_open_region_ex(int op, const char* filename, int layer, int mipmap, int x, int y, int width, int height)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		s_defaultContext.setError("invalid operation handle");
+		return 0;
+	}
+	return open_region(filename, layer, mipmap, x, y, width, height, *ctx);
+}
+
+int image_open_batch(const char** filenames, int n, int* outIds)
+{
+	s_defaultContext.begin();
+	{
+		std::lock_guard<std::mutex> g(s_batchErrorMutex);
+		s_batchErrors.assign(std::max(n, 0), std::string());
+	}
+	if (n <= 0) return 0;
+
+	// one context per file. Per row progress of the individual files is not meaningful for the batch => no callback
+	auto contexts = std::make_unique<OperationContext[]>(n);
+	std::vector<std::future<void>> tasks;
+	tasks.reserve(n);
+	for(int i = 0; i < n; ++i)
+	{
+		outIds[i] = 0;
+		tasks.push_back(ThreadPool::get().submit([i, filenames, outIds, ctx = &contexts[i]]()
+		{
+			outIds[i] = open_image(filenames[i], *ctx);
+			if(outIds[i] == 0)
 			{
-				size_t size;
-				auto data = res->getData(layer, mip, size);
-				if (res->getFormat() == gli::FORMAT_RGBA32_SFLOAT_PACK32)
-					image::copyRedToGreenBlue<4>(data, size);
-				else image::copyRedToGreenBlue<1>(data, size);
+				std::lock_guard<std::mutex> g(s_batchErrorMutex);
+				s_batchErrors[i] = ctx->getError();
 			}
+		}));
 	}
 
-	if (res->requiresBGRPostprocess())
-		res->applyBGRPostprocess();
+	// report progress based on the number of finished files
+	int numOpened = 0;
+	bool aborted = false;
+	for(int i = 0; i < n; ++i)
+	{
+		tasks[i].wait();
+		if (outIds[i] != 0) ++numOpened;
+		if (aborted) continue;
+		try
+		{
+			s_defaultContext.setProgress(uint32_t((i + 1) * 100 / n), "opening files");
+		}
+		catch (const std::exception&)
+		{
+			// abort all files that are still running or were not started yet
+			aborted = true;
+			for (int j = i + 1; j < n; ++j)
+				contexts[j].cancel();
+		}
+	}
 
-	const int id = s_currentID++;
-	s_resources.insert(id, move(res));
+	return numOpened;
+}
 
-	return id;
+const char* get_batch_error(int index, int& length)
+{
+	std::lock_guard<std::mutex> g(s_batchErrorMutex);
+	if(index < 0 || size_t(index) >= s_batchErrors.size())
+	{
+		length = 0;
+		return nullptr;
+	}
+
+	length = static_cast<int>(s_batchErrors[index].length());
+	return s_batchErrors[index].data();
+}
+
+bool image_probe(const char* filename, uint32_t& originalFormat, int& width, int& height, int& depth, int& nLayer, int& nMipmaps)
+{
+	return probe_image(filename, s_defaultContext, originalFormat, width, height, depth, nLayer, nMipmaps);
+}
+
+bool image_probe_ex(int op, const char* filename, uint32_t& originalFormat, int& width, int& height, int& depth, int& nLayer, int& nMipmaps)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		s_defaultContext.setError("invalid operation handle");
+		return false;
+	}
+	return probe_image(filename, *ctx, originalFormat, width, height, depth, nLayer, nMipmaps);
 }
 
 int image_allocate(uint32_t format, int width, int height, int depth, int layer, int mipmaps)
 {
-	auto res = std::make_unique<GliImage>(gli::format(format), layer, mipmaps, width, height, depth);
-	if(!image::isSupported(res->getFormat()))
+	if(!image::isStagingFormat(gli::format(format)))
 	{
-		set_error("image format is not supported for allocate");
+		s_defaultContext.setError("image format is not supported for allocate");
+		return 0;
+	}
+	if (width <= 0 || height <= 0 || depth <= 0 || layer <= 0 || mipmaps <= 0)
+	{
+		s_defaultContext.setError("invalid image size for allocate");
 		return 0;
 	}
 
-	const int id = s_currentID++;
-	s_resources.insert(id, move(res));
-
-	return id;
+	try
+	{
+		// the host overwrites the data => uninitialized buffers from the pool. The dds and ktx exporters copy it into a GliImage
+		auto res = std::make_unique<image::PooledImage>(gli::format(format), uint32_t(width), uint32_t(height), uint32_t(depth), uint32_t(layer), uint32_t(mipmaps));
+		return add_resource(std::move(res), Stats());
+	}
+	catch (const std::exception& e)
+	{
+		s_defaultContext.setError(e.what());
+		return 0;
+	}
 }
 
 void image_release(int id)
 {
 	s_resources.erase(id);
+	std::lock_guard<std::mutex> g(s_statsMutex);
+	s_imageStats.erase(id);
+}
+
+bool image_pin(int id, bool pinned)
+{
+	if (!s_resources.setPinned(id, pinned))
+	{
+		s_defaultContext.setError("invalid image id");
+		return false;
+	}
+	return true;
+}
+
+uint64_t image_get_memory_usage()
+{
+	return uint64_t(s_resources.getMemoryUsage());
 }
 
 void image_info(int id, uint32_t& format, uint32_t& originalFormat, int& nLayer, int& nMipmaps)
@@ -200,7 +534,17 @@ unsigned char* image_get_mipmap(int id, int layer, int mipmap, uint64_t& size)
 	if (unsigned(mipmap) >= img->getNumMipmaps())
 		return nullptr;
 
-	return img->getData(layer, mipmap, size);
+	try
+	{
+		// images that decode on demand (webp frames) throw if the data could not be decoded
+		return img->getData(layer, mipmap, size);
+	}
+	catch (const std::exception& e)
+	{
+		s_defaultContext.setError(e.what());
+		size = 0;
+		return nullptr;
+	}
 }
 
 float image_get_fps(int id)
@@ -208,43 +552,62 @@ float image_get_fps(int id)
 	auto img = s_resources.find(id);
 	if (!img)
 	{
-		set_error("invalid image id");
+		s_defaultContext.setError("invalid image id");
 		return 0.0f;
 	}
 	return img->getFps();
 }
 
-bool image_save(int id, const char* filename, const char* extension, uint32_t format, int quality, float fps)
+// size of the written file in bytes (0 if it does not exist)
+static uint64_t get_file_size(const char* filename)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data))
+		return 0;
+	return (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+}
+
+static bool save_image(int id, const char* filename, const char* extension, uint32_t format, int quality, float fps, OperationContext& ctx)
 {
-	s_last_progress = -1;
+	trace::Scope scope("image_save");
+	ctx.begin();
 	auto img = s_resources.find(id);
 	if (!img)
 	{
-		set_error("invalid image id");
+		ctx.setError("invalid image id");
 		return false;
 	}
 
 	const std::string ext = extension;
 	const std::string fullName = filename + std::string(".") + extension;
+	bool success = true;
 	try
 	{
+		StageTimer timer(ctx.getStats(), Stage::Encode);
+		// the dds and ktx exporters work on gli textures => images of the other loaders (png, pfm, ...) are copied
+		const GliImage* gliImage = dynamic_cast<const GliImage*>(img.get());
+		std::unique_ptr<GliImage> gliCopy;
+		if (!gliImage && (ext == "dds" || ext == "ktx" || ext == "ktx2"))
+		{
+			gliCopy = GliImage::copyOf(*img);
+			gliImage = gliCopy.get();
+		}
+
 		if (ext == "dds")
-			gli_save_image(fullName.c_str(), dynamic_cast<GliImage&>(*img), gli::format(format), false, quality);
+			gli_save_image(fullName.c_str(), *gliImage, gli::format(format), false, quality, ctx);
 		else if (ext == "ktx")
-			//gli_save_image(fullName.c_str(), dynamic_cast<GliImage&>(*img), gli::format(format), true, quality);
-			ktx1_save_image(fullName.c_str(), dynamic_cast<GliImage&>(*img), gli::format(format), quality);
+			//gli_save_image(fullName.c_str(), *gliImage, gli::format(format), true, quality);
+			ktx1_save_image(fullName.c_str(), *gliImage, gli::format(format), quality, ctx);
 		else if (ext == "ktx2")
-			ktx2_save_image(fullName.c_str(), dynamic_cast<GliImage&>(*img), gli::format(format), quality);
+			ktx2_save_image(fullName.c_str(), *gliImage, gli::format(format), quality, ctx);
 		else if(ext == "hdr")
 		{
 			assertSingleLayerMip(*img);
-			hdr_write(*img, fullName.c_str());
+			hdr_write(*img, fullName.c_str(), ctx);
 		}
 		else if (ext == "pfm")
 		{
 			assertSingleLayerMip(*img);
-			if (img->getFormat() != gli::FORMAT_RGBA32_SFLOAT_PACK32)
-				throw std::runtime_error ("expected RGBA32F image format for pfm export");
 
 			size_t mipSize;
 			auto mip = img->getData(0, 0, mipSize);
@@ -254,23 +617,17 @@ bool image_save(int id, const char* filename, const char* extension, uint32_t fo
 
 			// only 2 possible formats
 			if (format == gli::FORMAT_RGB32_SFLOAT_PACK32 || format == gli::FORMAT_RGB8E8_UFLOAT_PACK32)
-			{
-				image::changeStride(mip, mipSize, 16, 12);
 				nComponents = 3;
-			}
 			else if (format == gli::FORMAT_R32_SFLOAT_PACK32)
-			{
-				image::changeStride(mip, mipSize, 16, 4);
 				nComponents = 1;
-			}
 			else throw std::runtime_error("export format not supported for pfm, hdr");
 
-			pfm_save(fullName.c_str(), width, height, nComponents, mip);
+			pfm_save(fullName.c_str(), width, height, nComponents, mip, img->getFormat(), ctx);
 		}
 		else if(ext == "png")
 		{
 			assertSingleLayerMip(*img);
-			png_write(*img, fullName.c_str(), gli::format(format), quality);
+			png_write(*img, fullName.c_str(), gli::format(format), quality, ctx);
 		}
 		else if (ext == "jpg" || ext == "bmp" || ext == "tga")
 		{
@@ -281,18 +638,19 @@ bool image_save(int id, const char* filename, const char* extension, uint32_t fo
 				throw std::runtime_error("unexpected image format. Expected one of FORMAT_RGBA8_SRGB_PACK8, FORMAT_RGBA8_UNORM_PACK8, FORMAT_RGBA8_SNORM_PACK8");
 
 			size_t mipSize;
-			auto mip = img->getData(0, 0, mipSize);
+			const uint8_t* mip = img->getData(0, 0, mipSize);
 			auto width = img->getWidth(0);
 			auto height = img->getHeight(0);
 			int nComponents = stb_ldr_get_num_components(gli::format(format));
 
-			if (nComponents == 3)
+			// stb encodes the whole image at once => copy the exported channels (the image stays unchanged)
+			image::PixelBuffer packed;
+			if (nComponents == 3 || nComponents == 1)
 			{
-				image::changeStride(mip, mipSize, 4, 3);
-			}
-			else if (nComponents == 1)
-			{
-				image::changeStride(mip, mipSize, 4, 1);
+				const size_t numPixels = size_t(width) * size_t(height);
+				packed = image::PixelBuffer(numPixels * nComponents);
+				image::copyStrideEx(mip, packed.data(), numPixels, 4, nComponents == 3 ? 0b111 : 0b1);
+				mip = packed.data();
 			}
 
 			if (ext == "bmp")
@@ -308,21 +666,46 @@ bool image_save(int id, const char* filename, const char* extension, uint32_t fo
 			if (img->getNumMipmaps() != 1)
 				throw std::runtime_error("expected single mipmap image");
 
-			numpy_save(fullName.c_str(), img.get(), format);
+			numpy_save(fullName.c_str(), img.get(), format, ctx);
 		}
 		else if (ext == "webp")
 		{
-			webp_save_image(fullName.c_str(), *img, gli::format(format), quality, fps);
+			webp_save_image(fullName.c_str(), *img, gli::format(format), quality, fps, ctx);
 		}
 		else throw std::runtime_error("file extension not supported");
+
+		timer.add(img->getNumPixels(), img->getMemorySize(), get_file_size(fullName.c_str()));
 	}
 	catch(const std::exception& e)
 	{
-		set_error(e.what());
-		return false;
+		ctx.setError(e.what());
+		success = false;
 	}
 
-	return true;
+	// the export stats are added to the stats of the image
+	std::lock_guard<std::mutex> g(s_statsMutex);
+	s_loaderStats.add(ctx.getStats());
+	auto it = s_imageStats.find(id);
+	if (it != s_imageStats.end())
+		it->second.add(ctx.getStats());
+
+	return success;
+}
+
+bool image_save(int id, const char* filename, const char* extension, uint32_t format, int quality, float fps)
+{
+	return save_image(id, filename, extension, format, quality, fps, s_defaultContext);
+}
+
+bool image_save_ex(int op, int id, const char* filename, const char* extension, uint32_t format, int quality, float fps)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		s_defaultContext.setError("invalid operation handle");
+		return false;
+	}
+	return save_image(id, filename, extension, format, quality, fps, *ctx);
 }
 
 const uint32_t* get_export_formats(const char* extension, int& numFormats)
@@ -357,10 +740,7 @@ int get_global_parameter_i(const char* name)
 	std::lock_guard<std::mutex> g(s_globalParameterMutex);
 	auto it = s_globalParameteri.find(name);
 	if (it == s_globalParameteri.end())
-	{
-		set_error("global parameter not found: " + std::string(name));
-		throw std::runtime_error(s_error);
-	}
+		throw std::runtime_error("global parameter not found: " + std::string(name));
 
 	return it->second;
 }
@@ -384,50 +764,166 @@ void set_global_parameter_i(const char* name, int value)
 
 void set_progress_callback(ProgressCallback cb)
 {
-	s_progress_callback = cb;
+	s_defaultContext.setProgressCallback(cb);
+}
+
+const char* image_get_stats(int id, int& length)
+{
+	// valid until the next call from the same thread
+	thread_local std::string json;
+	{
+		std::lock_guard<std::mutex> g(s_statsMutex);
+		auto it = s_imageStats.find(id);
+		if (it == s_imageStats.end())
+		{
+			s_defaultContext.setError("invalid image id");
+			length = 0;
+			return nullptr;
+		}
+		json = it->second.toJson();
+	}
+	length = static_cast<int>(json.length());
+	return json.data();
+}
+
+const char* get_loader_stats(int& length)
+{
+	thread_local std::string json;
+	{
+		std::lock_guard<std::mutex> g(s_statsMutex);
+		json = s_loaderStats.toJson();
+	}
+	length = static_cast<int>(json.length());
+	return json.data();
+}
+
+void trace_begin()
+{
+	trace::begin();
+}
+
+bool trace_end(const char* filename)
+{
+	try
+	{
+		if (filename) trace::end(filename);
+		else trace::endEnvironment();
+	}
+	catch (const std::exception& e)
+	{
+		s_defaultContext.setError(e.what());
+		return false;
+	}
+	return true;
 }
 
 const char* get_error(int& length)
 {
-	length = static_cast<int>(s_error.length());
-	return s_error.data();
+	const auto& error = s_defaultContext.getError();
+	length = static_cast<int>(error.length());
+	return error.data();
 }
 
-void set_error(const std::string& str)
+int operation_create()
 {
-	s_error = str;
+	const int op = s_currentOperationID++;
+	s_operations.insert(op, std::make_shared<OperationContext>());
+	return op;
 }
 
-void set_progress(uint32_t progress, const char* description)
+void operation_release(int op)
 {
-	if (!s_progress_callback) return;
-	progress = std::min(uint32_t(100), progress);
+	s_operations.erase(op);
+}
 
-	if (progress == s_last_progress) return;
-	s_last_progress = progress;
-	if (description == nullptr) description = "";
+void operation_set_progress_callback(int op, ProgressCallback cb)
+{
+	auto ctx = s_operations.find(op);
+	if (ctx) ctx->setProgressCallback(cb);
+}
+
+void operation_cancel(int op)
+{
+	auto ctx = s_operations.find(op);
+	if (ctx) ctx->cancel();
+}
+
+float image_poll_progress(int op, const char*& description)
+{
+	description = "";
+	if (op == 0)
+	{
+		description = s_defaultContext.getDescription();
+		return s_defaultContext.getProgress();
+	}
+
+	auto ctx = s_operations.find(op);
+	if (!ctx) return -1.0f;
+	description = ctx->getDescription();
+	return ctx->getProgress();
+}
+
+const char* operation_get_error(int op, int& length)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		length = 0;
+		return nullptr;
+	}
+	// the string stays valid as long as the operation is not released
+	const auto& error = ctx->getError();
+	length = static_cast<int>(error.length());
+	return error.data();
+}
+
+static unsigned int* get_npy_shape(const char* filename, unsigned int* dim, OperationContext& ctx)
+{
+	ctx.begin();
+	try
+	{
+		auto& shape = ctx.getShape();
+		shape = numpy_get_shape(filename);
+		if (dim) *dim = unsigned(shape.size());
+		return shape.data();
+	}
+	catch (const std::exception& e)
+	{
+		ctx.setError(e.what());
+	}
+	return nullptr;
+}
+
+unsigned int* npy_get_shape(const char* filename, unsigned int* dim)
+{
+	return get_npy_shape(filename, dim, s_defaultContext);
+}
 
-	if (s_progress_callback(progress / 100.0f, description))
-		throw std::runtime_error("aborted by user");
+unsigned int* npy_get_shape_ex(int op, const char* filename, unsigned int* dim)
+{
+	auto ctx = s_operations.find(op);
+	if (!ctx)
+	{
+		s_defaultContext.setError("invalid operation handle");
+		return nullptr;
+	}
+	return get_npy_shape(filename, dim, *ctx);
 }
 
 int noise_generate_white(int width, int height, int depth, int layer, int mipmaps, int seed)
 {
 	auto res = noise_get_white_noise(width, height, depth, layer, mipmaps, seed);
-	const int id = s_currentID++;
-	s_resources.insert(id, std::move(res));
-	return id;
+	return add_resource(std::move(res), Stats());
 }
 
 int noise_generate_blue(int width, int height, int depth, int layer, int mipmaps) try
 {
-	auto res = noise_get_blue_noise(width, height, depth, layer, mipmaps);
-	const int id = s_currentID++;
-	s_resources.insert(id, std::move(res));
-	return id;
+	s_defaultContext.begin();
+	auto res = noise_get_blue_noise(width, height, depth, layer, mipmaps, s_defaultContext);
+	return add_resource(std::move(res), Stats());
 }
 catch(const std::exception& e)
 {
-	set_error(e.what());
+	s_defaultContext.setError(e.what());
 	return 0;
 }
\ No newline at end of file
@@ -10,7 +10,58 @@
 /// The error can be retrieved with get_error on failure.
 EXPORT(int) image_open(const char* filename);
 
-/// \brief allocates a texture with the given amount of layers and levels
+/// \brief same as image_open but reports error and progress to the given operation context
+/// \param op operation handle from operation_create
+EXPORT(int) image_open_ex(int op, const char* filename);
+
+/// \brief decodes an image from memory (e.g. a file that was extracted from an archive)
+/// \param data encoded file contents. The memory is not copied and only needs to be valid during this call
+/// \param size size of data in bytes
+/// \param formatHint file extension without dot (e.g. "tga"). Only used if the format can not be detected from the data. May be nullptr
+/// \return returns a non zero integer on success.
+/// The error can be retrieved with get_error on failure.
+EXPORT(int) image_open_memory(const void* data, size_t size, const char* formatHint);
+
+/// \brief same as image_open_memory but reports error and progress to the given operation context
+/// \param op operation handle from operation_create
+EXPORT(int) image_open_memory_ex(int op, const void* data, size_t size, const char* formatHint);
+
+/// \brief opens only a rectangle of one layer and mipmap of the file.
+/// png, hdr and pfm decode only the rows up to the end of the region and dds only the blocks that cover it,
+/// other formats are decoded completely and cropped afterwards.
+/// \param filename absolute or relative path
+/// \param x, y top left pixel of the region in the mipmap
+/// \param width, height size of the region. The region must be inside the mipmap
+/// \return returns a non zero integer for a single layer/mipmap image with the size of the region on success.
+/// The error can be retrieved with get_error on failure.
+EXPORT(int) image_open_region(const char* filename, int layer, int mipmap, int x, int y, int width, int height);
+
+/// \brief same as image_open_region but reports error and progress to the given operation context
+/// \param op operation handle from operation_create
+EXPORT(int) image_open_region_ex(int op, const char* filename, int layer, int mipmap, int x, int y, int width, int height);
+
+/// \brief opens multiple files concurrently on the internal worker pool
+/// \param filenames array with n absolute or relative paths
+/// \param n number of files
+/// \param outIds array with n entries. Receives the image id for each file or 0 if the file could not be opened
+/// \return number of files that were opened successfully.
+/// The error for each file can be retrieved with get_batch_error. Progress is reported per finished file.
+EXPORT(int) image_open_batch(const char** filenames, int n, int* outIds);
+
+/// \brief get the error of the file with the given index from the last image_open_batch call
+/// \return empty string if the file was opened successfully, nullptr if the index is out of range
+EXPORT(const char*) get_batch_error(int index, int& length);
+
+/// \brief reads dimensions and format from the file header without decoding the pixel data
+/// \param originalFormat receives the format of the file (same as originalFormat of image_info after image_open)
+/// \return true on success. The error can be retrieved with get_error on failure.
+EXPORT(bool) image_probe(const char* filename, uint32_t& originalFormat, int& width, int& height, int& depth, int& nLayer, int& nMipmaps);
+
+/// \brief same as image_probe but reports the error to the given operation context
+/// \param op operation handle from operation_create
+EXPORT(bool) image_probe_ex(int op, const char* filename, uint32_t& originalFormat, int& width, int& height, int& depth, int& nLayer, int& nMipmaps);
+
+/// \brief allocates a texture with the given amount of layers and levels. The pixel data is uninitialized (see "pixel pool")
 /// \param format dxgi texture format (must be one of the compatible formats, see Image.h)
 /// \param width width in pixels
 /// \param height height in pixels
@@ -22,6 +73,17 @@ EXPORT(int) image_allocate(uint32_t format, int width, int height, int depth, in
 /// \brief releases all resources from the file with the given id
 EXPORT(void) image_release(int id);
 
+/// \brief pinned images are kept in memory when the "memory budget" is exceeded.
+/// Pin images while pointers from image_get_mipmap are used and other images are opened concurrently
+/// or while pointers of several layers are collected: webp frames (beyond "webp cacheFrames") and layers that are converted on demand
+/// are only kept for the latest requests of unpinned images.
+/// Pins nest: the image stays pinned until it was unpinned as often as it was pinned
+/// \return false if the id is invalid
+EXPORT(bool) image_pin(int id, bool pinned);
+
+/// \brief bytes of memory that are held by all images (spilled images are not counted)
+EXPORT(uint64_t) image_get_memory_usage();
+
 /// \brief retrieves image info
 /// format internal texture format, will be one of the compatible formats from Image.h
 EXPORT(void) image_info(int id, uint32_t& format, uint32_t& originalFormat, int& nLayer, int& nMipmaps);
@@ -30,7 +92,7 @@ EXPORT(void) image_info(int id, uint32_t& format, uint32_t& originalFormat, int&
 EXPORT(void) image_info_mipmap(int id, int mipmap, int& width, int& height, int& depth);
 
 /// \brief get mipmap bytes
-/// \return mipmap data. Can also be used to write mipmap data
+/// \return mipmap data. Can also be used to write mipmap data. nullptr if the data could not be decoded (see get_error)
 EXPORT(unsigned char*) image_get_mipmap(int id, int layer, int mipmap, uint64_t& size);
 
 /// \brief retrieves desired fps for 2D arrays (webp videos)
@@ -44,17 +106,33 @@ EXPORT(float) image_get_fps(int id);
 /// \param format format that must be compatible with the extension. Can by queried with image_get_export_formats
 /// \param quality quality for compressed formats or .jpg. range: [0, 100]
 /// \param fps video fps (for webp export). 0 defaults to 24 fps. Ignored for non video formats.
-/// \warning the image data might be changed by calling this function. Thus, the image should no longer be used after a call to save
-/// \remarks for pfm and hdr export: the image format must be FORMAT_RGBA32_SFLOAT_PACK32.
+/// \remarks the image is not modified. Conversions are done in small scratch buffers while the file is written
+/// \remarks for pfm and hdr export: the image format must be FORMAT_RGBA32_SFLOAT_PACK32 or FORMAT_RGBA16_SFLOAT_PACK16 ("staging half").
 ///          for png, jpg and bmp export the image format must be one of: FORMAT_RGBA8_SRGB_PACK8, FORMAT_RGBA8_UNORM_PACK8, FORMAT_RGBA8_SNORM_PACK8
 EXPORT(bool) image_save(int id, const char* filename, const char* extension, uint32_t format, int quality, float fps);
 
+/// \brief same as image_save but reports error and progress to the given operation context
+/// \param op operation handle from operation_create
+EXPORT(bool) image_save_ex(int op, int id, const char* filename, const char* extension, uint32_t format, int quality, float fps);
+
 /// \brief retrieves an array with all supported dxgi formats that are available for export with the extension
 EXPORT(const uint32_t*) get_export_formats(const char* extension, int& numFormats);
 
 /// List of global parameters:
 /// "uastc srgb" - for .ktx2 export => use uastc for srgb compression (otherwise etc1 is used). Valid for srgb uastc compressable textures
 /// "normalmap" - for .ktx2 export => indicate that the exporter/compressor should optimize data for normal maps. Valid for linear (non-srgb) uastc compressable textures
+/// "webp cacheFrames" - for .webp import => number of composed animation frames that are kept in memory (default 16). Other frames are recomposed from the nearest keyframe when requested
+/// "memory budget" - memory for all images in MB (default 0 = unlimited). If exceeded, caches of the least recently used images are released
+///   and images are moved to a compressed scratch file in the temp directory until they are accessed again (see image_pin)
+/// "staging half" - for import => if not 0, images that would be loaded as RGBA32F are converted to RGBA16F (half the memory, reduced precision)
+/// "pixel pool" - released pixel buffers that are kept for reuse in MB (default 256)
+/// "large pages" - if not 0, large pixel buffers use large pages. Requires the SeLockMemoryPrivilege ("Lock pages in memory"), which the dll enables in the process token. Without it normal pages are used
+/// "simd" - instruction set of the pixel shuffles (expanding, swizzling and packing channels): 0 = scalar, 1 = SSE4.1 (NEON on arm64), 2 = AVX2 (default).
+///   Limited to the instruction sets the cpu supports
+/// "compress backend" - encoder and decoder of compressonator for BCn, ETC and ASTC formats: 0 = gpu if a DirectX 11 hardware device is available, otherwise cpu (default),
+///   1 = cpu (multithreaded cpu codecs, for Windows machines without a DirectX 11 hardware device), 2 = gpu
+/// "compress preset" - speed of the compressonator BC1-BC3 encoders: 0 = fast (fastest mode), 1 = normal (default).
+///   The quality argument of image_save is used by both presets
 
 /// \brief returns the value of the parameter if found. Throws an exception otherwise
 int get_global_parameter_i(const char* name);
@@ -67,23 +145,71 @@ EXPORT(void) set_global_parameter_i(const char* name, int value);
 
 typedef uint32_t(__stdcall* ProgressCallback)(float, const char*);
 
-/// \brief sets the progress report callback
+/// \brief sets the progress report callback for all functions without an operation context
 EXPORT(void) set_progress_callback(ProgressCallback cb);
 
-/// \brief get last error
+/// \brief get last error of the functions without an operation context
 EXPORT(const char*) get_error(int& length);
 
-/// \brief set current error (for internal use only) 
-void set_error(const std::string& str);
+/// \brief time and data of the import and the exports of the image per stage as json:
+/// {"read":{"time_us":0,"bytes_read":0,"bytes_written":0,"pixels":0,"count":0},"decode":{..},"postprocess":{..},"convert":{..},"compress":{..},"encode":{..}}
+/// Stages can be nested (encode contains the convert and compress stages of the export). With mapped files, reading the pixels happens during decode
+/// \return json string that is valid until the next call from the same thread. nullptr if the id is invalid
+EXPORT(const char*) image_get_stats(int id, int& length);
+
+/// \brief sum of the stats (see image_get_stats) of all imports and exports since the dll was loaded
+EXPORT(const char*) get_loader_stats(int& length);
 
-/// \brief set current progress (for internal use only)
-/// throws an error if the action should be aborted
-void set_progress(uint32_t progress, const char* description = nullptr);
+/// Tracing:
+/// records the time of open and save operations, the loaders, conversions and compressions (per layer and mipmap) and of the ktx2 and webp exporters
+/// on a timeline in the chrome trace event format (open the file in ui.perfetto.dev or chrome://tracing).
+/// Tracing is off by default and costs two atomic loads per scope. If the environment variable DXIMAGELOADER_TRACE is set to a filename,
+/// tracing starts with the first traced call and the file is written by trace_end(nullptr) (ImageFramework calls it when the process exits).
+/// The variable is not read in DllMain and the file is not written on unload (no allocations, locks or file io under the loader lock).
+
+/// \brief discards recorded events and starts recording
+EXPORT(void) trace_begin();
+
+/// \brief stops recording and writes the recorded events as chrome trace json
+/// \param filename output file. nullptr writes the file of DXIMAGELOADER_TRACE (does nothing if it is not set or tracing was stopped)
+/// \return false if the file could not be written (see get_error)
+EXPORT(bool) trace_end(const char* filename);
+
+/// Operation contexts:
+/// the functions without an operation context share one error string and progress callback.
+/// For concurrent imports and exports, each thread should create its own operation context and use the _ex functions.
+
+/// \brief creates a new operation context without progress callback
+/// \return operation handle (non zero)
+EXPORT(int) operation_create();
+
+/// \brief releases the operation context. Operations that are still running with this context keep it alive until they finish
+EXPORT(void) operation_release(int op);
+
+/// \brief sets the progress report callback of the operation context (may be nullptr)
+EXPORT(void) operation_set_progress_callback(int op, ProgressCallback cb);
+
+/// \brief aborts the operation that is running with this context at its next progress report.
+/// Can be called from any thread. The context stays cancelled, create a new one for further operations
+EXPORT(void) operation_cancel(int op);
+
+/// \brief progress of the operation that is running with the context. The loaders and exporters only update atomic counters,
+/// the host can poll them at its own rate instead of setting a progress callback. Can be called from any thread
+/// \param op operation handle from operation_create or 0 for the functions without an operation context
+/// \param description receives the name of the current step (static string, may be empty)
+/// \return progress of the current step in [0, 1] or -1 if the handle is invalid
+EXPORT(float) image_poll_progress(int op, const char*& description);
+
+/// \brief get last error of the operation context
+EXPORT(const char*) operation_get_error(int op, int& length);
 
 /// \brief returns a pointer to the shape and stores the number if dimensions in dim. Returns nullptr on failure.
-/// WARNING: the return value is not thread safe and should be guarded!
+/// WARNING: the return value is not thread safe and should be guarded! Use npy_get_shape_ex for concurrent calls
 EXPORT(unsigned int*) npy_get_shape(const char* filename, unsigned int* dim);
 
+/// \brief same as npy_get_shape but the shape is stored in the operation context (valid until the next call with the same context)
+EXPORT(unsigned int*) npy_get_shape_ex(int op, const char* filename, unsigned int* dim);
+
 // additional noise function
 EXPORT(int) noise_generate_white(int width, int height, int depth, int layer, int mipmaps, int seed);
 
@@ -11,12 +11,15 @@
 
 #include "GliImage.h"
 #include "interface.h"
+#include "operation_context.h"
+#include "trace.h"
 #include "gli_interface.h"
+#include "source.h"
 
 gli::format convertFormat(VkFormat format);
 VkFormat convertFormat(gli::format);
 
-void set_ktx_image_data(ktxTexture* ktex, GliImage& image)
+void set_ktx_image_data(ktxTexture* ktex, const GliImage& image)
 {
 	// set image data for all layers, faces and levels
 	for (uint32_t layer = 0; layer < image.getNumNonFaceLayers(); ++layer)
@@ -50,13 +53,13 @@ void set_ktx_image_data(ktxTexture* ktex, GliImage& image)
 	}
 }
 
-void ktx1_save_image(const char* filename, GliImage& image, gli::format format, int quality)
+void ktx1_save_image(const char* filename, const GliImage& image, gli::format format, int quality, OperationContext& ctx)
 {
 	// convert format if it does not match
 	if (image.getFormat() != format)
 	{
-		auto tmp = image.convert(format, quality);
-		ktx1_save_image(filename, *tmp, format, quality);
+		auto tmp = image.convert(format, quality, ctx);
+		ktx1_save_image(filename, *tmp, format, quality, ctx);
 		return;
 	}
 
@@ -86,18 +89,24 @@ void ktx1_save_image(const char* filename, GliImage& image, gli::format format,
 	ktxTexture_Destroy(ktxTexture(ktex));
 }
 
-void ktx2_save_image(const char* filename, GliImage& image, gli::format format, int quality)
+void ktx2_save_image(const char* filename, const GliImage& image, gli::format format, int quality, OperationContext& ctx)
 {
+	trace::Scope scope("ktx2_save_image");
 	// convert format if it does not match
 	if(image.getFormat() != format)
 	{
-		if (quality == 100 && GliImageBase::is_bgr_format(format))
+		if (quality == 100 && GliImageBase::is_bgr_format(format) &&
+			format != gli::FORMAT_BGRA8_UNORM_PACK8 && format != gli::FORMAT_BGRA8_SNORM_PACK8) // these formats are properly converted for some reason...
 		{
-			if(format != gli::FORMAT_BGRA8_UNORM_PACK8 && format != gli::FORMAT_BGRA8_SNORM_PACK8) // these formats are properly converted for some reason...
-				image.applyBGRPostprocess(); // do BGR swizzle because default converter does not swizzle
+			// do BGR swizzle because default converter does not swizzle (on a copy, the image stays unchanged)
+			auto swizzled = image.duplicate();
+			swizzled->applyBGRPostprocess();
+			auto tmp = swizzled->convert(format, quality, ctx);
+			ktx2_save_image(filename, *tmp, format, quality, ctx);
+			return;
 		}
-		auto tmp = image.convert(format, quality);
-		ktx2_save_image(filename, *tmp, format, quality);
+		auto tmp = image.convert(format, quality, ctx);
+		ktx2_save_image(filename, *tmp, format, quality, ctx);
 		return;
 	}
 	
@@ -123,12 +132,15 @@ void ktx2_save_image(const char* filename, GliImage& image, gli::format format,
 	if(err != KTX_SUCCESS)
 		throw std::runtime_error(std::string("failed create ktx texture storage: ") + ktxErrorString(err));
 
-	set_ktx_image_data(ktxTexture(ktex), image);
+	{
+		trace::Scope dataScope("ktx2 set data");
+		set_ktx_image_data(ktxTexture(ktex), image);
+	}
 
 	// optionally compress (if it was not already compressed)
 	if(!is_compressed(format) && quality < 100)
 	{
-		set_progress(0, "basis compression");
+		ctx.setProgress(0, "basis compression");
 		ktxBasisParams params = {};
 		params.structSize = sizeof(params);
 		params.threadCount = std::thread::hardware_concurrency();
@@ -148,16 +160,20 @@ void ktx2_save_image(const char* filename, GliImage& image, gli::format format,
 		}
 
 		// optional if compression
+		trace::Scope basisScope("ktx2 basis compression");
 		err = ktxTexture2_CompressBasisEx(ktex, &params);
 		if (err != KTX_SUCCESS)
 			throw std::runtime_error(std::string("failed to compress ktx texture: ") + ktxErrorString(err));
 	}
 	
-	ktxTexture_WriteToNamedFile(ktxTexture(ktex), filename);
+	{
+		trace::Scope writeScope("ktx2 write");
+		ktxTexture_WriteToNamedFile(ktxTexture(ktex), filename);
+	}
 	ktxTexture_Destroy(ktxTexture(ktex));
 }
 
-std::unique_ptr<image::IImage> ktx_load_base(ktxTexture* ktex, gli::format format, gli::format originalFormat)
+std::unique_ptr<image::IImage> ktx_load_base(ktxTexture* ktex, gli::format format, gli::format originalFormat, OperationContext& ctx)
 {
 	// store data in gli storage to be able to convert it easily
 	auto res = std::make_unique<GliImage>(format, originalFormat,
@@ -209,7 +225,7 @@ std::unique_ptr<image::IImage> ktx_load_base(ktxTexture* ktex, gli::format forma
 
 	if (!image::isSupported(res->getFormat()))
 	{
-		res = res->convert(image::getSupportedFormat(res->getFormat()), 100);
+		res = res->convertToSupported(ctx);
 	}
 
 	if (ktex->orientation.y == KTX_ORIENT_Y_UP)
@@ -218,7 +234,7 @@ std::unique_ptr<image::IImage> ktx_load_base(ktxTexture* ktex, gli::format forma
 	return res;
 }
 
-std::unique_ptr<image::IImage> ktx1_load(ktxTexture* ktex)
+std::unique_ptr<image::IImage> ktx1_load(ktxTexture* ktex, OperationContext& ctx)
 {
 	assert(ktex->classId == ktxTexture1_c);
 	ktxTexture1* ktex1 = reinterpret_cast<ktxTexture1*>(ktex);
@@ -231,62 +247,96 @@ std::unique_ptr<image::IImage> ktx1_load(ktxTexture* ktex)
 	if (format == gli::FORMAT_UNDEFINED)
 		throw std::runtime_error("could not interpret format id " + std::to_string(ktex1->glFormat));
 
-	return ktx_load_base(ktex, format, originalFormat);
+	return ktx_load_base(ktex, format, originalFormat, ctx);
+}
+
+// original format of a ktx2 texture (must be called before transcoding)
+static gli::format ktx2_get_original_format(ktxTexture2* ktex2)
+{
+	if (!ktxTexture2_NeedsTranscoding(ktex2))
+		return convertFormat(VkFormat(ktex2->vkFormat)); // no transcoding needed => read format directly
+
+	if(ktex2->supercompressionScheme == KTX_SS_BASIS_LZ) // ETC1S
+        switch (ktxTexture2_GetNumComponents(ktex2))
+        {
+        case 1: // should not happen (no matching srgb format)
+		case 2: // should not happen
+		case 3: return gli::FORMAT_RGB_ETC2_SRGB_BLOCK8;
+		case 4: return gli::FORMAT_RGBA_ETC2_SRGB_BLOCK8;
+        }
+	else // UASTC
+		return gli::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16; // astc has only rgba formats in the enum
+
+	return gli::FORMAT_UNDEFINED;
 }
 
-std::unique_ptr<image::IImage> ktx2_load(ktxTexture* ktex)
+std::unique_ptr<image::IImage> ktx2_load(ktxTexture* ktex, OperationContext& ctx)
 {
 	assert(ktex->classId == ktxTexture2_c);
 	ktxTexture2* ktex2 = reinterpret_cast<ktxTexture2*>(ktex);
 
-	gli::format format = gli::FORMAT_UNDEFINED;
-	gli::format originalFormat = format;
+	const gli::format originalFormat = ktx2_get_original_format(ktex2);
 	if(ktxTexture2_NeedsTranscoding(ktex2)) // transcode from compressed format
 	{
-		const auto compressionSheme = ktex2->supercompressionScheme;
-		auto numComponents = ktxTexture2_GetNumComponents(ktex2);
-		// do transcoding
 		auto err = ktxTexture2_TranscodeBasis(ktex2, KTX_TTF_RGBA32, 0);
 		if (err != KTX_SUCCESS)
 			throw std::runtime_error(std::string("failed to transcode file: ") + ktxErrorString(err));
-		// set format and (previous) original format
-		format = convertFormat(VkFormat(ktex2->vkFormat));
-		if(compressionSheme == KTX_SS_BASIS_LZ) // ETC1S
-            switch (numComponents)
-            {
-            case 1: // should not happen (no matching srgb format)
-			case 2: // should not happen
-			case 3: originalFormat = gli::FORMAT_RGB_ETC2_SRGB_BLOCK8; break;
-			case 4: originalFormat = gli::FORMAT_RGBA_ETC2_SRGB_BLOCK8; break;
-            }
-		else // UASTC
-			originalFormat = gli::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16; // astc has only rgba formats in the enum
 	}
-	else format = originalFormat = convertFormat(VkFormat(ktex2->vkFormat)); // no transcoding needed => read format directly
+	const gli::format format = convertFormat(VkFormat(ktex2->vkFormat));
 
 	if (format == gli::FORMAT_UNDEFINED)
 		throw std::runtime_error("could not translate format id from VK_FORMAT to Image Viewer format. VK_FORMAT: " + std::to_string(ktex2->vkFormat));
 
-	return ktx_load_base(ktex, format, originalFormat);
+	return ktx_load_base(ktex, format, originalFormat, ctx);
 }
 
-std::unique_ptr<image::IImage> ktx_load(const char* filename)
+std::unique_ptr<image::IImage> ktx_load(const Source& src, OperationContext& ctx)
 {
+	trace::Scope scope("ktx_load");
 	ktxTexture* ktex;
-	auto err = ktxTexture_CreateFromNamedFile(filename, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktex);
+	auto err = ktxTexture_CreateFromMemory(src.data(), src.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktex);
 	if (err != KTX_SUCCESS)
 		throw std::runtime_error(std::string("failed to load file: ") + ktxErrorString(err));
 
 	switch (ktex->classId)
 	{
 	case ktxTexture1_c:
-		return ktx1_load(ktex);
+		return ktx1_load(ktex, ctx);
 	case ktxTexture2_c:
-		return ktx2_load(ktex);
+		return ktx2_load(ktex, ctx);
 	}
 	throw std::runtime_error("expected ktx2 texture or ktx1 texture class but got unknown class");
 }
 
+image::Info ktx_probe(const char* filename)
+{
+	// without KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT only the header and the level index are read
+	ktxTexture* ktex;
+	auto err = ktxTexture_CreateFromNamedFile(filename, KTX_TEXTURE_CREATE_NO_FLAGS, &ktex);
+	if (err != KTX_SUCCESS)
+		throw std::runtime_error(std::string("failed to load file: ") + ktxErrorString(err));
+
+	image::Info info;
+	switch (ktex->classId)
+	{
+	case ktxTexture1_c: {
+		auto ktex1 = reinterpret_cast<ktxTexture1*>(ktex);
+		info.originalFormat = get_format_from_GL(ktex1->glInternalformat, ktex1->glFormat, ktex1->glType);
+	} break;
+	case ktxTexture2_c:
+		info.originalFormat = ktx2_get_original_format(reinterpret_cast<ktxTexture2*>(ktex));
+		break;
+	}
+	info.width = ktex->baseWidth;
+	info.height = ktex->baseHeight;
+	info.depth = ktex->baseDepth;
+	info.layers = ktex->numLayers * ktex->numFaces;
+	info.mipmaps = ktex->numLevels;
+
+	ktxTexture_Destroy(ktex);
+	return info;
+}
+
 gli::format convertFormat(VkFormat format)
 {
 	static std::unordered_map<VkFormat, gli::format> lookup = {
@@ -446,7 +496,7 @@ gli::format convertFormat(VkFormat format)
 	{VK_FORMAT_EAC_R11_SNORM_BLOCK, gli::FORMAT_R_EAC_SNORM_BLOCK8 },  
 	{VK_FORMAT_EAC_R11G11_UNORM_BLOCK, gli::FORMAT_RG_EAC_UNORM_BLOCK16 },  
 	{VK_FORMAT_EAC_R11G11_SNORM_BLOCK, gli::FORMAT_RG_EAC_SNORM_BLOCK16 },  
-	{VK_FORMAT_ASTC_4x4_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16 },
+	{VK_FORMAT_ASTC_4x4_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16 },
 	{ VK_FORMAT_ASTC_5x4_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_5X4_UNORM_BLOCK16 },
 	{ VK_FORMAT_ASTC_5x5_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_5X5_UNORM_BLOCK16 },
 	{ VK_FORMAT_ASTC_6x5_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_6X5_UNORM_BLOCK16 },
@@ -460,7 +510,7 @@ gli::format convertFormat(VkFormat format)
 	{ VK_FORMAT_ASTC_10x10_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_10X10_UNORM_BLOCK16 },
 	{ VK_FORMAT_ASTC_12x10_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_12X10_UNORM_BLOCK16 },
 	{ VK_FORMAT_ASTC_12x12_UNORM_BLOCK, gli::FORMAT_RGBA_ASTC_12X12_UNORM_BLOCK16 },
-	{ VK_FORMAT_ASTC_4x4_SRGB_BLOCK, gli::FORMAT_RGBA_ASTC_4X4_SRGB_BLOCK16 },
+	{ VK_FORMAT_ASTC_4x4_SRGB_BLOCK, gli::FORMAT_RGBA_ASTC_4X4_SRGB_BLOCK16 },
 	{ VK_FORMAT_ASTC_5x4_SRGB_BLOCK, gli::FORMAT_RGBA_ASTC_5X4_SRGB_BLOCK16 },
 	{ VK_FORMAT_ASTC_5x5_SRGB_BLOCK, gli::FORMAT_RGBA_ASTC_5X5_SRGB_BLOCK16 },
 	{ VK_FORMAT_ASTC_6x5_SRGB_BLOCK, gli::FORMAT_RGBA_ASTC_6X5_SRGB_BLOCK16 },
@@ -774,109 +824,109 @@ VkFormat convertFormat(gli::format format)
 	return VK_FORMAT_UNDEFINED;
 }
 
-std::vector<uint32_t> ktx_get_export_formats()
-{
-	return std::vector<uint32_t>{
-
-		// uniform
-		gli::format::FORMAT_RG3B2_UNORM_PACK8,
-			gli::format::FORMAT_RGBA4_UNORM_PACK16,
-			gli::format::FORMAT_BGRA4_UNORM_PACK16,
-			gli::format::FORMAT_R5G6B5_UNORM_PACK16,
-			gli::format::FORMAT_B5G6R5_UNORM_PACK16,
-			//gli::format::FORMAT_RGB5A1_UNORM_PACK16,
-			//gli::format::FORMAT_BGR5A1_UNORM_PACK16,
-			gli::format::FORMAT_R8_UNORM_PACK8,
+std::vector<uint32_t> ktx_get_export_formats()
+{
+	return std::vector<uint32_t>{
+
+		// uniform
+		gli::format::FORMAT_RG3B2_UNORM_PACK8,
+			gli::format::FORMAT_RGBA4_UNORM_PACK16,
+			gli::format::FORMAT_BGRA4_UNORM_PACK16,
+			gli::format::FORMAT_R5G6B5_UNORM_PACK16,
+			gli::format::FORMAT_B5G6R5_UNORM_PACK16,
+			//gli::format::FORMAT_RGB5A1_UNORM_PACK16,
+			//gli::format::FORMAT_BGR5A1_UNORM_PACK16,
+			gli::format::FORMAT_R8_UNORM_PACK8,
 			gli::format::FORMAT_R8_SNORM_PACK8,
 			gli::FORMAT_R8_UINT_PACK8,
-			gli::FORMAT_R8_SINT_PACK8,
-			gli::format::FORMAT_RG8_UNORM_PACK8,
+			gli::FORMAT_R8_SINT_PACK8,
+			gli::format::FORMAT_RG8_UNORM_PACK8,
 			gli::format::FORMAT_RG8_SNORM_PACK8,
 			gli::FORMAT_RG8_UINT_PACK8,
-			gli::FORMAT_RG8_SINT_PACK8,
-			gli::format::FORMAT_RGB8_UNORM_PACK8,
-			gli::format::FORMAT_RGB8_SNORM_PACK8,
+			gli::FORMAT_RG8_SINT_PACK8,
+			gli::format::FORMAT_RGB8_UNORM_PACK8,
+			gli::format::FORMAT_RGB8_SNORM_PACK8,
 			gli::format::FORMAT_RGB8_SRGB_PACK8,
 			gli::FORMAT_RGB8_UINT_PACK8,
-			gli::FORMAT_RGB8_SINT_PACK8,
-			gli::format::FORMAT_BGR8_UNORM_PACK8,
-			gli::format::FORMAT_BGR8_SNORM_PACK8,
+			gli::FORMAT_RGB8_SINT_PACK8,
+			gli::format::FORMAT_BGR8_UNORM_PACK8,
+			gli::format::FORMAT_BGR8_SNORM_PACK8,
 			gli::format::FORMAT_BGR8_SRGB_PACK8,
 			// those give some block size mismatch error from gli:
 			//gli::FORMAT_BGR8_UINT_PACK8,
-			//gli::FORMAT_BGR8_SINT_PACK8,
-			gli::format::FORMAT_RGBA8_UNORM_PACK8,
-			gli::format::FORMAT_RGBA8_SNORM_PACK8,
+			//gli::FORMAT_BGR8_SINT_PACK8,
+			gli::format::FORMAT_RGBA8_UNORM_PACK8,
+			gli::format::FORMAT_RGBA8_SNORM_PACK8,
 			gli::format::FORMAT_RGBA8_SRGB_PACK8,
 			gli::FORMAT_RGBA8_UINT_PACK8,
-			gli::FORMAT_RGBA8_SINT_PACK8,
-			gli::format::FORMAT_BGRA8_UNORM_PACK8,
-			gli::format::FORMAT_BGRA8_SNORM_PACK8,
+			gli::FORMAT_RGBA8_SINT_PACK8,
+			gli::format::FORMAT_BGRA8_UNORM_PACK8,
+			gli::format::FORMAT_BGRA8_SNORM_PACK8,
 			gli::format::FORMAT_BGRA8_SRGB_PACK8,
 			gli::FORMAT_BGRA8_UINT_PACK8,
-			gli::FORMAT_BGRA8_SINT_PACK8,
-			gli::format::FORMAT_RGBA8_UNORM_PACK32,
-			gli::format::FORMAT_RGBA8_SNORM_PACK32,
+			gli::FORMAT_BGRA8_SINT_PACK8,
+			gli::format::FORMAT_RGBA8_UNORM_PACK32,
+			gli::format::FORMAT_RGBA8_SNORM_PACK32,
 			gli::format::FORMAT_RGBA8_SRGB_PACK32,
 			gli::FORMAT_RGBA8_UINT_PACK32,
-			gli::FORMAT_RGBA8_SINT_PACK32,
+			gli::FORMAT_RGBA8_SINT_PACK32,
 			gli::format::FORMAT_RGB10A2_UNORM_PACK32,
 			//gli::FORMAT_RGB10A2_UINT_PACK32, // no gl format in core
-			//gli::FORMAT_RGB10A2_SINT_PACK32,
-			//gli::format::FORMAT_BGR10A2_UNORM_PACK32,
+			//gli::FORMAT_RGB10A2_SINT_PACK32,
+			//gli::format::FORMAT_BGR10A2_UNORM_PACK32,
 			//gli::format::FORMAT_BGR10A2_SNORM_PACK32,
 			//gli::FORMAT_BGR10A2_UINT_PACK32,
-			//gli::FORMAT_BGR10A2_SINT_PACK32,
-			//gli::format::FORMAT_A8_UNORM_PACK8,
-			//gli::format::FORMAT_A16_UNORM_PACK16,
-			//gli::format::FORMAT_BGR8_UNORM_PACK32,
-			//gli::format::FORMAT_BGR8_SRGB_PACK32,
-
-			// float formats
-			gli::format::FORMAT_R16_UNORM_PACK16,
+			//gli::FORMAT_BGR10A2_SINT_PACK32,
+			//gli::format::FORMAT_A8_UNORM_PACK8,
+			//gli::format::FORMAT_A16_UNORM_PACK16,
+			//gli::format::FORMAT_BGR8_UNORM_PACK32,
+			//gli::format::FORMAT_BGR8_SRGB_PACK32,
+
+			// float formats
+			gli::format::FORMAT_R16_UNORM_PACK16,
 			gli::format::FORMAT_R16_SNORM_PACK16,
 			gli::FORMAT_R16_UINT_PACK16,
-			gli::FORMAT_R16_SINT_PACK16,
-			gli::format::FORMAT_R16_SFLOAT_PACK16,
-			gli::format::FORMAT_RG16_UNORM_PACK16,
-			gli::format::FORMAT_RG16_SNORM_PACK16,
+			gli::FORMAT_R16_SINT_PACK16,
+			gli::format::FORMAT_R16_SFLOAT_PACK16,
+			gli::format::FORMAT_RG16_UNORM_PACK16,
+			gli::format::FORMAT_RG16_SNORM_PACK16,
 			gli::format::FORMAT_RG16_SFLOAT_PACK16,
 			gli::FORMAT_RG16_UINT_PACK16,
-			gli::FORMAT_RG16_SINT_PACK16,
-			gli::format::FORMAT_RGB16_UNORM_PACK16,
-			gli::format::FORMAT_RGB16_SNORM_PACK16,
+			gli::FORMAT_RG16_SINT_PACK16,
+			gli::format::FORMAT_RGB16_UNORM_PACK16,
+			gli::format::FORMAT_RGB16_SNORM_PACK16,
 			gli::format::FORMAT_RGB16_SFLOAT_PACK16,
 			gli::FORMAT_RGB16_UINT_PACK16,
-			gli::FORMAT_RGB16_SINT_PACK16,
-			gli::format::FORMAT_RGBA16_UNORM_PACK16,
-			gli::format::FORMAT_RGBA16_SNORM_PACK16,
+			gli::FORMAT_RGB16_SINT_PACK16,
+			gli::format::FORMAT_RGBA16_UNORM_PACK16,
+			gli::format::FORMAT_RGBA16_SNORM_PACK16,
 			gli::format::FORMAT_RGBA16_SFLOAT_PACK16,
 			gli::FORMAT_RGBA16_UINT_PACK16,
-			gli::FORMAT_RGBA16_SINT_PACK16,
+			gli::FORMAT_RGBA16_SINT_PACK16,
 			gli::format::FORMAT_R32_SFLOAT_PACK32,
 			gli::FORMAT_R32_UINT_PACK32,
-			gli::FORMAT_R32_SINT_PACK32,
+			gli::FORMAT_R32_SINT_PACK32,
 			gli::format::FORMAT_RG32_SFLOAT_PACK32,
 			gli::FORMAT_RG32_UINT_PACK32,
-			gli::FORMAT_RG32_SINT_PACK32,
+			gli::FORMAT_RG32_SINT_PACK32,
 			gli::format::FORMAT_RGB32_SFLOAT_PACK32,
 			gli::FORMAT_RGB32_UINT_PACK32,
-			gli::FORMAT_RGB32_SINT_PACK32,
+			gli::FORMAT_RGB32_SINT_PACK32,
 			gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
 			gli::FORMAT_RGBA32_UINT_PACK32,
-			gli::FORMAT_RGBA32_SINT_PACK32,
-			gli::format::FORMAT_RG11B10_UFLOAT_PACK32,
-			gli::format::FORMAT_RGB9E5_UFLOAT_PACK32,
-
-			// dds compressed
-			// DXT
-			gli::format::FORMAT_RGB_DXT1_UNORM_BLOCK8,
-			gli::format::FORMAT_RGB_DXT1_SRGB_BLOCK8,
-			gli::format::FORMAT_RGBA_DXT1_UNORM_BLOCK8,
-			gli::format::FORMAT_RGBA_DXT1_SRGB_BLOCK8,
+			gli::FORMAT_RGBA32_SINT_PACK32,
+			gli::format::FORMAT_RG11B10_UFLOAT_PACK32,
+			gli::format::FORMAT_RGB9E5_UFLOAT_PACK32,
+
+			// dds compressed
+			// DXT
+			gli::format::FORMAT_RGB_DXT1_UNORM_BLOCK8,
+			gli::format::FORMAT_RGB_DXT1_SRGB_BLOCK8,
+			gli::format::FORMAT_RGBA_DXT1_UNORM_BLOCK8,
+			gli::format::FORMAT_RGBA_DXT1_SRGB_BLOCK8,
 			gli::format::FORMAT_RGBA_DXT3_UNORM_BLOCK16,
-			gli::format::FORMAT_RGBA_DXT3_SRGB_BLOCK16,
-			gli::format::FORMAT_RGBA_DXT5_SRGB_BLOCK16,
+			gli::format::FORMAT_RGBA_DXT3_SRGB_BLOCK16,
+			gli::format::FORMAT_RGBA_DXT5_SRGB_BLOCK16,
 			gli::format::FORMAT_RGBA_DXT5_UNORM_BLOCK16,
 			gli::format::FORMAT_R_ATI1N_UNORM_BLOCK8,
 			gli::format::FORMAT_R_ATI1N_SNORM_BLOCK8,
@@ -945,8 +995,8 @@ std::vector<uint32_t> ktx_get_export_formats()
 			gli::format::FORMAT_LA8_UNORM_PACK8,
 			gli::format::FORMAT_L16_UNORM_PACK16,
 			gli::format::FORMAT_LA16_UNORM_PACK16,
-			*/
-	};
+			*/
+	};
 }
 
 std::vector<uint32_t> ktx2_get_export_formats()
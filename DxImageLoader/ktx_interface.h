@@ -2,10 +2,14 @@
 #include <memory>
 #include "GliImage.h"
 
+class OperationContext;
+class Source;
+
 // loads ktx or ktx2
-std::unique_ptr<image::IImage> ktx_load(const char* filename);
+std::unique_ptr<image::IImage> ktx_load(const Source& src, OperationContext& ctx);
+image::Info ktx_probe(const char* filename);
 std::vector<uint32_t> ktx_get_export_formats();
 std::vector<uint32_t> ktx2_get_export_formats();
 
-void ktx1_save_image(const char* filename, GliImage& image, gli::format format, int quality);
-void ktx2_save_image(const char* filename, GliImage& image, gli::format format, int quality);
\ No newline at end of file
+void ktx1_save_image(const char* filename, const GliImage& image, gli::format format, int quality, OperationContext& ctx);
+void ktx2_save_image(const char* filename, const GliImage& image, gli::format format, int quality, OperationContext& ctx);
\ No newline at end of file
@@ -18,10 +18,11 @@ public:
 
 		for(int i = 0; i < mipmaps; ++i)
 		{
-			std::vector<uint32_t> data;
-			data.resize(size_t(getWidth(i)) * size_t(getHeight(i)) * size_t(getDepth(i)));
-			for(auto& v : data)
-				v = glm::packUnorm4x8(glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f));
+			const size_t count = size_t(getWidth(i)) * size_t(getHeight(i)) * size_t(getDepth(i));
+			image::PixelBuffer data(count * sizeof(uint32_t));
+			auto values = reinterpret_cast<uint32_t*>(data.data());
+			for(size_t j = 0; j < count; ++j)
+				values[j] = glm::packUnorm4x8(glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f));
 
 			m_values.push_back(move(data));
 		}
@@ -36,8 +37,8 @@ public:
 	gli::format getOriginalFormat() const override { return gli::format::FORMAT_RGBA8_UNORM_PACK8; }
 	uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) override
 	{
-		size = m_values.at(mipmap).size() * sizeof(m_values[0][0]);
-		return reinterpret_cast<uint8_t*>(m_values.at(mipmap).data());
+		size = m_values.at(mipmap).size();
+		return m_values.at(mipmap).data();
 	}
 	const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const override
 	{
@@ -52,7 +53,7 @@ private:
 	int m_mipmaps = 0;
 	uint32_t m_size = 0;
 
-	std::vector<std::vector<uint32_t>> m_values;
+	std::vector<image::PixelBuffer> m_values;
 };
 
 std::unique_ptr<image::IImage> noise_get_white_noise(int width, int height, int depth, int layer, int mipmaps, int seed)
@@ -2,6 +2,8 @@
 #include <memory>
 #include "Image.h"
 
+class OperationContext;
+
 std::unique_ptr<image::IImage> noise_get_white_noise(int width, int height, int depth, int layer, int mipmaps, int seed);
 
-std::unique_ptr<image::IImage> noise_get_blue_noise(int width, int height, int depth, int layer, int mipmaps);
\ No newline at end of file
+std::unique_ptr<image::IImage> noise_get_blue_noise(int width, int height, int depth, int layer, int mipmaps, OperationContext& ctx);
\ No newline at end of file
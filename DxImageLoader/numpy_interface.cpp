@@ -7,36 +7,28 @@
 #include "npy.h"
 #include "convert.h"
 #include "interface.h"
+#include "operation_context.h"
+#include "source.h"
+#include "trace.h"
 using namespace npy;
 
-unsigned* npy_get_shape(const char* filename, unsigned int* dim)
+std::vector<unsigned int> numpy_get_shape(const char* filename)
 {
 	std::ifstream stream(filename, std::ifstream::binary);
 	if (!stream)
-	{
-		set_error("could not open file");
-		return nullptr;
-	}
+		throw std::runtime_error("could not open file");
 
 	std::string header_s = read_header(stream);
 	// parse header
 	header_t header = parse_header(header_s);
 	
-	static std::vector<unsigned int> s_shape;
-	s_shape.assign(header.shape.begin(), header.shape.end());
-	
 	if (std::any_of(header.shape.begin(), header.shape.end(), [](ndarray_len_t i){
 		return i > static_cast<ndarray_len_t>(std::numeric_limits<unsigned int>::max());
 		}
 	))
-	{
-		set_error("one of the shape dimensions is larger than 32bit (too large for import)");
-		return nullptr;
-	}
-
-	if(dim) *dim = unsigned(s_shape.size());
+		throw std::runtime_error("one of the shape dimensions is larger than 32bit (too large for import)");
 
-	return s_shape.data();
+	return std::vector<unsigned int>(header.shape.begin(), header.shape.end());
 }
 
 static bool NumpyIs3D()
@@ -59,262 +51,239 @@ static int NumpyLastLayer()
 	return get_global_parameter_i("npy lastLayer", -1);
 }
 
-class NumpyImage final : public image::IImage
+// original (single channel) format of the array data type
+static gli::format getOriginalFormat(const dtype_t& dtype)
 {
-public:
-	NumpyImage(const char* filename)
+	switch (dtype.kind)
 	{
-		// load numpy file
-		std::vector<unsigned long> shape;
-		m_data = LoadArrayFromNumpyForceFloat(filename, shape, m_originalFormat);
-		if (shape.empty())
-			throw std::exception("array shape is empty");
-
-		auto nComponents = 1; // for now nComponents is always 1
-
-		// last dimension is usually the channel size. Try to use it as channel size if it is small enough (and texture is at least 2D)
-		if (NumpyUseChannels() && shape.back() <= 4)
+	case 'f': // float kind
+		switch (dtype.itemsize)
 		{
-			nComponents = shape.back();
-			shape.pop_back(); // remove from list
+		case sizeof(float): return gli::format::FORMAT_R32_SFLOAT_PACK32;
+		case sizeof(double): return gli::format::FORMAT_R64_SFLOAT_PACK64;
 		}
-
-		// reverse shape (width is always the last dimension, then height, depth...)
-		std::reverse(shape.begin(), shape.end());
-		
-		// split shape information into width, height, layers and components (image format)
-		if(!shape.empty())
-			m_width = shape[0];
-		if (shape.size() > 1)
-			m_height = shape[1];
-		if (shape.size() > 2)
-			m_depth = calcRemainingDimensions(shape, 2);
-
-		// pad format to fit 4 components
-		switch (nComponents)
+		throw std::runtime_error("unsupported itemsize for float kind");
+	case 'i': // integer kind
+		switch (dtype.itemsize)
 		{
-		case 1: // pad with 3 additional floats
-			m_data.resize(m_data.size() * 4);
-			image::expandRtoRGBA(m_data.data(), m_width * m_height * m_depth, 1.0f);
-			break;
-		case 2:
-			m_data.resize(m_data.size() * 2);
-			image::expandRGtoRGBA(m_data.data(), m_width * m_height * m_depth, 0.0f, 1.0f);
-			break;
-		case 3:
-			m_data.resize(m_width * m_height * m_depth * 4);
-			image::expandRGBtoRGBA(m_data.data(), m_width * m_height * m_depth, 1.0f);
-			break;
-		case 4: break; // everything is ok
-		default:
-			assert(false);
+		case sizeof(char): return gli::format::FORMAT_R8_SINT_PACK8;
+		case sizeof(short): return gli::format::FORMAT_R16_SINT_PACK16;
+		case sizeof(int): return gli::format::FORMAT_R32_SINT_PACK32;
+		case sizeof(long long): return gli::format::FORMAT_R64_SINT_PACK64;
 		}
-
-		// determine if data needs to be cropped
-		uint32_t firstLayer = NumpyFirstLayer();
-		uint32_t lastLayer = NumpyLastLayer();
-		if (lastLayer == unsigned(-1))
-			lastLayer = m_depth - 1u;
-
-		// crop data if required
-		if(firstLayer != 0 || unsigned(lastLayer) != (m_depth - 1u))
+		throw std::runtime_error("unsupported itemsize for integer kind");
+	case 'u': // unsigned integer kind
+		switch (dtype.itemsize)
 		{
-			size_t sliceSize = size_t(m_width) * size_t(m_height) * 4;
-
-			std::vector<float> newData;
-			newData.assign(m_data.data() + sliceSize * firstLayer, m_data.data() + sliceSize * (lastLayer + 1));
-			m_data = std::move(newData);
-			m_depth = lastLayer - firstLayer + 1;
+		case sizeof(unsigned char): return gli::format::FORMAT_R8_UINT_PACK8;
+		case sizeof(unsigned short): return gli::format::FORMAT_R16_UINT_PACK16;
+		case sizeof(unsigned int): return gli::format::FORMAT_R32_UINT_PACK32;
+		case sizeof(unsigned long long): return gli::format::FORMAT_R64_UINT_PACK64;
 		}
+		throw std::runtime_error("unsupported itemsize for integer kind");
+	//case 'c': // complex kind (float2)
+	//	throw std::runtime_error("unsupported complex kind");
 	}
+	std::stringstream ss;
+	ss << "unsupported kind: " << dtype.kind;
+	throw std::runtime_error(ss.str());
+}
 
-	uint32_t getNumLayers() const override { return NumpyIs3D() ? 1 : m_depth; }
-	uint32_t getNumMipmaps() const override { return 1; }
-	uint32_t getWidth(uint32_t mipmap) const override { return m_width; }
-	uint32_t getHeight(uint32_t mipmap) const override { return m_height; }
-	uint32_t getDepth(uint32_t mipmap) const override { return NumpyIs3D() ? m_depth : 1; }
-	gli::format getFormat() const override { return gli::FORMAT_RGBA32_SFLOAT_PACK32; }
-	gli::format getOriginalFormat() const override { return m_originalFormat; }
-	uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) override
-	{
-		if (NumpyIs3D())
-		{
-			assert(layer == 0);
-			assert(mipmap == 0);
-			size = m_data.size() * sizeof(float);
-			return reinterpret_cast<uint8_t*>(m_data.data());
-		}
-		else
-		{
-			assert(mipmap == 0);
-			size = m_data.size() * sizeof(float) / m_depth;
-			return reinterpret_cast<uint8_t*>(m_data.data()) + size * layer;
-		}
-	}
-	const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const override
-	{
-		return const_cast<NumpyImage*>(this)->getData(layer, mipmap, size);
-	}
-
-private:
+// image dimensions derived from the array shape
+struct NumpyLayout
+{
+	uint32_t nComponents = 1;
+	uint32_t width = 1;
+	uint32_t height = 1;
+	uint32_t depth = 1; // all remaining dimensions
+};
 
-	template<typename T>
-	static void fixEndian(T* data, size_t size, char dataEndian, char hostEndian)
+static NumpyLayout calcLayout(std::vector<unsigned long> shape)
+{
+	NumpyLayout l;
+	// last dimension is usually the channel size. Try to use it as channel size if it is small enough (and texture is at least 2D)
+	if (NumpyUseChannels() && shape.back() <= 4)
 	{
-		if (dataEndian == no_endian_char) return; // nothing do do
-		if (dataEndian == hostEndian) return;
-		if (sizeof(T) == 1) return;
-
-		// reverse bit order
-		for (const auto end = data + size; data != end; ++data)
-		{
-			char* byteStart = reinterpret_cast<char*>(data);
-			std::reverse(byteStart, byteStart + sizeof(T));
-		}
-
+		l.nComponents = shape.back();
+		shape.pop_back(); // remove from list
 	}
-    static std::vector <float> LoadArrayFromNumpyForceFloat(const char* filename, std::vector<unsigned long>& shape, gli::format& originalFormat)
-    {
-    	std::ifstream stream(filename, std::ifstream::binary);
-        if (!stream) {
-            throw std::runtime_error("io error: failed to open a file.");
-        }
-
-        std::string header_s = read_header(stream);
 
-        // parse header
-        header_t header = parse_header(header_s);
+	// reverse shape (width is always the last dimension, then height, depth...)
+	std::reverse(shape.begin(), shape.end());
 
-		std::vector<float> data; // output
-		std::vector<char> tmpData; // tmp buffer
+	// split shape information into width, height, layers and components (image format)
+	if (!shape.empty())
+		l.width = shape[0];
+	if (shape.size() > 1)
+		l.height = shape[1];
+	for (size_t i = 2; i < shape.size(); ++i)
+		l.depth *= shape[i];
 
+	return l;
+}
 
-        shape = header.shape;
-        //fortran_order = header.fortran_order;
-
-        // compute the data size based on the shape
-        auto size = static_cast<size_t>(comp_size(shape));
-		tmpData.resize(size * header.dtype.itemsize);
-		data.resize(size);
+// converts count values of type T to float. The values are read with memcpy because
+// the array data in the file has no alignment guarantees
+template<typename T>
+static void convertToFloat(const uint8_t* src, size_t count, bool swapBytes, float* dst)
+{
+	uint8_t bytes[sizeof(T)];
+	for (const auto end = dst + count; dst != end; ++dst, src += sizeof(T))
+	{
+		std::copy_n(src, sizeof(T), bytes);
+		if (swapBytes) std::reverse(bytes, bytes + sizeof(T));
+		T value;
+		memcpy(&value, bytes, sizeof(T));
+		*dst = float(value);
+	}
+}
 
-        // read the data raw
-        stream.read(tmpData.data(), header.dtype.itemsize * size);
+// converts count array values of the given data type to float
+static void convertToFloat(const dtype_t& dtype, const uint8_t* src, size_t count, float* dst)
+{
+	const bool swapBytes = dtype.byteorder != no_endian_char && dtype.byteorder != host_endian_char;
 
-		// convert to float format
-		switch (header.dtype.kind)
+	switch (dtype.kind)
+	{
+	case 'f': // float kind
+		switch (dtype.itemsize)
 		{
-		case 'f': // float kind
-			switch (header.dtype.itemsize)
-			{
-			case sizeof(float):
-				fixEndian(reinterpret_cast<float*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<float*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R32_SFLOAT_PACK32;
-				break;
-			case sizeof(double):
-			// same as double
-			//case sizeof(long double):
-				fixEndian(reinterpret_cast<double*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<double*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R64_SFLOAT_PACK64;
-				break;
-			default:
-				throw std::runtime_error("unsupported itemsize for float kind");
-			}
-			break;
-		case 'i': // integer kind
-			switch (header.dtype.itemsize)
-			{
-			case sizeof(char):
-				std::copy_n(reinterpret_cast<char*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R8_SINT_PACK8;
-				break;
-			case sizeof(short):
-				fixEndian(reinterpret_cast<short*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<short*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R16_SINT_PACK16;
-				break;
-			case sizeof(int):
-				fixEndian(reinterpret_cast<int*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<int*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R32_SINT_PACK32;
-				break;
-			case sizeof(long long):
-				fixEndian(reinterpret_cast<long long*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<long long*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R64_SINT_PACK64;
-				break;
-			default:
-				throw std::runtime_error("unsupported itemsize for integer kind");
-			}
-			break;
-		case 'u': // unsigned integer kind
-			switch (header.dtype.itemsize)
-			{
-			case sizeof(unsigned char):
-				std::copy_n(reinterpret_cast<unsigned char*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R8_UINT_PACK8;
-				break;
-			case sizeof(unsigned short):
-				fixEndian(reinterpret_cast<unsigned short*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<unsigned short*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R16_UINT_PACK16;
-				break;
-			case sizeof(unsigned int):
-				fixEndian(reinterpret_cast<unsigned int*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<unsigned int*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R32_UINT_PACK32;
-				break;
-			case sizeof(unsigned long long):
-				fixEndian(reinterpret_cast<unsigned long long*>(tmpData.data()), size, header.dtype.byteorder, host_endian_char);
-				std::copy_n(reinterpret_cast<unsigned long long*>(tmpData.data()), size, data.begin());
-				originalFormat = gli::format::FORMAT_R64_UINT_PACK64;
-				break;
-			default:
-				throw std::runtime_error("unsupported itemsize for integer kind");
-			}
-			break;
-		//case 'c': // complex kind (float2)
-		//	throw std::runtime_error("unsupported complex kind");
-		default:
-			std::stringstream ss;
-			ss << "unsupported kind: " << header.dtype.kind;
-			throw std::runtime_error(ss.str());
+		case sizeof(float):
+			convertToFloat<float>(src, count, swapBytes, dst);
+			return;
+		case sizeof(double):
+		// same as double
+		//case sizeof(long double):
+			convertToFloat<double>(src, count, swapBytes, dst);
+			return;
+		}
+		throw std::runtime_error("unsupported itemsize for float kind");
+	case 'i': // integer kind
+		switch (dtype.itemsize)
+		{
+		case sizeof(char):
+			convertToFloat<char>(src, count, false, dst);
+			return;
+		case sizeof(short):
+			convertToFloat<short>(src, count, swapBytes, dst);
+			return;
+		case sizeof(int):
+			convertToFloat<int>(src, count, swapBytes, dst);
+			return;
+		case sizeof(long long):
+			convertToFloat<long long>(src, count, swapBytes, dst);
+			return;
 		}
+		throw std::runtime_error("unsupported itemsize for integer kind");
+	case 'u': // unsigned integer kind
+		switch (dtype.itemsize)
+		{
+		case sizeof(unsigned char):
+			convertToFloat<unsigned char>(src, count, false, dst);
+			return;
+		case sizeof(unsigned short):
+			convertToFloat<unsigned short>(src, count, swapBytes, dst);
+			return;
+		case sizeof(unsigned int):
+			convertToFloat<unsigned int>(src, count, swapBytes, dst);
+			return;
+		case sizeof(unsigned long long):
+			convertToFloat<unsigned long long>(src, count, swapBytes, dst);
+			return;
+		}
+		throw std::runtime_error("unsupported itemsize for integer kind");
+	//case 'c': // complex kind (float2)
+	//	throw std::runtime_error("unsupported complex kind");
+	}
+	std::stringstream ss;
+	ss << "unsupported kind: " << dtype.kind;
+	throw std::runtime_error(ss.str());
+}
 
-		return data;
-    }
-	static gli::format getFloatFormat(int nComponents)
-    {
-	    switch (nComponents)
-	    {
-		case 1: return gli::format::FORMAT_R32_SFLOAT_PACK32;
-		case 2: return gli::format::FORMAT_RG32_SFLOAT_PACK32;
-		case 3: return gli::format::FORMAT_RGB32_SFLOAT_PACK32;
-		case 4: return gli::format::FORMAT_RGBA32_SFLOAT_PACK32;
-	    }
-		assert(false);
-		return gli::format::FORMAT_UNDEFINED;
-    }
-	static uint32_t calcRemainingDimensions(const std::vector<unsigned long>& shape, size_t startIndex)
-    {
-		uint32_t size = 1;
-	    for(size_t i = startIndex; i < shape.size(); ++i)
-			size *= shape[i];
-		
-		return size;
-    }
-
-	std::vector<float> m_data;
-	gli::format m_originalFormat = gli::format::FORMAT_UNDEFINED;
-	uint32_t m_width = 1;
-	uint32_t m_height = 1;
-	uint32_t m_depth = 1;
-};
+static image::ChannelLayout getChannelLayout(uint32_t nComponents)
+{
+	switch (nComponents)
+	{
+	case 1: return image::ChannelLayout::Gray;
+	case 2: return image::ChannelLayout::RG;
+	case 3: return image::ChannelLayout::RGB;
+	case 4: return image::ChannelLayout::RGBA;
+	}
+	throw std::runtime_error("unsupported number of channels");
+}
 
-std::unique_ptr<image::IImage> numpy_load(const char* filename)
+std::unique_ptr<image::IImage> numpy_load(const Source& src, OperationContext& ctx)
 {
-	return std::make_unique<NumpyImage>(filename);
+	trace::Scope scope("numpy_load");
+	MemoryStreamBuffer buffer(src.data(), src.size());
+	std::istream stream(&buffer);
+
+	header_t header = parse_header(read_header(stream));
+	if (header.shape.empty())
+		throw std::exception("array shape is empty");
+
+	const auto layout = calcLayout(header.shape);
+	const auto originalFormat = getOriginalFormat(header.dtype);
+
+	// determine if data needs to be cropped
+	uint32_t firstLayer = NumpyFirstLayer();
+	uint32_t lastLayer = NumpyLastLayer();
+	if (lastLayer == unsigned(-1))
+		lastLayer = layout.depth - 1u;
+	if (firstLayer > lastLayer || lastLayer >= layout.depth)
+		throw std::runtime_error("layer range is outside of the array");
+	const uint32_t depth = lastLayer - firstLayer + 1;
+
+	const size_t size = static_cast<size_t>(comp_size(header.shape));
+	const size_t offset = size_t(stream.tellg());
+	if (header.dtype.itemsize == 0 || offset > src.size() || (src.size() - offset) / header.dtype.itemsize < size)
+		throw std::runtime_error("file is too small for the array shape");
+
+	// the values are stored with the channel count of the array (no padding to RGBA)
+	const bool is3D = NumpyIs3D();
+	auto res = std::make_unique<image::CompactImage>(
+		originalFormat, gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
+		image::ChannelType::Float32, getChannelLayout(layout.nComponents),
+		layout.width, layout.height, is3D ? depth : 1, is3D ? 1 : depth);
+
+	// only the cropped layers are converted, directly from the source memory
+	const size_t sliceSize = size_t(layout.width) * size_t(layout.height) * layout.nComponents;
+	const uint8_t* raw = src.data() + offset + sliceSize * firstLayer * header.dtype.itemsize;
+	size_t compactSize;
+	auto dst = reinterpret_cast<float*>(res->getCompactData(compactSize));
+	assert(compactSize == sliceSize * depth * sizeof(float));
+	convertToFloat(header.dtype, raw, sliceSize * depth, dst);
+
+	return res;
+}
+
+image::Info numpy_probe(const char* filename)
+{
+	std::ifstream stream(filename, std::ifstream::binary);
+	if (!stream)
+		throw std::runtime_error("could not open file");
+
+	header_t header = parse_header(read_header(stream));
+	if (header.shape.empty())
+		throw std::exception("array shape is empty");
+
+	const auto layout = calcLayout(header.shape);
+
+	// same cropping as numpy_load
+	uint32_t depth = layout.depth;
+	uint32_t firstLayer = NumpyFirstLayer();
+	uint32_t lastLayer = NumpyLastLayer();
+	if (lastLayer == unsigned(-1))
+		lastLayer = depth - 1u;
+	depth = lastLayer - firstLayer + 1;
+
+	image::Info info;
+	info.originalFormat = getOriginalFormat(header.dtype);
+	info.width = layout.width;
+	info.height = layout.height;
+	if (NumpyIs3D()) info.depth = depth;
+	else info.layers = depth;
+	return info;
 }
 
 std::vector<uint32_t> numpy_get_export_formats()
@@ -365,9 +334,10 @@ std::vector<uint32_t> numpy_get_export_formats()
 
 
 template<class T>
-void numpy_save_t(const char* filename, const image::IImage* image, uint32_t nChannels, glm::vec4 minClamp, glm::vec4 maxClamp)
+void numpy_save_t(const char* filename, const image::IImage* image, uint32_t nChannels, glm::vec4 minClamp, glm::vec4 maxClamp, OperationContext& ctx)
 {
-	assert(image->getFormat() == gli::FORMAT_RGBA32_SFLOAT_PACK32);
+	assert(image->getFormat() == gli::FORMAT_RGBA32_SFLOAT_PACK32 || image->getFormat() == gli::FORMAT_RGBA16_SFLOAT_PACK16);
+	const bool isHalf = image->getFormat() == gli::FORMAT_RGBA16_SFLOAT_PACK16;
 
 	unsigned long shape[4] = {
 		static_cast<unsigned long>(image->getDepth(0) * image->getNumLayers()),
@@ -380,10 +350,19 @@ void numpy_save_t(const char* filename, const image::IImage* image, uint32_t nCh
 	outData.resize(shape[0] * shape[1] * shape[2] * shape[3]);
 
 	auto cur = outData.begin();
+	std::vector<glm::vec4> layerData; // float copy of half layers
 	for(size_t layer = 0; layer < image->getNumLayers(); ++layer)
 	{
+		ctx.setProgress(uint32_t(layer * 100 / image->getNumLayers()));
 		size_t size = 0;
 		auto data = image->getData(layer, 0, size);
+		if(isHalf)
+		{
+			layerData.resize(size / (4 * sizeof(uint16_t)));
+			image::halfToFloat(reinterpret_cast<const uint16_t*>(data), reinterpret_cast<float*>(layerData.data()), layerData.size() * 4);
+			data = reinterpret_cast<const uint8_t*>(layerData.data());
+			size = layerData.size() * sizeof(glm::vec4);
+		}
 		auto fdata = reinterpret_cast<const glm::vec4*>(data);
 		auto fdataEnd = fdata + (size / sizeof(glm::vec4));
 
@@ -402,7 +381,7 @@ void numpy_save_t(const char* filename, const image::IImage* image, uint32_t nCh
 	npy::SaveArrayAsNumpy(filename, false, 4u, shape, outData);
 }
 
-void numpy_save(const char* filename, const image::IImage* image, uint32_t format)
+void numpy_save(const char* filename, const image::IImage* image, uint32_t format, OperationContext& ctx)
 {
 	const auto fi = gli::detail::get_format_info(gli::format(format));
 	const auto nChannels = fi.Component;
@@ -415,7 +394,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG32_SFLOAT_PACK32:
 		case gli::format::FORMAT_RGB32_SFLOAT_PACK32:
 		case gli::format::FORMAT_RGBA32_SFLOAT_PACK32:
-			numpy_save_t<float>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<float>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 		// int formats
 		// 32 bit signed
@@ -423,7 +402,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG32_SINT_PACK32:
 		case gli::format::FORMAT_RGB32_SINT_PACK32:
 		case gli::format::FORMAT_RGBA32_SINT_PACK32:
-			numpy_save_t<int32_t>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<int32_t>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 
 		// 32 bit unsigned
@@ -431,7 +410,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG32_UINT_PACK32:
 		case gli::format::FORMAT_RGB32_UINT_PACK32:
 		case gli::format::FORMAT_RGBA32_UINT_PACK32:
-			numpy_save_t<uint32_t>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<uint32_t>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 
 		// 16 bit signed
@@ -439,7 +418,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG16_SINT_PACK16:
 		case gli::format::FORMAT_RGB16_SINT_PACK16:
 		case gli::format::FORMAT_RGBA16_SINT_PACK16:
-			numpy_save_t<int16_t>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<int16_t>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 
 		// 16 bit unsigned
@@ -447,7 +426,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG16_UINT_PACK16:
 		case gli::format::FORMAT_RGB16_UINT_PACK16:
 		case gli::format::FORMAT_RGBA16_UINT_PACK16:
-			numpy_save_t<uint16_t>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<uint16_t>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 
 		// 8 bit signed
@@ -455,7 +434,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG8_SINT_PACK8:
 		case gli::format::FORMAT_RGB8_SINT_PACK8:
 		case gli::format::FORMAT_RGBA8_SINT_PACK8:
-			numpy_save_t<int8_t>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<int8_t>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 
 		// 8 bit unsigned
@@ -463,7 +442,7 @@ void numpy_save(const char* filename, const image::IImage* image, uint32_t forma
 		case gli::format::FORMAT_RG8_UINT_PACK8:
 		case gli::format::FORMAT_RGB8_UINT_PACK8:
 		case gli::format::FORMAT_RGBA8_UINT_PACK8:
-			numpy_save_t<uint8_t>(filename, image, nChannels, minClamp, maxClamp);
+			numpy_save_t<uint8_t>(filename, image, nChannels, minClamp, maxClamp, ctx);
 			break;
 
 	default:
@@ -2,7 +2,13 @@
 #include <memory>
 #include "Image.h"
 
-std::unique_ptr<image::IImage> numpy_load(const char* filename);
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> numpy_load(const Source& src, OperationContext& ctx);
+image::Info numpy_probe(const char* filename);
 std::vector<uint32_t> numpy_get_export_formats();
+// reads the array shape from the header. Throws on failure
+std::vector<unsigned int> numpy_get_shape(const char* filename);
 
-void numpy_save(const char* filename, const image::IImage* image, uint32_t format);
\ No newline at end of file
+void numpy_save(const char* filename, const image::IImage* image, uint32_t format, OperationContext& ctx);
\ No newline at end of file
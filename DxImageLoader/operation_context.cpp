@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "operation_context.h"
+#include <algorithm>
+#include <stdexcept>
+
+void OperationContext::begin()
+{
+	m_error.clear();
+	m_done = 0;
+	m_total = 0;
+	m_description = "";
+	m_lastProgress = uint32_t(-1);
+	m_aborted = false;
+	m_stats.clear();
+}
+
+void OperationContext::beginWork(uint64_t total, const char* description)
+{
+	m_description.store(description ? description : "", std::memory_order_relaxed);
+	m_total.store(total, std::memory_order_relaxed);
+	m_done.store(0, std::memory_order_relaxed);
+	if (m_progressCallback) notify();
+}
+
+void OperationContext::setWork(uint64_t done, uint64_t total)
+{
+	m_total.store(total, std::memory_order_relaxed);
+	m_done.store(done, std::memory_order_relaxed);
+	if (m_progressCallback) notify();
+}
+
+void OperationContext::setProgress(uint32_t progress, const char* description)
+{
+	m_description.store(description ? description : "", std::memory_order_relaxed);
+	setWork(progress, 100);
+	throwIfCancelled();
+}
+
+float OperationContext::getProgress() const
+{
+	const auto total = m_total.load(std::memory_order_relaxed);
+	if (total == 0) return 0.0f;
+	return std::min(1.0f, float(double(m_done.load(std::memory_order_relaxed)) / double(total)));
+}
+
+void OperationContext::notify()
+{
+	const auto progress = uint32_t(getProgress() * 100.0f);
+	// at most one lock per percent
+	if (m_lastProgress.load(std::memory_order_relaxed) == progress) return;
+
+	std::lock_guard<std::mutex> g(m_notifyMutex);
+	if (m_lastProgress.exchange(progress, std::memory_order_relaxed) == progress) return;
+
+	if (m_progressCallback(progress / 100.0f, getDescription()))
+		m_aborted = true;
+}
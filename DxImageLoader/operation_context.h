@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include "interface.h"
+#include "stats.h"
+
+// state of a single load or save operation (error, progress and cancellation).
+// Loaders and exporters report through the context they receive instead of process globals,
+// so multiple operations can run concurrently as long as each one uses its own context.
+class OperationContext
+{
+public:
+	explicit OperationContext(ProgressCallback callback = nullptr) : m_progressCallback(callback) {}
+	OperationContext(const OperationContext&) = delete;
+	OperationContext& operator=(const OperationContext&) = delete;
+
+	// resets error, progress and stats before a new operation starts. Callback and cancellation are kept
+	void begin();
+
+	void setError(const std::string& error) { m_error = error; }
+	const std::string& getError() const { return m_error; }
+
+	void setProgressCallback(ProgressCallback callback) { m_progressCallback = callback; }
+
+	// Progress is stored in atomic counters that the host polls at its own rate (see image_poll_progress).
+	// The optional progress callback is only invoked when the percentage changes.
+	// description must be a string literal (the pointer is returned to the host)
+
+	// starts a new step with total units of work (rows, pixels, layers...)
+	void beginWork(uint64_t total, const char* description = nullptr);
+	// adds finished units to the current step. Only an atomic add and a test of the cancel flag (cheap enough for inner loops).
+	// Throws if the operation was cancelled
+	void addWork(uint64_t units = 1)
+	{
+		addWorkNoThrow(units);
+		throwIfCancelled();
+	}
+	// same as addWork, but does not throw (for callbacks of C libraries that cannot unwind)
+	void addWorkNoThrow(uint64_t units)
+	{
+		m_done.fetch_add(units, std::memory_order_relaxed);
+		if (m_progressCallback) notify();
+	}
+	// sets the finished and total units of the current step. Does not throw (for callbacks of C libraries that cannot unwind)
+	void setWork(uint64_t done, uint64_t total);
+
+	// reports progress in [0, 100]. Throws if the operation should be aborted
+	void setProgress(uint32_t progress, const char* description = nullptr);
+
+	// progress of the current step in [0, 1] and its description. Can be called from any thread
+	float getProgress() const;
+	const char* getDescription() const { return m_description.load(std::memory_order_relaxed); }
+
+	// requests the running operation to abort at its next check of the cancel flag. Can be called from any thread
+	void cancel() { m_cancelled = true; }
+	bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed) || m_aborted.load(std::memory_order_relaxed); }
+	// throws if the operation was cancelled or the progress callback requested an abort
+	void throwIfCancelled() const
+	{
+		if (isCancelled())
+			throw std::runtime_error("aborted by user");
+	}
+
+	// storage for results that are returned as pointers to the caller (see npy_get_shape_ex)
+	std::vector<unsigned int>& getShape() { return m_shape; }
+
+	// time and data of the stages of the current operation (see image_get_stats)
+	Stats& getStats() { return m_stats; }
+
+private:
+	// invokes the progress callback if the percentage changed. An abort request of the callback only sets the abort flag.
+	// Workers of a parallel loop report concurrently => the callback is invoked by one thread at a time
+	void notify();
+
+	std::string m_error;
+	ProgressCallback m_progressCallback = nullptr;
+	std::atomic<uint64_t> m_done = 0;
+	std::atomic<uint64_t> m_total = 0;
+	std::atomic<const char*> m_description = "";
+	std::atomic<uint32_t> m_lastProgress = uint32_t(-1);
+	std::mutex m_notifyMutex;
+	std::atomic<bool> m_cancelled = false;
+	// abort requested by the progress callback (only for the current operation)
+	std::atomic<bool> m_aborted = false;
+	std::vector<unsigned int> m_shape;
+	Stats m_stats;
+};
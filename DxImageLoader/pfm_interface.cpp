@@ -3,8 +3,11 @@
 #include <fstream>
 #include <memory>
 #include <iostream>
+#include <cstring>
 #include "convert.h"
-#include "interface.h"
+#include "operation_context.h"
+#include "source.h"
+#include "trace.h"
 
 using uchar = unsigned char;
 
@@ -21,45 +24,36 @@ struct Pixel
 	float r, g, b;
 };
 
-void skipNewlines(std::fstream& file)
+void skipNewlines(std::istream& file)
 {
 	while (file.peek() == '\n' || file.peek() == 0 || file.peek() == ' ' || file.peek() == '\r' || file.peek() == '\t')
 		file.get();
 }
 
-std::unique_ptr<image::IImage> pfm_load(const char* filename)
+struct PfmHeader
 {
-	// create fstream object to read in pfm file 
-	// open the file in binary
-	std::fstream file(filename, std::ios::in | std::ios::binary);
-	if (!file.is_open())
-		throw std::exception("error opening file");
-
-	//                          "PF" = color        (3-band)
-	int width, height;      // width and height of the image
-	float scalef, fvalue;   // scale factor and temp value to hold pixel value
-	Pixel vfvalue;          // temp value to hold 3-band pixel value
+	std::string bands; // "Pf" = grayscale (1-band), "PF" = color (3-band)
+	int width;
+	int height;
+	float scalef; // scale factor, negative for little endian files
+};
 
-							// extract header information, skips whitespace 
-	//file >> bands;
+// reads the header and leaves the file at the start of the pixel data
+static PfmHeader read_header(std::istream& file)
+{
+	PfmHeader h;
+	// extract header information, skips whitespace 
 	char bandBuffer[3];
 	file.read(bandBuffer, 2);
 	bandBuffer[2] = '\0';
 
-	std::string bands = bandBuffer;
+	h.bands = bandBuffer;
 	skipNewlines(file);
-	file >> width;
+	file >> h.width;
 	skipNewlines(file);
-	file >> height;
+	file >> h.height;
 	skipNewlines(file);
-	file >> scalef;
-
-
-	// determine endianness 
-	int littleEndianFile = (scalef < 0);
-	int littleEndianMachine = image::littleendian();
-	int needSwap = (littleEndianFile != littleEndianMachine);
-	float absScale = std::abs(scalef);
+	file >> h.scalef;
 
 	// skip SINGLE newline character after reading third arg
 	char c = file.get();
@@ -71,17 +65,56 @@ std::unique_ptr<image::IImage> pfm_load(const char* filename)
 		throw std::exception("invalid header - whitespace expected");
 	}
 
-	bool grayscale = (bands == "Pf");
+	return h;
+}
 
-	auto res = std::make_unique<image::SimpleImage>(
-		grayscale ? gli::FORMAT_R32_SFLOAT_PACK32 : gli::FORMAT_RGB32_SFLOAT_PACK32,
-		gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-		width, height, 4 * 4);
+image::Info pfm_probe(const char* filename)
+{
+	std::fstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		throw std::exception("error opening file");
 
-	size_t size;
-	auto data = reinterpret_cast<float*>(res->getData(0, 0, size));
+	const auto header = read_header(file);
+
+	image::Info info;
+	info.originalFormat = header.bands == "Pf" ? gli::FORMAT_R32_SFLOAT_PACK32 : gli::FORMAT_RGB32_SFLOAT_PACK32;
+	info.width = header.width;
+	info.height = header.height;
+	return info;
+}
 
-	if (bands == "Pf") {          // handle 1-band image 
+std::unique_ptr<image::IImage> pfm_load(const Source& src, OperationContext& ctx)
+{
+	trace::Scope scope("pfm_load");
+	MemoryStreamBuffer buffer(src.data(), src.size());
+	std::istream file(&buffer);
+
+	const auto header = read_header(file);
+	const std::string& bands = header.bands;
+	const int width = header.width;
+	const int height = header.height;
+	const float scalef = header.scalef;
+	float fvalue;   // temp value to hold pixel value
+	Pixel vfvalue;  // temp value to hold 3-band pixel value
+
+	// determine endianness 
+	int littleEndianFile = (scalef < 0);
+	int littleEndianMachine = image::littleendian();
+	int needSwap = (littleEndianFile != littleEndianMachine);
+	float absScale = std::abs(scalef);
+
+	std::unique_ptr<image::IImage> res;
+	ctx.beginWork(height);
+
+	if (bands == "Pf") {          // handle 1-band image (kept as single channel, expanded when staged)
+
+		auto img = std::make_unique<image::CompactImage>(
+			gli::FORMAT_R32_SFLOAT_PACK32, gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
+			image::ChannelType::Float32, image::ChannelLayout::Gray,
+			width, height);
+
+		size_t size;
+		auto data = reinterpret_cast<float*>(img->getCompactData(size));
 
 		for (int i = 0; i < height; ++i) {
 			for (int j = 0; j < width; ++j) {
@@ -89,18 +122,22 @@ std::unique_ptr<image::IImage> pfm_load(const char* filename)
 				if (needSwap) {
 					swapBytes(&fvalue);
 				}
-				auto offset = data + ((height - i - 1) * width + j) * 4;
-				fvalue *= absScale; // apply scale
-				offset[0] = fvalue; // grayscale => repeat on each channel
-				offset[1] = fvalue;
-				offset[2] = fvalue;
-				offset[3] = 1.0f; // alpha
+				data[(height - i - 1) * width + j] = fvalue * absScale; // apply scale
 			}
-			set_progress(i * 100 / height);
+			ctx.addWork();
 		}
+		res = std::move(img);
 	}
 	else if (bands == "PF") {    // handle 3-band image
 
+		auto img = std::make_unique<image::SimpleImage>(
+			gli::FORMAT_RGB32_SFLOAT_PACK32,
+			gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
+			width, height, 4 * 4);
+
+		size_t size;
+		auto data = reinterpret_cast<float*>(img->getData(0, 0, size));
+
 		for (int i = 0; i < height; ++i) {
 			for (int j = 0; j < width; ++j) {
 				file.read(reinterpret_cast<char*>(&vfvalue), sizeof(vfvalue));
@@ -115,8 +152,9 @@ std::unique_ptr<image::IImage> pfm_load(const char* filename)
 				offset[2] = vfvalue.b * absScale;
 				offset[3] = 1.0f; // alpha
 			}
-			set_progress(i * 100 / height);
+			ctx.addWork();
 		}
+		res = std::move(img);
 	}
 	else
 		throw std::exception("invalid header - unknown bands description");
@@ -124,6 +162,71 @@ std::unique_ptr<image::IImage> pfm_load(const char* filename)
 	return res;
 }
 
+std::unique_ptr<image::IImage> pfm_load_region(const Source& src, image::Region& region, OperationContext& ctx)
+{
+	trace::Scope scope("pfm_load_region");
+	MemoryStreamBuffer buffer(src.data(), src.size());
+	std::istream file(&buffer);
+
+	const auto header = read_header(file);
+	const bool grayscale = (header.bands == "Pf");
+	if (!grayscale && header.bands != "PF")
+		throw std::exception("invalid header - unknown bands description");
+	if (header.width <= 0 || header.height <= 0)
+		throw std::exception("invalid header - invalid image size");
+	image::checkRegion(region, 1, 1, header.width, header.height);
+
+	// pixels are stored without padding => each row of the region can be addressed directly
+	const size_t pixelSize = (grayscale ? 1 : 3) * sizeof(float);
+	const size_t rowSize = size_t(header.width) * pixelSize;
+	const size_t offset = size_t(file.tellg());
+	if (offset > src.size() || (src.size() - offset) / rowSize < size_t(header.height))
+		throw std::runtime_error("unexpected end of file");
+
+	const bool needSwap = (header.scalef < 0) != (image::littleendian() != 0);
+	const float absScale = std::abs(header.scalef);
+
+	auto res = std::make_unique<image::SimpleImage>(
+		grayscale ? gli::FORMAT_R32_SFLOAT_PACK32 : gli::FORMAT_RGB32_SFLOAT_PACK32,
+		gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
+		region.width, region.height, 4 * 4);
+	ctx.beginWork(region.height);
+
+	size_t size;
+	auto data = reinterpret_cast<float*>(res->getData(0, 0, size));
+
+	for (uint32_t y = 0; y < region.height; ++y)
+	{
+		// rows are stored from bottom to top
+		const size_t fileRow = size_t(header.height) - 1 - (region.y + y);
+		const uint8_t* row = src.data() + offset + fileRow * rowSize + region.x * pixelSize;
+		for (uint32_t x = 0; x < region.width; ++x, row += pixelSize, data += 4)
+		{
+			Pixel p;
+			memcpy(&p, row, pixelSize);
+			if (needSwap)
+			{
+				swapBytes(&p.r);
+				if (!grayscale)
+				{
+					swapBytes(&p.g);
+					swapBytes(&p.b);
+				}
+			}
+			if (grayscale) p.g = p.b = p.r; // grayscale => repeat on each channel
+
+			data[0] = p.r * absScale;
+			data[1] = p.g * absScale;
+			data[2] = p.b * absScale;
+			data[3] = 1.0f; // alpha
+		}
+		ctx.addWork();
+	}
+
+	region = { 0, 0, 0, 0, region.width, region.height };
+	return res;
+}
+
 std::vector<uint32_t> pfm_get_export_formats()
 {
 	return {
@@ -132,10 +235,13 @@ std::vector<uint32_t> pfm_get_export_formats()
 	};
 }
 
-void pfm_save(const char* filename, int width, int height, int components, const void* data)
+void pfm_save(const char* filename, int width, int height, int components, const void* rgba, gli::format rgbaFormat, OperationContext& ctx)
 {
 	if (components != 1 && components != 3) 
 		throw std::runtime_error("pfm supports either 1 or 3 components");
+	if (rgbaFormat != gli::FORMAT_RGBA32_SFLOAT_PACK32 && rgbaFormat != gli::FORMAT_RGBA16_SFLOAT_PACK16)
+		throw std::runtime_error("expected RGBA32F or RGBA16F image format for pfm export");
+	const bool isHalf = rgbaFormat == gli::FORMAT_RGBA16_SFLOAT_PACK16;
 
 	std::ofstream file(filename, std::ios::binary);
 	if (file.bad() || file.fail())
@@ -146,14 +252,25 @@ void pfm_save(const char* filename, int width, int height, int components, const
 
 	file.write("-1.000000\n", sizeof(char) * 10);
 
-	const float* v = reinterpret_cast<const float*>(data);
+	// the first components of each RGBA pixel are copied into a row buffer (rows are stored from bottom to top).
+	// Half rows are converted to float first
+	std::vector<float> row(size_t(width) * components);
+	std::vector<float> halfRow(isHalf ? size_t(width) * 4 : 0);
+	ctx.beginWork(height);
 	for (int y = 0; y < height; ++y)
 	{
+		const size_t rowOffset = size_t(height - y - 1) * width * 4;
+		const float* src = halfRow.data();
+		if (isHalf)
+			image::halfToFloat(reinterpret_cast<const uint16_t*>(rgba) + rowOffset, halfRow.data(), halfRow.size());
+		else
+			src = reinterpret_cast<const float*>(rgba) + rowOffset;
 		for (int x = 0; x < width; ++x)
 		{
 			for (int c = 0; c < components; ++c)
-				file.write(reinterpret_cast<const char*>(&v[c + components * (x + (height - y - 1) * width)]), sizeof(float));
+				row[x * components + c] = src[x * 4 + c];
 		}
-		set_progress(y * 100 / height);
+		file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+		ctx.addWork();
 	}
 }
\ No newline at end of file
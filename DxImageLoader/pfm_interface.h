@@ -2,8 +2,15 @@
 #include "Image.h"
 #include <memory>
 
-std::unique_ptr<image::IImage> pfm_load(const char* filename);
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> pfm_load(const Source& src, OperationContext& ctx);
+// reads only the rows of the region. region is updated to the position of the requested pixels in the returned image
+std::unique_ptr<image::IImage> pfm_load_region(const Source& src, image::Region& region, OperationContext& ctx);
+image::Info pfm_probe(const char* filename);
 
 std::vector<uint32_t> pfm_get_export_formats();
 
-void pfm_save(const char* filename, int width, int height, int components, const void* data);
\ No newline at end of file
+// writes the first components of each pixel of the RGBA32F or RGBA16F data (rgbaFormat)
+void pfm_save(const char* filename, int width, int height, int components, const void* rgba, gli::format rgbaFormat, OperationContext& ctx);
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "pixel_buffer.h"
+#include <malloc.h>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include "interface.h"
+
+namespace
+{
+	struct Block
+	{
+		uint8_t* data;
+		size_t capacity;
+		bool largePages;
+	};
+
+	// released blocks in the order of their release
+	struct Pool
+	{
+		// the list never grows, releasing a buffer must not throw
+		static constexpr size_t maxBlocks = 64;
+		Pool() { blocks.reserve(maxBlocks); }
+
+		std::mutex mutex;
+		std::vector<Block> blocks;
+		size_t size = 0;
+		// maximum size in bytes. Updated on allocation, because buffers are also released
+		// during static destruction when the global parameters are already gone
+		size_t limit = 0;
+	};
+
+	// never destroyed, images in static storage may release their buffers after the statics of this file were destroyed
+	Pool& getPool()
+	{
+		static Pool* pool = new Pool;
+		return *pool;
+	}
+
+	// set after the first failed large page allocation (SeLockMemoryPrivilege is missing)
+	std::atomic<bool> s_largePagesFailed = false;
+
+	// the privilege is disabled in the process token even if the user holds it ("Lock pages in memory").
+	// Returns false if the user does not hold it
+	bool enableLockMemoryPrivilege()
+	{
+		HANDLE token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+			return false;
+
+		TOKEN_PRIVILEGES privileges = {};
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		// AdjustTokenPrivileges succeeds with ERROR_NOT_ALL_ASSIGNED if the privilege is not held
+		const bool enabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+			AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+			GetLastError() == ERROR_SUCCESS;
+		CloseHandle(token);
+		return enabled;
+	}
+
+	bool useLargePages()
+	{
+		if (s_largePagesFailed || !get_global_parameter_i("large pages", 0)) return false;
+		// once per process
+		static const bool privilege = enableLockMemoryPrivilege();
+		if (!privilege) s_largePagesFailed = true;
+		return privilege;
+	}
+
+	// rounds up to 1/8 steps between powers of two (at most 12.5% overhead, at least 4 KB).
+	// Sizes of the same class share pooled blocks
+	size_t getSizeClass(size_t size)
+	{
+		size_t step = 4096 / 8;
+		while (step * 16 <= size)
+			step *= 2;
+		return std::max(size_t(4096), (size + step - 1) / step * step);
+	}
+
+	void freeBlock(const Block& block)
+	{
+		if (block.largePages)
+			VirtualFree(block.data, 0, MEM_RELEASE);
+		else
+			_aligned_free(block.data);
+	}
+
+	Block allocateBlock(size_t capacity)
+	{
+		// optional large pages for big buffers (fewer TLB misses when converting the whole image)
+		const size_t largePage = GetLargePageMinimum();
+		if (largePage && capacity >= largePage && useLargePages())
+		{
+			const size_t largeCapacity = (capacity + largePage - 1) / largePage * largePage;
+			auto data = VirtualAlloc(nullptr, largeCapacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (data)
+				return { reinterpret_cast<uint8_t*>(data), capacity, true };
+			s_largePagesFailed = true;
+		}
+
+		auto data = _aligned_malloc(capacity, image::PixelBuffer::alignment);
+		if (!data)
+			throw std::bad_alloc();
+		return { reinterpret_cast<uint8_t*>(data), capacity, false };
+	}
+}
+
+image::PixelBuffer::PixelBuffer(size_t size) :
+	m_size(size)
+{
+	if (size == 0) return;
+	m_capacity = getSizeClass(size);
+	const size_t limit = size_t(std::max(get_global_parameter_i("pixel pool", 256), 0)) << 20;
+
+	{
+		auto& pool = getPool();
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		pool.limit = limit;
+		// most recently released blocks first (their pages are more likely to be resident)
+		for (auto it = pool.blocks.rbegin(); it != pool.blocks.rend(); ++it)
+		{
+			if (it->capacity != m_capacity) continue;
+			m_data = it->data;
+			m_largePages = it->largePages;
+			pool.size -= it->capacity;
+			pool.blocks.erase(std::next(it).base());
+			return;
+		}
+	}
+
+	const auto block = allocateBlock(m_capacity);
+	m_data = block.data;
+	m_largePages = block.largePages;
+}
+
+image::PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept :
+	m_data(other.m_data), m_size(other.m_size), m_capacity(other.m_capacity), m_largePages(other.m_largePages)
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_capacity = 0;
+}
+
+image::PixelBuffer& image::PixelBuffer::operator=(PixelBuffer&& other) noexcept
+{
+	if (this == &other) return *this;
+	reset();
+	std::swap(m_data, other.m_data);
+	std::swap(m_size, other.m_size);
+	std::swap(m_capacity, other.m_capacity);
+	std::swap(m_largePages, other.m_largePages);
+	return *this;
+}
+
+void image::PixelBuffer::reset()
+{
+	if (!m_data) return;
+	const Block block = { m_data, m_capacity, m_largePages };
+	m_data = nullptr;
+	m_size = 0;
+	m_capacity = 0;
+
+	auto& pool = getPool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	if (block.capacity > pool.limit)
+	{
+		freeBlock(block);
+		return;
+	}
+	if (pool.blocks.size() == Pool::maxBlocks)
+	{
+		pool.size -= pool.blocks.front().capacity;
+		freeBlock(pool.blocks.front());
+		pool.blocks.erase(pool.blocks.begin());
+	}
+
+	pool.blocks.push_back(block);
+	pool.size += block.capacity;
+	// drop the oldest blocks
+	size_t count = 0;
+	while (pool.size > pool.limit)
+	{
+		pool.size -= pool.blocks[count].capacity;
+		freeBlock(pool.blocks[count++]);
+	}
+	pool.blocks.erase(pool.blocks.begin(), pool.blocks.begin() + count);
+}
+
+size_t image::trimPixelPool()
+{
+	auto& pool = getPool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	for (const auto& b : pool.blocks)
+		freeBlock(b);
+	pool.blocks.clear();
+	const size_t size = pool.size;
+	pool.size = 0;
+	return size;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace image
+{
+	// storage for pixel data. The memory is uninitialized and aligned to 64 bytes (cache line and AVX-512).
+	// Released blocks are kept in a pool and reused by allocations of the same size class, so repeated
+	// load/export cycles of large images do not request (and zero) fresh pages from the system every time
+	class PixelBuffer
+	{
+	public:
+		static constexpr size_t alignment = 64;
+
+		PixelBuffer() = default;
+		// allocates size uninitialized bytes
+		explicit PixelBuffer(size_t size);
+		~PixelBuffer() { reset(); }
+		PixelBuffer(const PixelBuffer&) = delete;
+		PixelBuffer& operator=(const PixelBuffer&) = delete;
+		PixelBuffer(PixelBuffer&& other) noexcept;
+		PixelBuffer& operator=(PixelBuffer&& other) noexcept;
+
+		uint8_t* data() { return m_data; }
+		const uint8_t* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		// returns the memory to the pool
+		void reset();
+
+	private:
+		uint8_t* m_data = nullptr;
+		size_t m_size = 0; // requested size
+		size_t m_capacity = 0; // size of the size class
+		bool m_largePages = false;
+	};
+
+	// frees all blocks of the pool and returns the number of released bytes
+	size_t trimPixelPool();
+}
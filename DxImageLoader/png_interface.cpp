@@ -6,8 +6,11 @@
 #include <string>
 #include "convert.h"
 #include <algorithm>
-#include "interface.h"
-#include "stbi_interface.h"
+#include <cstring>
+#include "operation_context.h"
+#include "source.h"
+#include "trace.h"
+#include "thread_pool.h"
 
 struct ImportFormatInfo
 {
@@ -232,26 +235,93 @@ std::vector<uint32_t> png_get_export_formats()
 	};
 }
 
-static uint32_t s_num_rows = 0;
+// progress info of one read or write operation (stored as error pointer of the png struct)
+struct PngProgress
+{
+	OperationContext* ctx;
+	uint32_t numRows;
+};
+
+// determines if the image is kept in srgb space or converted to linear space
+static void setup_gamma(png_structp pPng, png_infop pInfo, ImportFormatInfo& info)
+{
+	int srgbIntent;
+	double gamma;
+	if(png_get_sRGB(pPng, pInfo, &srgbIntent))
+	{
+		// srgb available
+		if (info.bitDepth <= 8)
+			info.isSrgb = true; // use srgb as is
+		else // convert to linear
+			png_set_gamma(pPng, 1.0, PNG_DEFAULT_sRGB);
+	}
+	else if(png_get_gAMA(pPng, pInfo, &gamma))
+	{
+		// gamma available
+		if (std::abs(gamma - 1.0) < 0.01) {} // keep it linear
+		else if (std::abs(gamma - 0.45455) < 0.1 && info.bitDepth <= 8) // keep srgb as is
+			info.isSrgb = true;
+		else
+		{
+			// do color conversion
+			if(info.bitDepth > 8 || gamma > 0.727275)
+			{
+				// convert to linear
+				png_set_gamma(pPng, 1.0, gamma);
+			}
+			else // convert to srgb (closer)
+			{
+				info.isSrgb = true;
+				png_set_gamma(pPng, 0.45455, gamma);
+			}
+		}
+	}
+	else if(info.bitDepth < 16)
+	{
+		// assume srgb
+		info.isSrgb = true;
+	}
+}
+
 void png_progress(png_structp pPng, png_uint_32 row, int pass)
 {
-	set_progress(row * 100 / s_num_rows);
+	auto progress = reinterpret_cast<PngProgress*>(png_get_error_ptr(pPng));
+	progress->ctx->setWork(row, progress->numRows);
+	// libpng errors are reported by exceptions as well (see png_error)
+	progress->ctx->throwIfCancelled();
 }
 
-std::unique_ptr<image::IImage> png_load(const char* filename)
+// read position in the file contents (stored as io pointer of the png struct)
+struct PngInput
 {
-	FILE* fp = fopen(filename, "rb");
-	if (!fp)
-		throw std::runtime_error("could not open file");
+	const uint8_t* data;
+	size_t size;
+	size_t pos;
+};
+
+static void png_read_source(png_structp pPng, png_bytep data, png_size_t length)
+{
+	auto input = reinterpret_cast<PngInput*>(png_get_io_ptr(pPng));
+	if (input->size - input->pos < length)
+		throw std::runtime_error("unexpected end of file");
+	memcpy(data, input->data + input->pos, length);
+	input->pos += length;
+}
 
+// decodes the whole image (region = nullptr) or only the rows up to the end of the region.
+// region is updated to the position of the requested pixels in the returned image
+static std::unique_ptr<image::IImage> png_read(const Source& src, image::Region* region, OperationContext& ctx)
+{
 	png_structp pPng = nullptr;
 	png_infop pInfo = nullptr;
 	std::unique_ptr<image::IImage> res;
+	PngProgress progressInfo = { &ctx, 0 };
+	PngInput input = { src.data(), src.size(), 0 };
 
 	try
 	{
 		pPng = png_create_read_struct(PNG_LIBPNG_VER_STRING,
-			nullptr, png_error, nullptr);
+			&progressInfo, png_error, nullptr);
 		if (!pPng)
 			throw std::runtime_error("could not create read struct");
 
@@ -259,7 +329,7 @@ std::unique_ptr<image::IImage> png_load(const char* filename)
 		if (!pInfo)
 			throw std::runtime_error("could not create info struct");
 
-		png_init_io(pPng, fp);
+		png_set_read_fn(pPng, &input, png_read_source);
 
 		png_set_read_status_fn(pPng, png_progress);
 
@@ -269,6 +339,13 @@ std::unique_ptr<image::IImage> png_load(const char* filename)
 		int interlace, compression, filterMethod;
 		png_get_IHDR(pPng, pInfo, &info.width, &info.height, &info.bitDepth, &info.colorType, &interlace, &compression, &filterMethod);
 
+		if (region)
+			image::checkRegion(*region, 1, 1, info.width, info.height);
+		// interlaced images store the rows in multiple passes => decode everything and let the caller crop
+		const bool partial = region && interlace == PNG_INTERLACE_NONE;
+		const uint32_t width = partial ? region->width : info.width;
+		const uint32_t height = partial ? region->height : info.height;
+
 		// set bit depth to at least 8 bit
 		png_set_packing(pPng);
 
@@ -283,112 +360,159 @@ std::unique_ptr<image::IImage> png_load(const char* filename)
 		if (png_get_valid(pPng, pInfo, PNG_INFO_tRNS) != 0)
 			png_set_tRNS_to_alpha(pPng);
 		
-		// gamma handling
-		int srgbIntent;
-		double gamma;
-		if(png_get_sRGB(pPng, pInfo, &srgbIntent))
-		{
-			// srgb available
-			if (info.bitDepth <= 8)
-				info.isSrgb = true; // use srgb as is
-			else // convert to linear
-				png_set_gamma(pPng, 1.0, PNG_DEFAULT_sRGB);
-		}
-		else if(png_get_gAMA(pPng, pInfo, &gamma))
-		{
-			// gamma available
-			if (std::abs(gamma - 1.0) < 0.01) {} // keep it linear
-			else if (std::abs(gamma - 0.45455) < 0.1 && info.bitDepth <= 8) // keep srgb as is
-				info.isSrgb = true;
-			else
-			{
-				// do color conversion
-				if(info.bitDepth > 8 || gamma > 0.727275)
-				{
-					// convert to linear
-					png_set_gamma(pPng, 1.0, gamma);
-				}
-				else // convert to srgb (closer)
-				{
-					info.isSrgb = true;
-					png_set_gamma(pPng, 0.45455, gamma);
-				}
-			}
-		}
-		else if(info.bitDepth < 16)
-		{
-			// assume srgb
-			info.isSrgb = true;
-		}
+		setup_gamma(pPng, pInfo, info);
 
 		if(info.bitDepth == 16 && image::littleendian())
 			png_set_swap(pPng);
 
-		// convert gray to rgb
-		if (info.colorType == PNG_COLOR_TYPE_GRAY || info.colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
-			png_set_gray_to_rgb(pPng);
+		// 16 bit and grayscale images keep the decoded channels and are expanded to RGBA when staged
+		const bool compact = info.bitDepth == 16 ||
+			info.colorType == PNG_COLOR_TYPE_GRAY || info.colorType == PNG_COLOR_TYPE_GRAY_ALPHA;
 
 		// fill with alpha
-		if((info.colorType & PNG_COLOR_MASK_ALPHA) == 0)
+		if(!compact && (info.colorType & PNG_COLOR_MASK_ALPHA) == 0)
 			png_set_filler(pPng, 0xFFFF, PNG_FILLER_AFTER);
 
 		png_read_update_info(pPng, pInfo);
 		complete_import_info(info);
 
 		// allocate storage
-		res.reset(new image::SimpleImage(
-			info.original, info.staging,
-			info.width, info.height,
-			info.bitDepth <= 8 ? 4 : 4 * 4
-		));
-
-		std::vector<png_bytep> rows;
-		rows.resize(info.height);
-		s_num_rows = info.height;
 		size_t dataSize;
-		auto data = res->getData(0, 0, dataSize);
-		auto rowStride = info.width * (info.bitDepth <= 8 ? 4 : 2 * 4);
-		for(auto& r:  rows)
+		uint8_t* data;
+		size_t pixelStride;
+		if(compact)
 		{
-			r = data;
-			data += rowStride;
-		}
-
-		png_read_image(pPng, rows.data());
-		png_read_end(pPng, pInfo);
+			image::ChannelLayout layout;
+			switch(png_get_channels(pPng, pInfo))
+			{
+			case 1: layout = image::ChannelLayout::Gray; break;
+			case 2: layout = image::ChannelLayout::GrayAlpha; break;
+			case 3: layout = image::ChannelLayout::RGB; break;
+			case 4: layout = image::ChannelLayout::RGBA; break;
+			default: throw std::runtime_error("unexpected channel count");
+			}
 
-		// fix image stride
-		if(info.bitDepth == 16)
+			auto img = std::make_unique<image::CompactImage>(
+				info.original, info.staging,
+				info.bitDepth == 16 ? image::ChannelType::Unorm16 : image::ChannelType::Unorm8, layout,
+				width, height);
+			data = img->getCompactData(dataSize);
+			pixelStride = img->getCompactPixelSize();
+			res = std::move(img);
+		}
+		else
+		{
+			res.reset(new image::SimpleImage(
+				info.original, info.staging,
+				width, height, 4
+			));
+			data = res->getData(0, 0, dataSize);
+			pixelStride = 4;
+		}
+		if(partial)
+		{
+			// rows are decoded in order. Rows above the region are discarded, rows below are not decoded
+			std::vector<png_byte> row(size_t(info.width) * pixelStride);
+			const uint32_t endRow = region->y + region->height;
+			progressInfo.numRows = endRow;
+			for(uint32_t y = 0; y < endRow; ++y)
+			{
+				png_read_row(pPng, row.data(), nullptr);
+				if (y < region->y) continue;
+				memcpy(data, row.data() + region->x * pixelStride, region->width * pixelStride);
+				data += region->width * pixelStride;
+			}
+			*region = { 0, 0, 0, 0, region->width, region->height };
+		}
+		else
 		{
-			// do conversion to 32 bit (from back to front to do this inplace)
-			auto buffer = res->getData(0, 0, dataSize);
-			const uint16_t* src = reinterpret_cast<uint16_t*>(buffer) + info.width * info.height * 4 - 1;
-			const uint16_t* end = reinterpret_cast<uint16_t*>(buffer) - 1;
-			float* dst = reinterpret_cast<float*>(buffer) + info.width * info.height * 4 - 1;
-			float invMax = 1.0f / float(std::numeric_limits<uint16_t>::max());
-
-			for (; src != end; --src, --dst)
+			std::vector<png_bytep> rows;
+			rows.resize(info.height);
+			progressInfo.numRows = info.height;
+			auto rowStride = info.width * pixelStride;
+			for(auto& r:  rows)
 			{
-				*dst = float(*src) * invMax;
+				r = data;
+				data += rowStride;
 			}
+
+			png_read_image(pPng, rows.data());
+			png_read_end(pPng, pInfo);
 		}
 	}
 	catch (...)
 	{
-		fclose(fp);
 		if(pPng)
 		{
 			if (pInfo)
 				png_destroy_read_struct(&pPng, &pInfo, nullptr);
 			else
 				png_destroy_read_struct(&pPng, nullptr, nullptr);
+		}
+		throw;
+	}
 
-			// try to open it with stb. sometimes files are saved with .png but are actually jpeg etc.
-			try
-			{
-				return stb_image_load(filename);
-			}
-			catch(...) {}
+	png_destroy_read_struct(&pPng, &pInfo, nullptr);
+
+	return res;
+}
+
+std::unique_ptr<image::IImage> png_load(const Source& src, OperationContext& ctx)
+{
+	trace::Scope scope("png_load");
+	return png_read(src, nullptr, ctx);
+}
+
+std::unique_ptr<image::IImage> png_load_region(const Source& src, image::Region& region, OperationContext& ctx)
+{
+	trace::Scope scope("png_load_region");
+	return png_read(src, &region, ctx);
+}
+
+image::Info png_probe(const char* filename)
+{
+	FILE* fp = fopen(filename, "rb");
+	if (!fp)
+		throw std::runtime_error("could not open file");
+
+	png_structp pPng = nullptr;
+	png_infop pInfo = nullptr;
+	image::Info res;
+
+	try
+	{
+		pPng = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, png_error, nullptr);
+		if (!pPng)
+			throw std::runtime_error("could not create read struct");
+
+		pInfo = png_create_info_struct(pPng);
+		if (!pInfo)
+			throw std::runtime_error("could not create info struct");
+
+		png_init_io(pPng, fp);
+
+		// only reads the chunks up to the image data
+		png_read_info(pPng, pInfo);
+
+		ImportFormatInfo info;
+		int interlace, compression, filterMethod;
+		png_get_IHDR(pPng, pInfo, &info.width, &info.height, &info.bitDepth, &info.colorType, &interlace, &compression, &filterMethod);
+		setup_gamma(pPng, pInfo, info);
+		complete_import_info(info);
+
+		res.originalFormat = info.original;
+		res.width = info.width;
+		res.height = info.height;
+	}
+	catch (...)
+	{
+		fclose(fp);
+		if (pPng)
+		{
+			if (pInfo)
+				png_destroy_read_struct(&pPng, &pInfo, nullptr);
+			else
+				png_destroy_read_struct(&pPng, nullptr, nullptr);
 		}
 		throw;
 	}
@@ -399,7 +523,35 @@ std::unique_ptr<image::IImage> png_load(const char* filename)
 	return res;
 }
 
-void png_write(image::IImage& image, const char* filename, gli::format format, int quality)
+// number of pixels that are converted at once during export
+static const size_t s_exportBlockPixels = 1 << 16;
+// number of pixels of a block that are converted by one thread
+static const size_t s_exportJobPixels = 1 << 13;
+
+// converts numPixels RGBA pixels of the image to the channels and bit depth of the png file.
+// 16 bit values are clamped, rounded and stored in the big endian byte order of png in a single pass
+static void convert_export_rows(const uint8_t* src, uint8_t* dst, size_t numPixels, gli::format srcFormat, const ExportFormatInfo& info)
+{
+	if (info.bitDepth != 16)
+	{
+		assert(image::pixelSize(srcFormat) == 4);
+		image::copyStrideEx(src, dst, numPixels, 4, info.bitmask);
+		return;
+	}
+
+	if (srcFormat == gli::format::FORMAT_RGBA16_SFLOAT_PACK16)
+	{
+		std::vector<float> floats(numPixels * 4);
+		image::halfToFloat(reinterpret_cast<const uint16_t*>(src), floats.data(), floats.size());
+		image::floatToUnorm16(floats.data(), dst, numPixels, info.bitmask, true);
+		return;
+	}
+
+	assert(srcFormat == gli::format::FORMAT_RGBA32_SFLOAT_PACK32);
+	image::floatToUnorm16(reinterpret_cast<const float*>(src), dst, numPixels, info.bitmask, true);
+}
+
+void png_write(const image::IImage& image, const char* filename, gli::format format, int quality, OperationContext& ctx)
 {
 	// bit depth info etc.
 	const auto info = get_export_info(format);
@@ -412,11 +564,12 @@ void png_write(image::IImage& image, const char* filename, gli::format format, i
 	png_structp pPng = nullptr;
 	png_infop pInfo = nullptr;
 	if (!fp) throw std::runtime_error("cannot open file");
+	PngProgress progressInfo = { &ctx, image.getHeight(0) };
 
 	try
 	{
 		pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING,
-			nullptr, png_error, nullptr);
+			&progressInfo, png_error, nullptr);
 		if (!pPng)
 			throw std::runtime_error("could not create png write struct");
 
@@ -424,7 +577,6 @@ void png_write(image::IImage& image, const char* filename, gli::format format, i
 		if (!pInfo)
 			throw std::runtime_error("could not create info struct");
 
-		s_num_rows = image.getHeight(0);
 		png_set_write_status_fn(pPng, png_progress);
 
 		png_init_io(pPng, fp);
@@ -446,52 +598,33 @@ void png_write(image::IImage& image, const char* filename, gli::format format, i
 		
 		png_write_info(pPng, pInfo);
 
-		if(info.bitDepth == 16 && image::littleendian())
-			png_set_swap(pPng);
-
+		// rows are converted in blocks into a scratch buffer and streamed to libpng, the image stays unchanged
 		size_t dataSize;
-		auto data = image.getData(0, 0, dataSize);
-
-		if(info.bitDepth == 16)
+		const uint8_t* data = image.getData(0, 0, dataSize);
+		const uint32_t width = image.getWidth(0);
+		const uint32_t height = image.getHeight(0);
+		const size_t srcPixelSize = image::pixelSize(image.getFormat());
+		const size_t srcRowStride = size_t(width) * srcPixelSize;
+		const size_t rowStride = size_t(info.pixelSize) * width;
+		const uint32_t blockRows = std::max<uint32_t>(1, uint32_t(s_exportBlockPixels / width));
+
+		std::vector<uint8_t> block(rowStride * std::min(blockRows, height));
+		for (uint32_t y = 0; y < height; y += blockRows)
 		{
-			// transform to 16 bit unorm
-			assert(image.getFormat() == gli::format::FORMAT_RGBA32_SFLOAT_PACK32);
-
-			const float* src = reinterpret_cast<float*>(data);
-			const float* end = reinterpret_cast<float*>(data + dataSize);
-			uint16_t* dst = reinterpret_cast<uint16_t*>(data);
-
-			uint32_t progress = 0;
-			uint32_t divisor = std::max<uint32_t>(4 * image.getWidth(0) * image.getHeight(0) / 100, 1);
-			for (; src != end; ++src, ++dst)
+			const uint32_t numRows = std::min(blockRows, height - y);
+			// rows are tightly packed => the block is split at arbitrary pixels
+			const size_t numPixels = size_t(numRows) * width;
+			const uint8_t* src = data + y * srcRowStride;
+			ThreadPool::get().parallelFor((numPixels + s_exportJobPixels - 1) / s_exportJobPixels, [&](size_t job)
 			{
-				*dst = uint16_t(glm::round(glm::clamp(*src, 0.0f, 1.0f) * 65535.0f));
-				++progress;
-
-				if (progress % 256 == 0) set_progress(progress / divisor, "converting float to unorm");
-			}
-				
-			// change stride if required
-			if (info.bitmask != 0b11111111)
-				image::changeStrideEx(data, dataSize / 2, 4 * 2, info.bitmask);
-		}
-		else if(info.bitmask != 0b1111)
-		{
-			// change stride
-			image::changeStrideEx(data, dataSize, 4, info.bitmask);
-		}
-
-		// set row pointers
-		std::vector<png_bytep> rows;
-		rows.resize(image.getHeight(0));
-		const auto rowStride = info.pixelSize * image.getWidth(0);
-		for (auto& r : rows)
-		{
-			r = data;
-			data += rowStride;
+				const size_t first = job * s_exportJobPixels;
+				const size_t count = std::min(s_exportJobPixels, numPixels - first);
+				convert_export_rows(src + first * srcPixelSize, block.data() + first * info.pixelSize, count, image.getFormat(), info);
+			});
+			for (uint32_t row = 0; row < numRows; ++row)
+				png_write_row(pPng, block.data() + row * rowStride);
 		}
 
-		png_write_image(pPng, rows.data());
 		png_write_end(pPng, pInfo);
 	}
 	catch(...) // error handling
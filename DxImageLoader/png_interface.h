@@ -2,8 +2,17 @@
 #include <memory>
 #include "Image.h"
 
-std::unique_ptr<image::IImage> png_load(const char* filename);
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> png_load(const Source& src, OperationContext& ctx);
+// decodes the rows up to the end of the region and keeps only the region (interlaced images are decoded completely).
+// region is updated to the position of the requested pixels in the returned image
+std::unique_ptr<image::IImage> png_load_region(const Source& src, image::Region& region, OperationContext& ctx);
+
+// reads the png header without decoding the image data
+image::Info png_probe(const char* filename);
 
 std::vector<uint32_t> png_get_export_formats();
 
-void png_write(image::IImage& image, const char* filename, gli::format format, int quality);
\ No newline at end of file
+void png_write(const image::IImage& image, const char* filename, gli::format format, int quality, OperationContext& ctx);
\ No newline at end of file
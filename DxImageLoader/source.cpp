@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "source.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+// closes the windows handle when leaving the scope
+class HandleGuard
+{
+public:
+	explicit HandleGuard(HANDLE handle) : m_handle(handle) {}
+	~HandleGuard() { if (m_handle) CloseHandle(m_handle); }
+	HandleGuard(const HandleGuard&) = delete;
+	HandleGuard& operator=(const HandleGuard&) = delete;
+private:
+	HANDLE m_handle;
+};
+
+Source::Source(const char* filename)
+{
+	// same sharing mode as std::ifstream, other programs may still write the file
+	const HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("unable to open file");
+	HandleGuard fileGuard(file);
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+		throw std::runtime_error("could not read file");
+	if (size.QuadPart == 0)
+		return; // empty files can not be mapped
+
+	if (uint64_t(size.QuadPart) > uint64_t(SIZE_MAX))
+		throw std::runtime_error("file is too large");
+
+	// the view keeps the file and the mapping alive, both handles can be closed afterwards
+	const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+		throw std::runtime_error("could not read file");
+	HandleGuard mappingGuard(mapping);
+
+	m_view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_view)
+		throw std::runtime_error("could not read file");
+
+	m_data = reinterpret_cast<const uint8_t*>(m_view);
+	m_size = size_t(size.QuadPart);
+}
+
+Source::Source(const void* data, size_t size) :
+	m_data(reinterpret_cast<const uint8_t*>(data)),
+	m_size(size)
+{
+	if (!data && size)
+		throw std::runtime_error("invalid memory");
+}
+
+Source::Source(std::vector<uint8_t> bytes) :
+	m_bytes(std::move(bytes))
+{
+	m_data = m_bytes.data();
+	m_size = m_bytes.size();
+}
+
+Source::~Source()
+{
+	if (m_view)
+		UnmapViewOfFile(m_view);
+}
+
+static bool startsWith(const uint8_t* data, size_t size, const char* magic, size_t magicSize)
+{
+	return size >= magicSize && memcmp(data, magic, magicSize) == 0;
+}
+
+FileFormat detect_format(const uint8_t* data, size_t size)
+{
+	if (startsWith(data, size, "\x89PNG\r\n\x1A\n", 8))
+		return FileFormat::Png;
+	if (startsWith(data, size, "DDS ", 4))
+		return FileFormat::Dds;
+	// "«KTX 11»\r\n\x1A\n" or "«KTX 20»\r\n\x1A\n"
+	if (startsWith(data, size, "\xABKTX ", 5))
+		return FileFormat::Ktx;
+	if (startsWith(data, size, "\x76\x2F\x31\x01", 4))
+		return FileFormat::Exr;
+	if (startsWith(data, size, "#?", 2))
+		return FileFormat::Hdr;
+	if ((startsWith(data, size, "PF", 2) || startsWith(data, size, "Pf", 2)) && size > 2 && isspace(data[2]))
+		return FileFormat::Pfm;
+	if (startsWith(data, size, "\x93NUMPY", 6))
+		return FileFormat::Npy;
+	if (startsWith(data, size, "RIFF", 4) && size >= 12 && memcmp(data + 8, "WEBP", 4) == 0)
+		return FileFormat::Webp;
+
+	return FileFormat::Stb;
+}
+
+FileFormat detect_format(const uint8_t* data, size_t size, const char* extensionHint)
+{
+	const auto format = detect_format(data, size);
+	if (format != FileFormat::Stb || !extensionHint)
+		return format;
+
+	// formats with magic bytes that are decoded by stb
+	if (startsWith(data, size, "\xFF\xD8\xFF", 3) || // jpg
+		startsWith(data, size, "BM", 2) ||
+		startsWith(data, size, "GIF8", 4) ||
+		startsWith(data, size, "8BPS", 4)) // psd
+		return format;
+
+	// no magic bytes found => trust the hint
+	std::string ext = extensionHint;
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	if (!ext.empty() && ext[0] == '.') ext.erase(0, 1);
+
+	if (ext == "png") return FileFormat::Png;
+	if (ext == "dds") return FileFormat::Dds;
+	if (ext == "ktx" || ext == "ktx2") return FileFormat::Ktx;
+	if (ext == "exr") return FileFormat::Exr;
+	if (ext == "hdr") return FileFormat::Hdr;
+	if (ext == "pfm") return FileFormat::Pfm;
+	if (ext == "npy") return FileFormat::Npy;
+	if (ext == "webp") return FileFormat::Webp;
+	return FileFormat::Stb;
+}
+
+std::vector<uint8_t> read_file_header(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("unable to open file");
+
+	std::vector<uint8_t> header(16);
+	file.read(reinterpret_cast<char*>(header.data()), header.size());
+	header.resize(size_t(file.gcount()));
+	return header;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <streambuf>
+
+// encoded image data that is shared by the format detection and the decoder
+class Source
+{
+public:
+	// maps the whole file read-only into memory. Decoders read directly from the mapped pages,
+	// so the file contents are not copied into private memory. Throws if the file can not be opened
+	explicit Source(const char* filename);
+	// uses the memory of the caller without copying it. The memory must stay valid while the Source is used
+	Source(const void* data, size_t size);
+	// takes ownership of the bytes (for images that keep the Source after the memory of the caller is gone)
+	explicit Source(std::vector<uint8_t> bytes);
+	~Source();
+	Source(const Source&) = delete;
+	Source& operator=(const Source&) = delete;
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	// true if the data is memory of the caller that is only valid during the call
+	bool isBorrowed() const { return !m_view && m_bytes.empty() && m_size; }
+	// true if the data is a private copy (not mapped from a file)
+	bool ownsBytes() const { return !m_bytes.empty(); }
+
+private:
+	void* m_view = nullptr; // mapped view of the file (nullptr for caller memory and empty files)
+	std::vector<uint8_t> m_bytes; // owned data (empty for mapped files and caller memory)
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+// read only std::streambuf over memory (for decoders that read from a std::istream)
+class MemoryStreamBuffer final : public std::streambuf
+{
+public:
+	MemoryStreamBuffer(const uint8_t* data, size_t size)
+	{
+		auto begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+		setg(begin, begin, begin + size);
+	}
+
+protected:
+	// required for tellg/seekg
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+	{
+		char* pos = dir == std::ios_base::beg ? eback() : (dir == std::ios_base::cur ? gptr() : egptr());
+		if (!(which & std::ios_base::in) || off < eback() - pos || off > egptr() - pos)
+			return pos_type(off_type(-1));
+		setg(eback(), pos + off, egptr());
+		return pos_type(gptr() - eback());
+	}
+
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+	{
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+};
+
+enum class FileFormat
+{
+	Png,
+	Dds,
+	Ktx, // ktx1 and ktx2
+	Exr,
+	Hdr, // radiance rgbe
+	Pfm,
+	Npy,
+	Webp,
+	Stb // everything else (jpg, bmp, tga, gif, ...) is handled by stb_image
+};
+
+// detects the format from the magic bytes at the start of the file
+FileFormat detect_format(const uint8_t* data, size_t size);
+
+// same as above, but uses the extension hint (e.g. "pfm", without dot) if the data has no known magic bytes.
+// hint may be nullptr
+FileFormat detect_format(const uint8_t* data, size_t size, const char* extensionHint);
+
+// reads the first bytes of the file (enough for detect_format). Throws if the file can not be opened
+std::vector<uint8_t> read_file_header(const char* filename);
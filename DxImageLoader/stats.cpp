@@ -0,0 +1,51 @@
+#include "pch.h"
+#include "stats.h"
+
+const char* get_stage_name(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::Read: return "read";
+	case Stage::Decode: return "decode";
+	case Stage::Postprocess: return "postprocess";
+	case Stage::Convert: return "convert";
+	case Stage::Compress: return "compress";
+	case Stage::Encode: return "encode";
+	case Stage::Count: break;
+	}
+	return "";
+}
+
+void StageStats::add(const StageStats& other)
+{
+	time += other.time;
+	bytesRead += other.bytesRead;
+	bytesWritten += other.bytesWritten;
+	pixels += other.pixels;
+	count += other.count;
+}
+
+void Stats::add(const Stats& other)
+{
+	for (size_t i = 0; i < m_stages.size(); ++i)
+		m_stages[i].add(other.m_stages[i]);
+}
+
+std::string Stats::toJson() const
+{
+	std::string res = "{";
+	for (size_t i = 0; i < m_stages.size(); ++i)
+	{
+		const auto& s = m_stages[i];
+		if (i) res += ",";
+		res += "\"" + std::string(get_stage_name(Stage(i))) + "\":{";
+		res += "\"time_us\":" + std::to_string(s.time / 1000);
+		res += ",\"bytes_read\":" + std::to_string(s.bytesRead);
+		res += ",\"bytes_written\":" + std::to_string(s.bytesWritten);
+		res += ",\"pixels\":" + std::to_string(s.pixels);
+		res += ",\"count\":" + std::to_string(s.count);
+		res += "}";
+	}
+	res += "}";
+	return res;
+}
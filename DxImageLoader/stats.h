@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// stages of an import or export that are measured separately (see image_get_stats).
+// Stages can be nested, e.g. encode contains the convert or compress stage of the export
+enum class Stage
+{
+	Read, // opening and mapping the file
+	Decode, // format decoder (includes page-ins of the mapped file)
+	Postprocess, // grayscale and BGR pass (if it was not fused into the conversion)
+	Convert, // format conversion (gli convert and half staging)
+	Compress, // compressonator
+	Encode, // exporter including writing the file
+	Count
+};
+
+// name of the stage in the json output
+const char* get_stage_name(Stage stage);
+
+struct StageStats
+{
+	uint64_t time = 0; // wall time in nanoseconds
+	uint64_t bytesRead = 0;
+	uint64_t bytesWritten = 0;
+	uint64_t pixels = 0;
+	uint32_t count = 0; // number of times the stage was run
+
+	void add(const StageStats& other);
+};
+
+// counters of all stages
+class Stats
+{
+public:
+	StageStats& operator[](Stage stage) { return m_stages[size_t(stage)]; }
+	const StageStats& operator[](Stage stage) const { return m_stages[size_t(stage)]; }
+
+	void add(const Stats& other);
+	void clear() { m_stages = {}; }
+
+	// {"read":{"time_us":..,"bytes_read":..,"bytes_written":..,"pixels":..,"count":..},"decode":{..},..}
+	std::string toJson() const;
+
+private:
+	std::array<StageStats, size_t(Stage::Count)> m_stages;
+};
+
+// measures the wall time until the timer is destroyed and adds it to the stage
+class StageTimer
+{
+public:
+	StageTimer(Stats& stats, Stage stage) : m_stats(stats[stage]), m_start(std::chrono::steady_clock::now()) {}
+	~StageTimer()
+	{
+		m_stats.time += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+		++m_stats.count;
+	}
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+	// adds the amount of processed data to the stage
+	void add(uint64_t pixels, uint64_t bytesRead, uint64_t bytesWritten)
+	{
+		m_stats.pixels += pixels;
+		m_stats.bytesRead += bytesRead;
+		m_stats.bytesWritten += bytesWritten;
+	}
+
+private:
+	StageStats& m_stats;
+	std::chrono::steady_clock::time_point m_start;
+};
@@ -5,10 +5,23 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 // friendly error messages
 #define STBI_FAILURE_USERMSG
+
+// stb_image keeps the failure reason in a global, which concurrent loads (image_open_batch) would overwrite.
+// The global is redirected into a thread local slot, so the dependency stays unmodified.
+// "static const char *stbi__g_failure_reason;" in stb_image.h becomes a redeclaration of this function
+static const char** stbi_failure_reason_slot()
+{
+	static thread_local const char* reason = nullptr;
+	return &reason;
+}
+#define stbi__g_failure_reason (*stbi_failure_reason_slot())
 #include "../dependencies/stb_image.h"
+#undef stbi__g_failure_reason
 #include "../dependencies/stb_image_write.h"
 #include <fstream>
-#include "interface.h"
+#include "operation_context.h"
+#include "source.h"
+#include "trace.h"
 
 gli::format getFloatFormat(int numComponents)
 {
@@ -34,25 +47,41 @@ gli::format getSrgbFormat(int numComponents)
 	return gli::FORMAT_UNDEFINED;
 }
 
-// custom function
+// context of the load that is running on this thread (stb does not pass user data to the progress callback)
+static thread_local OperationContext* s_stbContext = nullptr;
+
+// custom function. Only updates the counters, stb cannot be aborted => the cancel flag is tested after loading
 void stbi_progress_callback(int height, int y)
 {
-	set_progress(y * 100 / height);
+	if (s_stbContext) s_stbContext->setWork(y + 1, height);
 }
 
 class StbImage final : public image::IImage
 {
 public:
-	StbImage(const char* filename)
+	StbImage(const Source& src, OperationContext& ctx)
 	{
+		// reset the context pointer even if loading throws
+		struct ContextScope
+		{
+			ContextScope(OperationContext& ctx) { s_stbContext = &ctx; }
+			~ContextScope() { s_stbContext = nullptr; }
+		} scope(ctx);
+
 		//stbi_set_flip_vertically_on_load(true);
-		if (stbi_is_hdr(filename))
+		const int srcSize = int(src.size());
+		if (stbi_is_hdr_from_memory(src.data(), srcSize))
 		{
 			// load hdr file
 			int nComponents = 0;
-			auto tmp = reinterpret_cast<stbi_uc*>(stbi_loadf(filename, &m_width, &m_height, &nComponents, 3));
+			auto tmp = reinterpret_cast<stbi_uc*>(stbi_loadf_from_memory(src.data(), srcSize, &m_width, &m_height, &nComponents, 3));
 			if (!tmp)
 				throwStbError();
+			if (ctx.isCancelled())
+			{
+				stbi_image_free(tmp);
+				ctx.throwIfCancelled();
+			}
 
 			// copy data with additional alpha channel
 			const size_t size = size_t(m_width) * size_t(m_height) * 4 * 4;
@@ -76,9 +105,14 @@ public:
 		{
 			// load ldr file
 			int nComponents = 0;
-			m_data = stbi_load(filename, &m_width, &m_height, &nComponents, 4);
+			m_data = stbi_load_from_memory(src.data(), srcSize, &m_width, &m_height, &nComponents, 4);
 			if (!m_data)
 				throwStbError();
+			if (ctx.isCancelled())
+			{
+				stbi_image_free(m_data);
+				ctx.throwIfCancelled();
+			}
 
 			m_original = getSrgbFormat(nComponents);
 			m_format = gli::format::FORMAT_RGBA8_SRGB_PACK8;
@@ -130,12 +164,30 @@ private:
 	gli::format m_format;
 };
 
-std::unique_ptr<image::IImage> stb_image_load(const char* filename)
+std::unique_ptr<image::IImage> stb_image_load(const Source& src, OperationContext& ctx)
 {
-	return std::make_unique<StbImage>(filename);
+	trace::Scope scope("stb_image_load");
+	return std::make_unique<StbImage>(src, ctx);
 	
 }
 
+image::Info stb_image_probe(const char* filename)
+{
+	int width = 0, height = 0, nComponents = 0;
+	if (!stbi_info(filename, &width, &height, &nComponents))
+	{
+		std::string err = "stbi error: ";
+		err += stbi_failure_reason() ? stbi_failure_reason() : "unknown file format";
+		throw std::runtime_error(err);
+	}
+
+	image::Info info;
+	info.width = width;
+	info.height = height;
+	info.originalFormat = stbi_is_hdr(filename) ? gli::format::FORMAT_RGB8E8_UFLOAT_PACK32 : getSrgbFormat(nComponents);
+	return info;
+}
+
 std::vector<uint32_t> stb_image_get_export_formats(const char* extension)
 {
 	const auto ext = std::string(extension);
@@ -2,7 +2,13 @@
 #include <memory>
 #include "Image.h"
 
-std::unique_ptr<image::IImage> stb_image_load(const char* filename);
+class OperationContext;
+class Source;
+
+std::unique_ptr<image::IImage> stb_image_load(const Source& src, OperationContext& ctx);
+
+// reads width, height and number of components without decoding the image
+image::Info stb_image_probe(const char* filename);
 
 std::vector<uint32_t> stb_image_get_export_formats(const char* extension);
 
@@ -0,0 +1,152 @@
+#pragma once
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+// fixed size worker pool. Tasks are executed in submission order
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t numThreads)
+	{
+		numThreads = std::max<size_t>(numThreads, 1);
+		m_workers.reserve(numThreads);
+		for (size_t i = 0; i < numThreads; ++i)
+			m_workers.emplace_back([this] { workerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> g(m_mutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		for (auto& w : m_workers)
+			w.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// enqueues a task. The returned future rethrows exceptions from the task
+	std::future<void> submit(std::function<void()> task)
+	{
+		auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+		auto future = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> g(m_mutex);
+			m_tasks.emplace([packaged] { (*packaged)(); });
+		}
+		m_cv.notify_one();
+		return future;
+	}
+
+	size_t size() const { return m_workers.size(); }
+
+	// calls func(i) for all i in [0, count) on the workers and the calling thread and rethrows the first exception.
+	// Only waits for calls that already started => can be used from a task of the same pool (e.g. a batch load).
+	// After an exception the remaining indices are skipped
+	void parallelFor(size_t count, const std::function<void(size_t)>& func)
+	{
+		if (count == 0) return;
+		if (count == 1) return func(0);
+
+		struct State
+		{
+			std::function<void(size_t)> func;
+			size_t count;
+			std::atomic<size_t> next = 0;
+			std::mutex mutex;
+			std::condition_variable cv;
+			size_t active = 0; // helpers inside run
+			std::exception_ptr error;
+
+			void run()
+			{
+				for (size_t i = next++; i < count; i = next++)
+				{
+					try
+					{
+						func(i);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> g(mutex);
+						if (!error) error = std::current_exception();
+						next = count;
+					}
+				}
+			}
+		};
+		auto state = std::make_shared<State>();
+		state->func = func;
+		state->count = count;
+
+		const size_t numHelpers = std::min(size(), count - 1);
+		{
+			std::lock_guard<std::mutex> g(m_mutex);
+			for (size_t i = 0; i < numHelpers; ++i)
+			{
+				m_tasks.emplace([state]
+				{
+					{
+						std::lock_guard<std::mutex> g(state->mutex);
+						if (state->next >= state->count) return; // all work was taken before this task started
+						++state->active;
+					}
+					state->run();
+					{
+						std::lock_guard<std::mutex> g(state->mutex);
+						--state->active;
+					}
+					state->cv.notify_all();
+				});
+			}
+		}
+		m_cv.notify_all();
+
+		state->run();
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->cv.wait(lock, [&] { return state->active == 0; });
+		if (state->error) std::rethrow_exception(state->error);
+	}
+
+	// pool that is shared by the whole dll (one worker per hardware thread)
+	static ThreadPool& get()
+	{
+		static ThreadPool s_pool(std::thread::hardware_concurrency());
+		return s_pool;
+	}
+
+private:
+	void workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+				if (m_stop && m_tasks.empty()) return;
+				task = std::move(m_tasks.front());
+				m_tasks.pop();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stop = false;
+};
@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "trace.h"
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+
+namespace
+{
+	struct Event
+	{
+		const char* name;
+		int layer;
+		int mipmap;
+		uint32_t thread;
+		std::chrono::steady_clock::time_point start;
+		std::chrono::steady_clock::time_point end;
+	};
+
+	// events are dropped after this count (if tracing was started and never ended)
+	constexpr size_t s_maxEvents = 1 << 22;
+
+	std::mutex s_mutex;
+	std::vector<Event> s_events;
+	std::chrono::steady_clock::time_point s_origin;
+	// output file of DXIMAGELOADER_TRACE (set by readEnvironment)
+	std::string s_environmentFile;
+	std::once_flag s_environmentOnce;
+
+	void startRecording()
+	{
+		std::lock_guard<std::mutex> g(s_mutex);
+		s_events.clear();
+		s_origin = std::chrono::steady_clock::now();
+		trace::s_enabled = true;
+	}
+
+	// microseconds since begin with nanosecond precision
+	std::string toMicroseconds(std::chrono::steady_clock::duration d)
+	{
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%lld.%03lld", static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+		return buffer;
+	}
+}
+
+std::atomic<bool> trace::s_enabled = false;
+std::atomic<bool> trace::s_environmentRead = false;
+
+void trace::readEnvironment()
+{
+	std::call_once(s_environmentOnce, []
+	{
+		char buffer[MAX_PATH];
+		const auto length = GetEnvironmentVariableA("DXIMAGELOADER_TRACE", buffer, MAX_PATH);
+		if (length != 0 && length < MAX_PATH)
+		{
+			s_environmentFile = buffer;
+			startRecording();
+		}
+		s_environmentRead = true;
+	});
+}
+
+void trace::begin()
+{
+	// the environment must not restart the recording later
+	readEnvironment();
+	startRecording();
+}
+
+void trace::end(const char* filename)
+{
+	readEnvironment();
+	std::vector<Event> events;
+	std::chrono::steady_clock::time_point origin;
+	{
+		std::lock_guard<std::mutex> g(s_mutex);
+		s_enabled = false;
+		events.swap(s_events);
+		origin = s_origin;
+	}
+
+	std::ofstream out(filename);
+	if (!out)
+		throw std::runtime_error(std::string("could not open ") + filename);
+
+	const auto pid = std::to_string(GetCurrentProcessId());
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		const auto& e = events[i];
+		if (i) out << ",\n";
+		out << "{\"name\":\"" << e.name << "\",\"cat\":\"image\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << e.thread
+			<< ",\"ts\":" << toMicroseconds(e.start - origin) << ",\"dur\":" << toMicroseconds(e.end - e.start);
+		if (e.layer >= 0 || e.mipmap >= 0)
+		{
+			out << ",\"args\":{";
+			if (e.layer >= 0) out << "\"layer\":" << e.layer;
+			if (e.mipmap >= 0) out << (e.layer >= 0 ? "," : "") << "\"mipmap\":" << e.mipmap;
+			out << "}";
+		}
+		out << "}";
+	}
+	out << "]}\n";
+
+	out.close();
+	if (out.fail())
+		throw std::runtime_error(std::string("could not write ") + filename);
+}
+
+void trace::endEnvironment()
+{
+	if (s_environmentFile.empty() || !enabled()) return;
+	end(s_environmentFile.c_str());
+}
+
+void trace::Scope::record() const noexcept
+{
+	const auto end = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> g(s_mutex);
+	// started before begin or ended after end
+	if (!enabled() || m_start < s_origin || s_events.size() >= s_maxEvents) return;
+	try
+	{
+		s_events.push_back({ m_name, m_layer, m_mipmap, uint32_t(GetCurrentThreadId()), m_start, end });
+	}
+	catch (...) {} // out of memory => drop the event
+}
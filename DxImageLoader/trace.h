@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+// optional recording of scoped events in the chrome trace event format (open in ui.perfetto.dev or chrome://tracing).
+// Started with trace_begin or the environment variable DXIMAGELOADER_TRACE (see interface.h).
+// A disabled scope only tests two atomic flags
+namespace trace
+{
+	extern std::atomic<bool> s_enabled;
+	extern std::atomic<bool> s_environmentRead;
+
+	// starts recording if DXIMAGELOADER_TRACE is set. Runs once, on the first traced call after the dll was loaded
+	// (not in DllMain: no allocations or locks under the loader lock)
+	void readEnvironment();
+
+	inline bool enabled()
+	{
+		if (!s_environmentRead.load(std::memory_order_acquire)) readEnvironment();
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	// discards previous events and starts recording
+	void begin();
+	// stops recording and writes the events to the json file. Throws on failure
+	void end(const char* filename);
+
+	// writes the file of DXIMAGELOADER_TRACE if it is still recording. Throws on failure.
+	// Not called from DllMain (no file io under the loader lock), see trace_end
+	void endEnvironment();
+
+	// records an event from construction to destruction. name must be a string literal (only the pointer is stored).
+	// layer and mipmap are shown as arguments of the event if not negative
+	class Scope
+	{
+	public:
+		explicit Scope(const char* name, int layer = -1, int mipmap = -1)
+		{
+			if (!enabled()) return;
+			m_name = name;
+			m_layer = layer;
+			m_mipmap = mipmap;
+			m_start = std::chrono::steady_clock::now();
+		}
+		~Scope() { if (m_name) record(); }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		void record() const noexcept;
+
+		const char* m_name = nullptr;
+		int m_layer = -1;
+		int m_mipmap = -1;
+		std::chrono::steady_clock::time_point m_start;
+	};
+}
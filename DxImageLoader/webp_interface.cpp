@@ -1,5 +1,8 @@
 #include "pch.h"
 #include "webp_interface.h"
+#include "operation_context.h"
+#include "source.h"
+#include "trace.h"
 #include "interface.h"
 #include <webp/decode.h>
 #include <webp/encode.h>
@@ -8,26 +11,23 @@
 #include <fstream>
 #include <vector>
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <memory>
 
 class WebpImage : public image::IImage
 {
 public:
-    WebpImage(const char* filename)
+    WebpImage(std::shared_ptr<const Source> src, OperationContext& ctx) :
+        // the demuxer references the encoded data => the mapped file stays alive with the image
+        m_src(std::move(src)),
+        m_demux(nullptr, WebPDemuxDelete)
     {
-        // Read file into buffer
-        std::ifstream file(filename, std::ios::binary | std::ios::ate);
-        if (!file)
-            throw std::runtime_error("could not open file");
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-        m_buffer.resize(size);
-        if (!file.read(reinterpret_cast<char*>(m_buffer.data()), size))
-            throw std::runtime_error("could not read file");
-        file.close();
-
         // Get original format
         WebPBitstreamFeatures features;
-        if (WebPGetFeatures(m_buffer.data(), m_buffer.size(), &features) != VP8_STATUS_OK)
+        if (WebPGetFeatures(m_src->data(), m_src->size(), &features) != VP8_STATUS_OK)
             throw std::runtime_error("WebPGetFeatures failed");
 
         m_hasAlpha = features.has_alpha != 0;
@@ -35,96 +35,45 @@ public:
 
         // Demux for animation
         WebPData webp_data;
-        webp_data.bytes = m_buffer.data();
-        webp_data.size = m_buffer.size();
-        WebPDemuxer* demux = WebPDemux(&webp_data);
-        if (!demux)
+        webp_data.bytes = m_src->data();
+        webp_data.size = m_src->size();
+        m_demux.reset(WebPDemux(&webp_data));
+        if (!m_demux)
             throw std::runtime_error("WebPDemux failed");
 
-        m_frameCount = WebPDemuxGetI(demux, WEBP_FF_FRAME_COUNT);
-        m_width = WebPDemuxGetI(demux, WEBP_FF_CANVAS_WIDTH);
-        m_height = WebPDemuxGetI(demux, WEBP_FF_CANVAS_HEIGHT);
-
-        m_frames.reserve(m_frameCount);
-        std::vector<uint8_t> prevFrame(m_width * m_height * 4, 0);
-
-        WebPIterator iter;
-        if (!WebPDemuxGetFrame(demux, 1, &iter))
+        m_frameCount = WebPDemuxGetI(m_demux.get(), WEBP_FF_FRAME_COUNT);
+        m_width = WebPDemuxGetI(m_demux.get(), WEBP_FF_CANVAS_WIDTH);
+        m_height = WebPDemuxGetI(m_demux.get(), WEBP_FF_CANVAS_HEIGHT);
+        if (m_frameCount == 0)
             throw std::runtime_error("WebPDemuxGetFrame failed");
 
+        m_cacheSize = size_t(std::max(get_global_parameter_i("webp cacheFrames", 16), 1));
+
+        // index the keyframes. Frames are composed when they are requested with getData
+        m_keyframes.reserve(m_frameCount);
         size_t totalDurationMs = 0;
+        bool prevClearsCanvas = false;
+        for (uint32_t frame = 0; frame < m_frameCount; ++frame)
+        {
+            ctx.setProgress(frame * 100 / m_frameCount);
 
-        do {
-            int decodeWidth = 0, decodeHeight = 0;
-            uint8_t* decoded = WebPDecodeRGBA(iter.fragment.bytes, iter.fragment.size, &decodeWidth, &decodeHeight);
-            if (!decoded)
-                throw std::runtime_error("WebP frame decode failed");
+            WebPIterator iter;
+            if (!WebPDemuxGetFrame(m_demux.get(), int(frame + 1), &iter))
+                throw std::runtime_error("WebPDemuxGetFrame failed");
 
             totalDurationMs += size_t(iter.duration);
 
-            // Start with previous frame (or clear for first frame)
-            std::vector<uint8_t> frame(prevFrame);
-
-            // Composite the decoded region into the frame at the correct offset
-			auto frameIndex = m_frames.size();
-            for (int y = 0; y < decodeHeight; ++y) {
-                set_progress((uint32_t)((frameIndex * m_height + y) * 100) / (m_frameCount * m_height));
-                
-                int destY = iter.y_offset + y;
-                if (destY < 0 || destY >= int(m_height)) continue;
-                for (int x = 0; x < decodeWidth; ++x) {
-                    int destX = iter.x_offset + x;
-                    if (destX < 0 || destX >= int(m_width)) continue;
-                    size_t dstIdx = (destY * m_width + destX) * 4;
-                    size_t srcIdx = (y * decodeWidth + x) * 4;
-
-                    if (iter.blend_method == WEBP_MUX_BLEND && decoded[srcIdx + 3] < 255) {
-                        // Alpha blend with previous frame
-                        float srcA = decoded[srcIdx + 3] / 255.0f;
-                        float dstA = frame[dstIdx + 3] / 255.0f;
-                        float outA = srcA + dstA * (1 - srcA);
-                        for (int c = 0; c < 4; ++c) {
-                            float srcC = decoded[srcIdx + c] / 255.0f;
-                            float dstC = frame[dstIdx + c] / 255.0f;
-                            float outC = (srcC * srcA + dstC * dstA * (1 - srcA)) / (outA > 0 ? outA : 1);
-                            frame[dstIdx + c] = static_cast<uint8_t>(outC * 255.0f + 0.5f);
-                        }
-                    }
-                    else {
-                        // No blend, just copy
-                        std::memcpy(&frame[dstIdx], &decoded[srcIdx], 4);
-                    }
-                }
-            }
-
-            // Handle dispose method
-            if (iter.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND) {
-                // If the next frame needs a cleared region, clear it in prevFrame
-                for (int y = 0; y < decodeHeight; ++y) {
-                    int destY = iter.y_offset + y;
-                    if (destY < 0 || destY >= int(m_height)) continue;
-                    for (int x = 0; x < decodeWidth; ++x) {
-                        int destX = iter.x_offset + x;
-                        if (destX < 0 || destX >= int(m_width)) continue;
-                        size_t dstIdx = (destY * m_width + destX) * 4;
-                        prevFrame[dstIdx + 0] = 0;
-                        prevFrame[dstIdx + 1] = 0;
-                        prevFrame[dstIdx + 2] = 0;
-                        prevFrame[dstIdx + 3] = 0;
-                    }
-                }
-            }
-            else {
-                // Otherwise, next frame starts from this one
-                prevFrame = frame;
-            }
-
-            m_frames.push_back(std::move(frame));
-            WebPFree(decoded);
-        } while (WebPDemuxNextFrame(&iter));
+            // a frame does not depend on the previous canvas if it overwrites every pixel
+            // or if the previous frame left a cleared canvas behind
+            const bool isFullFrame = iter.x_offset == 0 && iter.y_offset == 0 &&
+                uint32_t(iter.width) == m_width && uint32_t(iter.height) == m_height;
+            const bool isKeyframe = frame == 0 || prevClearsCanvas ||
+                (iter.complete && isFullFrame && (!iter.has_alpha || iter.blend_method == WEBP_MUX_NO_BLEND));
+            m_keyframes.push_back(isKeyframe ? frame : m_keyframes.back());
 
-        WebPDemuxReleaseIterator(&iter);
-        WebPDemuxDelete(demux);
+            prevClearsCanvas = iter.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND && (isFullFrame || isKeyframe);
+            WebPDemuxReleaseIterator(&iter);
+        }
 
         if (totalDurationMs > 0)
             m_fps = (1000.0f * float(m_frameCount)) / float(totalDurationMs);
@@ -132,7 +81,7 @@ public:
 
     ~WebpImage() override = default;
 
-    uint32_t getNumLayers() const override { return static_cast<uint32_t>(m_frames.size()); }
+    uint32_t getNumLayers() const override { return m_frameCount; }
     uint32_t getNumMipmaps() const override { return 1; }
     uint32_t getWidth(uint32_t /*mipmap*/) const override { return m_width; }
     uint32_t getHeight(uint32_t /*mipmap*/) const override { return m_height; }
@@ -140,31 +89,232 @@ public:
     gli::format getFormat() const override { return gli::format::FORMAT_RGBA8_SRGB_PACK8; }
     gli::format getOriginalFormat() const override { return m_originalFormat; }
 
+    // the returned frame stays valid until "webp cacheFrames" other frames were requested
+    // or until the image is unpinned if it was requested while pinned. Throws if the frame could not be decoded
     uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) override {
-        size = m_width * m_height * 4;
-        return m_frames[layer].data();
+        return const_cast<uint8_t*>(getFrame(layer, size));
     }
     const uint8_t* getData(uint32_t layer, uint32_t mipmap, size_t& size) const override {
-        size = m_width * m_height * 4;
-        return m_frames[layer].data();
+        return getFrame(layer, size);
     }
 
     virtual float getFps() const override {
         return m_fps;
 	}
 
+    size_t getMemorySize() const override {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        // mapped pages are backed by the file, only a copy of caller memory is private
+        size_t size = m_src->ownsBytes() ? m_src->size() : 0;
+        for (const auto& c : m_cache)
+            size += c.canvas.size();
+        return size;
+    }
+
+    // composed frames are recomposed from the encoded data when they are requested again
+    size_t releaseCaches() override {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        size_t released = 0;
+        for (const auto& c : m_cache)
+            released += c.canvas.size();
+        m_cache.clear();
+        return released;
+    }
+
+    // the encoded data is much smaller than the composed frames
+    bool isSpillable() const override { return false; }
+
+    // while pinned, frames are not evicted (TextureArray2D collects all frames before uploading them)
+    void setPinned(bool pinned) override {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_pinned = pinned;
+        if (!m_pinned)
+            trimCache();
+    }
+
 private:
-    std::vector<uint8_t> m_buffer;
-    std::vector<std::vector<uint8_t>> m_frames;
+    struct CachedFrame
+    {
+        uint32_t frame;
+        std::vector<uint8_t> canvas;
+    };
+
+    const uint8_t* getFrame(uint32_t frame, size_t& size) const
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        size = 0;
+
+        // most recently used frames are at the front
+        auto it = std::find_if(m_cache.begin(), m_cache.end(), [frame](const CachedFrame& c) { return c.frame == frame; });
+        if (it != m_cache.end())
+        {
+            m_cache.splice(m_cache.begin(), m_cache, it);
+            size = m_cache.front().canvas.size();
+            return m_cache.front().canvas.data();
+        }
+
+        // compose from the keyframe or from the latest cached frame between the keyframe and the requested frame
+        uint32_t start = m_keyframes[frame];
+        const CachedFrame* base = nullptr;
+        for (const auto& c : m_cache)
+            if (c.frame >= start && c.frame < frame && (!base || c.frame > base->frame))
+                base = &c;
+
+        std::vector<uint8_t> canvas;
+        if (base)
+        {
+            canvas = base->canvas;
+            WebPIterator iter;
+            if (!WebPDemuxGetFrame(m_demux.get(), int(base->frame + 1), &iter))
+                throw std::runtime_error("WebPDemuxGetFrame failed");
+            disposeFrame(iter, canvas);
+            WebPDemuxReleaseIterator(&iter);
+            start = base->frame + 1;
+        }
+        else canvas.assign(size_t(m_width) * size_t(m_height) * 4, 0);
+
+        for (uint32_t i = start; i <= frame; ++i)
+        {
+            WebPIterator iter;
+            if (!WebPDemuxGetFrame(m_demux.get(), int(i + 1), &iter))
+                throw std::runtime_error("WebPDemuxGetFrame failed");
+            composeFrame(iter, canvas);
+            if (i != frame) disposeFrame(iter, canvas);
+            WebPDemuxReleaseIterator(&iter);
+        }
+
+        m_cache.push_front({ frame, std::move(canvas) });
+        trimCache();
+
+        size = m_cache.front().canvas.size();
+        return m_cache.front().canvas.data();
+    }
+
+    // evicts the least recently used frames (m_cacheMutex must be locked)
+    void trimCache() const
+    {
+        while (!m_pinned && m_cache.size() > m_cacheSize)
+            m_cache.pop_back();
+    }
+
+    // decodes the frame and draws it onto the canvas
+    void composeFrame(const WebPIterator& iter, std::vector<uint8_t>& frame) const
+    {
+        int decodeWidth = 0, decodeHeight = 0;
+        uint8_t* decoded = WebPDecodeRGBA(iter.fragment.bytes, iter.fragment.size, &decodeWidth, &decodeHeight);
+        if (!decoded)
+            throw std::runtime_error("WebP frame decode failed");
+
+        // Composite the decoded region into the frame at the correct offset
+        for (int y = 0; y < decodeHeight; ++y) {
+            int destY = iter.y_offset + y;
+            if (destY < 0 || destY >= int(m_height)) continue;
+            for (int x = 0; x < decodeWidth; ++x) {
+                int destX = iter.x_offset + x;
+                if (destX < 0 || destX >= int(m_width)) continue;
+                size_t dstIdx = (destY * m_width + destX) * 4;
+                size_t srcIdx = (y * decodeWidth + x) * 4;
+
+                if (iter.blend_method == WEBP_MUX_BLEND && decoded[srcIdx + 3] < 255) {
+                    // Alpha blend with previous frame
+                    float srcA = decoded[srcIdx + 3] / 255.0f;
+                    float dstA = frame[dstIdx + 3] / 255.0f;
+                    float outA = srcA + dstA * (1 - srcA);
+                    for (int c = 0; c < 4; ++c) {
+                        float srcC = decoded[srcIdx + c] / 255.0f;
+                        float dstC = frame[dstIdx + c] / 255.0f;
+                        float outC = (srcC * srcA + dstC * dstA * (1 - srcA)) / (outA > 0 ? outA : 1);
+                        frame[dstIdx + c] = static_cast<uint8_t>(outC * 255.0f + 0.5f);
+                    }
+                }
+                else {
+                    // No blend, just copy
+                    std::memcpy(&frame[dstIdx], &decoded[srcIdx], 4);
+                }
+            }
+        }
+
+        WebPFree(decoded);
+    }
+
+    // prepares the canvas of the frame for the next frame
+    void disposeFrame(const WebPIterator& iter, std::vector<uint8_t>& frame) const
+    {
+        if (iter.dispose_method != WEBP_MUX_DISPOSE_BACKGROUND) return;
+
+        // clear the region of the frame
+        for (int y = 0; y < iter.height; ++y) {
+            int destY = iter.y_offset + y;
+            if (destY < 0 || destY >= int(m_height)) continue;
+            for (int x = 0; x < iter.width; ++x) {
+                int destX = iter.x_offset + x;
+                if (destX < 0 || destX >= int(m_width)) continue;
+                size_t dstIdx = (destY * m_width + destX) * 4;
+                std::memset(&frame[dstIdx], 0, 4);
+            }
+        }
+    }
+
+    std::shared_ptr<const Source> m_src;
+    std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)> m_demux;
+    std::vector<uint32_t> m_keyframes; // index of the nearest keyframe for each frame
     uint32_t m_width = 0, m_height = 0, m_frameCount = 0;
     bool m_hasAlpha = false;
     gli::format m_originalFormat = gli::format::FORMAT_RGBA8_SRGB_PACK8;
     float m_fps = 0.0f;
+
+    // recently used frames (front = most recent)
+    size_t m_cacheSize = 16;
+    bool m_pinned = false; // guarded by m_cacheMutex
+    mutable std::list<CachedFrame> m_cache;
+    mutable std::mutex m_cacheMutex;
 };
 
-std::unique_ptr<image::IImage> webp_load(const char* filename)
+std::unique_ptr<image::IImage> webp_load(std::shared_ptr<const Source> src, OperationContext& ctx)
 {
-    return std::make_unique<WebpImage>(filename);
+	trace::Scope scope("webp_load");
+    // memory of the caller (image_open_memory) is only valid during the call
+    if (src->isBorrowed())
+        src = std::make_shared<const Source>(std::vector<uint8_t>(src->data(), src->data() + src->size()));
+    return std::make_unique<WebpImage>(std::move(src), ctx);
+}
+
+image::Info webp_probe(const char* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("could not open file");
+
+    // RIFF header + first chunk is enough for the bitstream features (VP8X contains the canvas size)
+    uint8_t header[64] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    WebPBitstreamFeatures features;
+    if (WebPGetFeatures(header, size_t(file.gcount()), &features) != VP8_STATUS_OK)
+        throw std::runtime_error("WebPGetFeatures failed");
+
+    image::Info info;
+    info.originalFormat = features.has_alpha ? gli::format::FORMAT_RGBA8_SRGB_PACK8 : gli::format::FORMAT_RGB8_SRGB_PACK8;
+    info.width = features.width;
+    info.height = features.height;
+
+    if (features.has_animation)
+    {
+        // count the ANMF chunks without reading the frame data
+        info.layers = 0;
+        file.clear();
+        file.seekg(12, std::ios::beg);
+        uint8_t chunk[8];
+        while (file.read(reinterpret_cast<char*>(chunk), sizeof(chunk)))
+        {
+            const uint32_t chunkSize = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | (uint32_t(chunk[7]) << 24);
+            if (memcmp(chunk, "ANMF", 4) == 0)
+                ++info.layers;
+            file.seekg(std::streamoff(chunkSize) + (chunkSize & 1), std::ios::cur); // chunks are padded to even sizes
+        }
+        info.layers = std::max<uint32_t>(info.layers, 1);
+    }
+
+    return info;
 }
 
 std::vector<uint32_t> webp_get_export_formats()
@@ -175,14 +325,13 @@ std::vector<uint32_t> webp_get_export_formats()
     };
 }
 
-void webp_save_image(const char* filename, image::IImage& image, gli::format format, int quality, float fps)
+void webp_save_image(const char* filename, const image::IImage& image, gli::format format, int quality, float fps, OperationContext& ctx)
 {
+    trace::Scope scope("webp_save_image");
     const uint32_t numLayers = image.getNumLayers();
     const uint32_t width = image.getWidth(0);
     const uint32_t height = image.getHeight(0);
 
-    image.applyBGRPostprocess(); // WebP expect BGRA order (argb)
-
     std::vector<uint8_t> webp_data; // For static image
 
     if (fps < 0.0f) fps = 24.0f; // default to 24 fps 
@@ -218,39 +367,45 @@ void webp_save_image(const char* filename, image::IImage& image, gli::format for
 
     for (uint32_t layer = 0; layer < image.getNumLayers(); ++layer) 
     {
+        trace::Scope frameScope("webp encode frame", int(layer));
         WebPPicture pic = {};
         ret = WebPPictureInit(&pic);
         assert(ret);
         pic.width = width;
         pic.height = height;
         pic.use_argb = 1;
+        // copies the frame into the argb buffer of the picture (the encoder modifies the buffer, the image stays unchanged)
 		size_t dataSize;
-        pic.argb = reinterpret_cast<uint32_t*>(image.getData(layer, 0, dataSize));
-        pic.argb_stride = width;
-        std::pair<uint32_t, uint32_t> curLayer = { layer, image.getNumLayers() };
+        ret = WebPPictureImportRGBA(&pic, image.getData(layer, 0, dataSize), int(width * 4));
+        if (!ret)
+        {
+            WebPAnimEncoderDelete(enc);
+            throw std::runtime_error("could not allocate webp picture");
+        }
+        struct LayerProgress
+        {
+            uint32_t layer;
+            uint32_t numLayers;
+            OperationContext* ctx;
+        } curLayer = { layer, image.getNumLayers(), &ctx };
         pic.user_data = &curLayer;
 		pic.progress_hook = [](int percent, const WebPPicture* pic) -> int {
-            auto curLayer = *reinterpret_cast<std::pair<uint32_t, uint32_t>*>(pic->user_data);
-            try
-            {
-                set_progress((curLayer.first * 100 + percent) / curLayer.second);
-            }
-            catch (...)
-            {
-                return 0; // abort
-            }
-			return 1;
+            auto curLayer = reinterpret_cast<const LayerProgress*>(pic->user_data);
+            curLayer->ctx->setWork(curLayer->layer * 100 + percent, curLayer->numLayers * 100);
+            // abort if cancelled
+			return curLayer->ctx->isCancelled() ? 0 : 1;
 		};
 
         // timestamp_ms = cumulative display duration
         ret = WebPAnimEncoderAdd(enc, &pic, int(msFrame * float(layer)), &config);
-        assert(ret);
+        assert(ret || ctx.isCancelled());
         WebPPictureFree(&pic);
         if(!ret) break;
     }
 
 	if (ret) // finalize if all frames were added successfully
     {
+        trace::Scope assembleScope("webp assemble");
         // last call to set final timestamp
         WebPAnimEncoderAdd(enc, nullptr, int(msFrame * float(numLayers)), &config);
 
@@ -266,4 +421,5 @@ void webp_save_image(const char* filename, image::IImage& image, gli::format for
     
     // cleanup
     WebPAnimEncoderDelete(enc);
+    ctx.throwIfCancelled();
 }
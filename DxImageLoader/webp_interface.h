@@ -2,8 +2,14 @@
 #include "Image.h"
 #include <memory>
 
-std::unique_ptr<image::IImage> webp_load(const char* filename);
+class OperationContext;
+class Source;
+
+// the image keeps the Source alive and demuxes the frames directly from it (memory of the caller is copied)
+std::unique_ptr<image::IImage> webp_load(std::shared_ptr<const Source> src, OperationContext& ctx);
+// reads canvas size and frame count without decoding the frames
+image::Info webp_probe(const char* filename);
 
 std::vector<uint32_t> webp_get_export_formats();
 
-void webp_save_image(const char* filename, image::IImage& image, gli::format format, int quality, float fps);
\ No newline at end of file
+void webp_save_image(const char* filename, const image::IImage& image, gli::format format, int quality, float fps, OperationContext& ctx);
\ No newline at end of file
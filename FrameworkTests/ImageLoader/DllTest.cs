@@ -86,12 +86,176 @@ namespace FrameworkTests.ImageLoader
             VerifySmallHdr(IO.LoadImage(TestData.Directory + "small.ktx"), Color.Channel.Rgba);
         }
 
+        [TestMethod]
+        public void LoadBatch()
+        {
+            var images = IO.LoadImages(new[]
+            {
+                TestData.Directory + "small.png",
+                TestData.Directory + "small.hdr",
+                TestData.Directory + "small.pfm",
+                TestData.Directory + "small.dds"
+            });
+            Assert.AreEqual(4, images.Length);
+
+            VerifySmallLdr(images[0], Color.Channel.Rgb);
+            VerifySmallHdr(images[1], Color.Channel.Rgb);
+            VerifySmallHdr(images[2], Color.Channel.Rgb);
+            VerifySmallHdr(images[3], Color.Channel.Rgba);
+        }
+
+        [TestMethod]
+        public void LoadBatchInvalidFile()
+        {
+            Assert.ThrowsException<Exception>(() => IO.LoadImages(new[]
+            {
+                TestData.Directory + "small.png",
+                TestData.Directory + "does_not_exist.png"
+            }));
+        }
+
+        [TestMethod]
+        public void LoadConcurrentOperations()
+        {
+            var files = new[] { "small.png", "small.hdr", "small.pfm", "small.dds" };
+            var images = new DllImageData[files.Length];
+            Parallel.For(0, files.Length, i =>
+            {
+                using (var op = new Operation())
+                {
+                    images[i] = IO.LoadImage(TestData.Directory + files[i], op);
+                }
+            });
+
+            VerifySmallLdr(images[0], Color.Channel.Rgb);
+            VerifySmallHdr(images[1], Color.Channel.Rgb);
+            VerifySmallHdr(images[2], Color.Channel.Rgb);
+            VerifySmallHdr(images[3], Color.Channel.Rgba);
+        }
+
+        [TestMethod]
+        public void OperationError()
+        {
+            using (var op = new Operation())
+            using (var other = new Operation())
+            {
+                Assert.ThrowsException<Exception>(() => IO.LoadImage(TestData.Directory + "does_not_exist.png", op));
+                Assert.IsFalse(string.IsNullOrEmpty(op.Error));
+
+                // errors are not shared between operations
+                IO.LoadImage(TestData.Directory + "small.png", other).Dispose();
+                Assert.AreEqual("", other.Error);
+            }
+        }
+
+        [TestMethod]
+        public void OperationPollProgress()
+        {
+            using (var op = new Operation())
+            {
+                Assert.AreEqual(0.0f, op.Progress);
+                // pfm rows are counted => the finished load reports the complete step
+                IO.LoadImage(TestData.Directory + "small.pfm", op).Dispose();
+                Assert.AreEqual(1.0f, op.Progress);
+
+                // cancellation is a flag that the loaders check
+                op.Cancel();
+                Assert.ThrowsException<Exception>(() => IO.LoadImage(TestData.Directory + "small.pfm", op));
+            }
+        }
+
+        [TestMethod]
+        public void OperationAbortFromCallback()
+        {
+            using (var op = new Operation())
+            {
+                var calls = 0;
+                // a non zero return value aborts the operation at its next progress report
+                Dll.ProgressDelegate abort = (progress, description) =>
+                {
+                    ++calls;
+                    return 1;
+                };
+                Dll.operation_set_progress_callback(op.Id, abort);
+                try
+                {
+                    Assert.ThrowsException<Exception>(() => IO.LoadImage(TestData.Directory + "small.pfm", op));
+                    Assert.IsTrue(calls > 0);
+                    Assert.IsTrue(op.Error.Contains("aborted"));
+                }
+                finally
+                {
+                    Dll.operation_set_progress_callback(op.Id, null);
+                    GC.KeepAlive(abort);
+                }
+            }
+        }
+
+        private static byte[] GetMipmapBytes(Resource res)
+        {
+            var ptr = Dll.image_get_mipmap(res.Id, 0, 0, out var size);
+            Assert.AreNotEqual(IntPtr.Zero, ptr);
+            var bytes = new byte[size];
+            System.Runtime.InteropServices.Marshal.Copy(ptr, bytes, 0, (int)size);
+            return bytes;
+        }
+
+        [TestMethod]
+        public void SimdMatchesScalar()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            // bgr swizzle, gray/rgb expansion (8 bit and float) and the stb path
+            string[] files = { "bgr_test.dds", "gray.png", "small.png", "small.hdr", "small.bmp", "small_a.png" };
+            try
+            {
+                foreach (var file in files)
+                {
+                    IO.SetGlobalParameter("simd", 0);
+                    byte[] reference;
+                    using (var res = new Resource(TestData.Directory + file))
+                        reference = GetMipmapBytes(res);
+
+                    IO.SetGlobalParameter("simd", 2);
+                    using (var res = new Resource(TestData.Directory + file))
+                        CollectionAssert.AreEqual(reference, GetMipmapBytes(res), file);
+                }
+
+                // channel packing for export
+                using (var image = IO.LoadImage(TestData.Directory + "small.png"))
+                {
+                    IO.SetGlobalParameter("simd", 0);
+                    IO.SaveImage(image, dir + "simd_scalar", "png", GliFormat.RGB8_SRGB);
+                    IO.SetGlobalParameter("simd", 2);
+                    IO.SaveImage(image, dir + "simd", "png", GliFormat.RGB8_SRGB);
+                }
+                CollectionAssert.AreEqual(File.ReadAllBytes(dir + "simd_scalar.png"), File.ReadAllBytes(dir + "simd.png"));
+
+                // 16 bit quantization for export
+                using (var image = IO.LoadImage(TestData.Directory + "small.pfm"))
+                {
+                    IO.SetGlobalParameter("simd", 0);
+                    IO.SaveImage(image, dir + "simd16_scalar", "png", GliFormat.RGB16_UNORM);
+                    IO.SetGlobalParameter("simd", 2);
+                    IO.SaveImage(image, dir + "simd16", "png", GliFormat.RGB16_UNORM);
+                }
+                CollectionAssert.AreEqual(File.ReadAllBytes(dir + "simd16_scalar.png"), File.ReadAllBytes(dir + "simd16.png"));
+            }
+            finally
+            {
+                IO.SetGlobalParameter("simd", 2);
+            }
+        }
+
         [TestMethod]
         public void DDSBGR()
         {
             var image = IO.LoadImage(TestData.Directory + "bgr_test.dds");
             Assert.AreEqual(GliFormat.BGRA8_SRGB, image.OriginalFormat);
             Assert.AreEqual(Format.R8G8B8A8_UNorm_SRgb, image.Format.DxgiFormat);
+            // the BGR swap is fused into the format conversion
+            Assert.IsTrue(image.Resource.GetStats().Contains("\"postprocess\":{\"time_us\":0,\"bytes_read\":0,\"bytes_written\":0,\"pixels\":0,\"count\":0}"));
 
             var tex = new TextureArray2D(image);
             var colors = tex.GetPixelColors(LayerMipmapSlice.Mip0);
@@ -118,6 +282,439 @@ namespace FrameworkTests.ImageLoader
             Assert.AreEqual(3, tex.NumMipmaps);
         }
 
+        [TestMethod]
+        public void ProbeMatchesLoad()
+        {
+            var files = new[] { "small.png", "small.bmp", "small.hdr", "small.pfm", "small.dds", "small.ktx", "small.webp", "cubemap.dds", "cubemap.ktx" };
+            foreach (var file in files)
+            {
+                var info = IO.ProbeImage(TestData.Directory + file);
+                using (var image = IO.LoadImage(TestData.Directory + file))
+                {
+                    Assert.AreEqual(image.Size, info.Size, file);
+                    Assert.AreEqual(image.LayerMipmap, info.LayerMipmap, file);
+                    Assert.AreEqual(image.OriginalFormat, info.OriginalFormat, file);
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ProbeInvalidFile()
+        {
+            Assert.ThrowsException<Exception>(() => IO.ProbeImage(TestData.Directory + "does_not_exist.png"));
+
+            // the exports return a one byte bool (the upper bytes of the return register are undefined)
+            var valid = TestData.Directory + "small.png";
+            var invalid = TestData.Directory + "does_not_exist.png";
+            Assert.IsTrue(Dll.image_probe(valid, out _, out _, out _, out _, out _, out _));
+            Assert.IsFalse(Dll.image_probe(invalid, out _, out _, out _, out _, out _, out _));
+            using (var op = new Operation())
+            {
+                Assert.IsTrue(Dll.image_probe_ex(op.Id, valid, out _, out _, out _, out _, out _, out _));
+                Assert.IsFalse(Dll.image_probe_ex(op.Id, invalid, out _, out _, out _, out _, out _, out _));
+            }
+        }
+
+        [TestMethod]
+        public void LoadMislabeledFile()
+        {
+            // the decoder is chosen by the file content and not by the extension
+            var pngAsDds = Path.Combine(Path.GetTempPath(), "small_png.dds");
+            var hdrAsPng = Path.Combine(Path.GetTempPath(), "small_hdr.png");
+            File.Copy(TestData.Directory + "small.png", pngAsDds, true);
+            File.Copy(TestData.Directory + "small.hdr", hdrAsPng, true);
+            try
+            {
+                VerifySmallLdr(IO.LoadImage(pngAsDds), Color.Channel.Rgb);
+                VerifySmallHdr(IO.LoadImage(hdrAsPng), Color.Channel.Rgb);
+            }
+            finally
+            {
+                File.Delete(pngAsDds);
+                File.Delete(hdrAsPng);
+            }
+        }
+
+        [TestMethod]
+        public void LoadFromMemory()
+        {
+            VerifySmallLdr(IO.LoadImage(File.ReadAllBytes(TestData.Directory + "small.png")), Color.Channel.Rgb);
+            VerifySmallHdr(IO.LoadImage(File.ReadAllBytes(TestData.Directory + "small.pfm")), Color.Channel.Rgb);
+            VerifySmallHdr(IO.LoadImage(File.ReadAllBytes(TestData.Directory + "small.dds"), "dds"), Color.Channel.Rgba);
+            VerifySmallLdr(IO.LoadImage(File.ReadAllBytes(TestData.Directory + "small.webp"), "webp"), Color.Channel.Rgb);
+
+            Assert.ThrowsException<Exception>(() => IO.LoadImage(new byte[] { 1, 2, 3 }));
+        }
+
+        [TestMethod]
+        public void LoadRegion()
+        {
+            // png, hdr, pfm and dds have partial decoding, bmp is decoded completely and cropped
+            foreach (var file in new[] { "small.png", "small.hdr", "small.pfm", "small.dds", "small.bmp" })
+            {
+                var full = new TextureArray2D(IO.LoadImage(TestData.Directory + file)).GetPixelColors(LayerMipmapSlice.Mip0);
+                var region = IO.LoadImageRegion(TestData.Directory + file, LayerMipmapSlice.Mip0, 1, 1, 2, 2);
+
+                Assert.AreEqual(1, region.LayerMipmap.Layers);
+                Assert.AreEqual(1, region.LayerMipmap.Mipmaps);
+                Assert.AreEqual(2, region.Size.Width);
+                Assert.AreEqual(2, region.Size.Height);
+
+                var colors = new TextureArray2D(region).GetPixelColors(LayerMipmapSlice.Mip0);
+                for (int y = 0; y < 2; ++y)
+                    for (int x = 0; x < 2; ++x)
+                        Assert.IsTrue(colors[y * 2 + x].Equals(full[(y + 1) * 3 + x + 1], Color.Channel.Rgba), file);
+            }
+
+            // outside of the image
+            Assert.ThrowsException<Exception>(() => IO.LoadImageRegion(TestData.Directory + "small.png", LayerMipmapSlice.Mip0, 2, 2, 2, 2));
+            Assert.ThrowsException<Exception>(() => IO.LoadImageRegion(TestData.Directory + "small.png", new LayerMipmapSlice(1, 0), 0, 0, 1, 1));
+        }
+
+        [TestMethod]
+        public void CompactGrayscale()
+        {
+            // single channel pfm is stored as R32F and expanded to rgb when the data is requested
+            using (var image = IO.LoadImage(TestData.Directory + "small_g.pfm"))
+            {
+                var compactUsage = IO.MemoryUsage;
+                var colors = new TextureArray2D(image).GetPixelColors(LayerMipmapSlice.Mip0);
+                foreach (var c in colors)
+                {
+                    Assert.AreEqual(c.Red, c.Green);
+                    Assert.AreEqual(c.Red, c.Blue);
+                    Assert.AreEqual(1.0f, c.Alpha);
+                }
+
+                // the expanded rgba layer is released after the upload
+                Assert.AreEqual(compactUsage, IO.MemoryUsage);
+            }
+        }
+
+        [TestMethod]
+        public void LoadHalfStaging()
+        {
+            IO.UseHalfStaging = true;
+            try
+            {
+                // hdr is converted after loading, grayscale pfm is staged directly as half
+                foreach (var file in new[] { "small.hdr", "small.pfm", "small_g.pfm" })
+                {
+                    var image = IO.LoadImage(TestData.Directory + file);
+                    Assert.AreEqual(Format.R16G16B16A16_Float, image.Format.DxgiFormat);
+                    TestData.CompareWithSmall(image, file == "small_g.pfm" ? Color.Channel.R : Color.Channel.Rgb);
+                }
+
+                // half images are converted to float rows for the pfm export
+                var dir = TestData.Directory + "export/";
+                TestData.CreateOutputDirectory(dir);
+                using (var image = IO.LoadImage(TestData.Directory + "small.hdr"))
+                {
+                    IO.SaveImage(image, dir + "half", "pfm", GliFormat.RGB32_SFLOAT);
+                }
+                using (var image = IO.LoadImage(dir + "half.pfm"))
+                {
+                    TestData.CompareWithSmall(image, Color.Channel.Rgb);
+                }
+            }
+            finally
+            {
+                IO.UseHalfStaging = false;
+            }
+        }
+
+        [TestMethod]
+        public void MemoryBudgetSpill()
+        {
+            IO.MemoryBudget = 8;
+            try
+            {
+                var image = IO.LoadImage(TestData.Directory + "small.hdr");
+                // each allocation is 16 MB => the least recently used images are moved to the scratch file
+                var size = new Size3(1024, 1024);
+                using (var a = new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One))
+                using (var b = new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One))
+                {
+                    Assert.IsTrue(IO.MemoryUsage <= 16 * 1024 * 1024);
+                    // spilled image is read back on access
+                    TestData.CompareWithSmall(image, Color.Channel.Rgb);
+                }
+                image.Dispose();
+            }
+            finally
+            {
+                IO.MemoryBudget = 0;
+            }
+        }
+
+        [TestMethod]
+        public void MemoryBudgetPinRace()
+        {
+            IO.MemoryBudget = 8;
+            try
+            {
+                var size = new Size3(1024, 1024);
+                using (var image = IO.LoadImage(TestData.Directory + "small.hdr"))
+                {
+                    byte[] expected;
+                    using (image.PinMipmaps())
+                    {
+                        var mip = image.GetMipmap(LayerMipmapSlice.Mip0);
+                        expected = CopyMipmap(mip);
+
+                        // other threads exceed the budget while the pointer is used => the pinned image is not spilled
+                        Parallel.For(0, 4, i =>
+                        {
+                            using (new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One))
+                            using (new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One)) { }
+                        });
+                        CollectionAssert.AreEqual(expected, CopyMipmap(mip));
+                        Assert.AreEqual(mip.Bytes, image.GetMipmap(LayerMipmapSlice.Mip0).Bytes);
+                    }
+
+                    // pins race with the scratch file writes that were started before the pin
+                    Parallel.For(0, 16, i =>
+                    {
+                        if (i % 2 == 0)
+                        {
+                            using (image.PinMipmaps())
+                                CollectionAssert.AreEqual(expected, CopyMipmap(image.GetMipmap(LayerMipmapSlice.Mip0)));
+                        }
+                        else
+                        {
+                            using (new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One)) { }
+                        }
+                    });
+                    TestData.CompareWithSmall(image, Color.Channel.Rgb);
+                }
+            }
+            finally
+            {
+                IO.MemoryBudget = 0;
+            }
+        }
+
+        [TestMethod]
+        public void PixelPoolReuse()
+        {
+            // a released pixel buffer is reused by the next allocation of the same size class
+            var size = new Size3(1000, 1000);
+            IntPtr released;
+            using (var a = new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One))
+                released = Dll.image_get_mipmap(a.Id, 0, 0, out _);
+            using (var b = new Resource((uint)GliFormat.RGBA32_SFLOAT, size, LayerMipmapCount.One))
+                Assert.AreEqual(released, Dll.image_get_mipmap(b.Id, 0, 0, out _));
+        }
+
+        [TestMethod]
+        public void WebpPinnedFrames()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            // more frames than the frame cache of the webp loader
+            const int numFrames = 20;
+            using (var noise = IO.LoadWhiteNoise(new Size3(8, 8), new LayerMipmapCount(numFrames, 1), 1))
+            {
+                IO.SaveImage(noise, dir + "frames", "webp", GliFormat.RGBA8_SRGB, 100, 10.0f);
+            }
+
+            IO.SetGlobalParameter("webp cacheFrames", 2);
+            try
+            {
+                using (var image = IO.LoadImage(dir + "frames.webp"))
+                {
+                    Assert.AreEqual(numFrames, image.LayerMipmap.Layers);
+
+                    // every frame is copied before the next one is requested
+                    var expected = new byte[numFrames][];
+                    for (int layer = 0; layer < numFrames; ++layer)
+                        expected[layer] = CopyMipmap(image.GetMipmap(new LayerMipmapSlice(layer, 0)));
+
+                    // TextureArray2D collects the pointers of all frames before it uploads them
+                    using (image.PinMipmaps())
+                    {
+                        var mipmaps = Enumerable.Range(0, numFrames).Select(layer => image.GetMipmap(new LayerMipmapSlice(layer, 0))).ToArray();
+                        // no frame was evicted
+                        Assert.IsTrue(IO.MemoryUsage >= (ulong)(numFrames * 8 * 8 * 4));
+                        for (int layer = 0; layer < numFrames; ++layer)
+                            CollectionAssert.AreEqual(expected[layer], CopyMipmap(mipmaps[layer]));
+                    }
+                }
+            }
+            finally
+            {
+                IO.SetGlobalParameter("webp cacheFrames", 16);
+            }
+        }
+
+        private static byte[] CopyMipmap(ImageData.MipInfo mip)
+        {
+            var res = new byte[mip.ByteSize];
+            System.Runtime.InteropServices.Marshal.Copy(mip.Bytes, res, 0, res.Length);
+            return res;
+        }
+
+        [TestMethod]
+        public void ExportKeepsImage()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            // exporters convert into scratch buffers => the image can still be used afterwards
+            using (var image = IO.LoadImage(TestData.Directory + "small.pfm"))
+            {
+                IO.SaveImage(image, dir + "keep", "pfm", GliFormat.RGB32_SFLOAT);
+                IO.SaveImage(image, dir + "keep", "hdr", GliFormat.RGB8E8_UFLOAT);
+                IO.SaveImage(image, dir + "keep", "png", GliFormat.RGB16_UNORM);
+                TestData.CompareWithSmall(image, Color.Channel.Rgb);
+            }
+
+            using (var image = IO.LoadImage(TestData.Directory + "small.png"))
+            {
+                IO.SaveImage(image, dir + "keep", "jpg", GliFormat.RGB8_SRGB, 90);
+                IO.SaveImage(image, dir + "keep", "webp", GliFormat.RGBA8_SRGB, 100);
+                TestData.CompareWithSmall(image, Color.Channel.Rgb);
+            }
+        }
+
+        [TestMethod]
+        public void SrgbExport()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            // RGBA32F to srgb uses the srgb kernels of the format conversion
+            using (var image = IO.LoadImage(TestData.Directory + "small.pfm"))
+            {
+                IO.SaveImage(image, dir + "srgb", "dds", GliFormat.RGBA8_SRGB);
+            }
+
+            using (var image = IO.LoadImage(dir + "srgb.dds"))
+            {
+                Assert.AreEqual(GliFormat.RGBA8_SRGB, image.OriginalFormat);
+                TestData.CompareWithSmall(image, Color.Channel.Rgb);
+            }
+        }
+
+        [TestMethod]
+        public void PackedExport()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            // packed formats use the pack and unpack kernels of the format conversion in both directions
+            // (scalar reference and SIMD kernels)
+            var formats = new[] { GliFormat.RGB9E5_UFLOAT, GliFormat.RG11B10_UFLOAT, GliFormat.RGB10A2_UNORM };
+            try
+            {
+                foreach (var simd in new[] { 0, 2 })
+                {
+                    IO.SetGlobalParameter("simd", simd);
+                    foreach (var format in formats)
+                    {
+                        using (var image = IO.LoadImage(TestData.Directory + "small.pfm"))
+                        {
+                            IO.SaveImage(image, dir + "packed", "dds", format);
+                        }
+
+                        using (var image = IO.LoadImage(dir + "packed.dds"))
+                        {
+                            Assert.AreEqual(format, image.OriginalFormat);
+                            TestData.CompareWithSmall(image, Color.Channel.Rgb);
+                        }
+                    }
+                }
+            }
+            finally
+            {
+                IO.SetGlobalParameter("simd", 2);
+            }
+        }
+
+        [TestMethod]
+        public void ImageStats()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            using (var image = IO.LoadImage(TestData.Directory + "small.png"))
+            {
+                var stats = image.Resource.GetStats();
+                Assert.IsTrue(stats.Contains("\"decode\":{"));
+                // nothing exported yet
+                Assert.IsTrue(stats.Contains("\"encode\":{\"time_us\":0,\"bytes_read\":0,\"bytes_written\":0,\"pixels\":0,\"count\":0}"));
+
+                IO.SaveImage(image, dir + "stats", "png", GliFormat.RGBA8_SRGB);
+                stats = image.Resource.GetStats();
+                Assert.IsFalse(stats.Contains("\"encode\":{\"time_us\":0,\"bytes_read\":0,\"bytes_written\":0,\"pixels\":0,\"count\":0}"));
+            }
+
+            Assert.IsTrue(IO.LoaderStats.Contains("\"decode\":{"));
+        }
+
+        [TestMethod]
+        public void CpuCompression()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            // compressonator cpu backend: cpu encoder for the export and cpu decoder for the import
+            try
+            {
+                IO.SetGlobalParameter("compress backend", 1);
+                IO.SetGlobalParameter("compress preset", 0);
+                IO.BeginTrace();
+                using (var image = IO.LoadImage(TestData.Directory + "small.png"))
+                {
+                    IO.SaveImage(image, dir + "cpu", "dds", GliFormat.RGBA_BP_UNORM);
+                }
+                IO.EndTrace(dir + "cpu_encode.json");
+
+                IO.BeginTrace();
+                using (var image = IO.LoadImage(dir + "cpu.dds"))
+                {
+                    Assert.AreEqual(GliFormat.RGBA_BP_UNORM, image.OriginalFormat);
+                    Assert.AreEqual(3, image.Size.Width);
+                    Assert.AreEqual(3, image.Size.Height);
+                }
+                IO.EndTrace(dir + "cpu_decode.json");
+
+                // both directions used the cpu codecs of compressonator
+                foreach (var file in new[] { "cpu_encode.json", "cpu_decode.json" })
+                {
+                    var trace = File.ReadAllText(dir + file);
+                    Assert.IsTrue(trace.Contains("\"name\":\"compressonator_cpu\""));
+                    Assert.IsFalse(trace.Contains("\"name\":\"compressonator_gpu\""));
+                }
+            }
+            finally
+            {
+                IO.SetGlobalParameter("compress backend", 0);
+                IO.SetGlobalParameter("compress preset", 1);
+            }
+        }
+
+        [TestMethod]
+        public void Trace()
+        {
+            var dir = TestData.Directory + "export/";
+            TestData.CreateOutputDirectory(dir);
+
+            IO.BeginTrace();
+            using (var image = IO.LoadImage(TestData.Directory + "small.png"))
+            {
+                IO.SaveImage(image, dir + "trace", "dds", GliFormat.RGB_DXT1_SRGB);
+            }
+            IO.EndTrace(dir + "trace.json");
+
+            var trace = File.ReadAllText(dir + "trace.json");
+            Assert.IsTrue(trace.StartsWith("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+            Assert.IsTrue(trace.Contains("\"name\":\"image_open\""));
+            Assert.IsTrue(trace.Contains("\"name\":\"png_load\""));
+            Assert.IsTrue(trace.Contains("\"name\":\"compress\""));
+        }
+
         [TestMethod]
         public void LoadKtx2()
         {
@@ -129,6 +129,8 @@ namespace ImageFramework.DirectX
             int pixelSize = 4;
             if (format == Format.R32G32B32A32_Float)
                 pixelSize = 16;
+            if (format == Format.R16G16B16A16_Float)
+                pixelSize = 8;
             if (format == Format.R8_UInt)
                 pixelSize = 1;
 
@@ -195,6 +197,22 @@ namespace ImageFramework.DirectX
 
                 return result;
             }
+            else if (format == Format.R16G16B16A16_Float)
+            {
+                var tmp = GetData(res, subresource, size, 4 * 2);
+                var result = new Color[size.Product];
+                fixed (byte* pBuffer = tmp)
+                {
+                    var values = (ushort*)pBuffer;
+                    for (int dst = 0, src = 0; dst < result.Length; ++dst, src += 4)
+                    {
+                        result[dst] = new Color(HalfToFloat(values[src]), HalfToFloat(values[src + 1]),
+                            HalfToFloat(values[src + 2]), HalfToFloat(values[src + 3]));
+                    }
+                }
+
+                return result;
+            }
             else if (format == Format.R8_UInt)
             {
                 var tmp = GetData(res, subresource, size, 1);
@@ -252,6 +270,21 @@ namespace ImageFramework.DirectX
 
                 return result;
             }
+            else if (format == Format.R16G16B16A16_Float)
+            {
+                var tmp = GetData(res, subresource, size, 4 * 2);
+                var result = new byte[size.Product];
+                fixed (byte* pBuffer = tmp)
+                {
+                    for (int i = 0; i < result.Length; i++)
+                    {
+                        float alpha = HalfToFloat(((ushort*)pBuffer)[i * 4 + 3]);
+                        result[i] = (byte)Utility.Utility.Clamp(Math.Round(alpha * 255.0f), 0.0f, 255.0f);
+                    }
+                }
+
+                return result;
+            }
             else
             {
                 var tmp = GetData(res, subresource, size, 4);
@@ -265,6 +298,11 @@ namespace ImageFramework.DirectX
             }
         }
 
+        private static float HalfToFloat(ushort value)
+        {
+            return new Half { RawValue = value };
+        }
+
         public static readonly int DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION = 65535;
 
         public void Dispatch(int x, int y, int z = 1)
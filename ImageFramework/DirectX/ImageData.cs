@@ -37,5 +37,14 @@ namespace ImageFramework.DirectX
         public float Fps { get; }
 
         public abstract MipInfo GetMipmap(LayerMipmapSlice lm);
+
+        /// <summary>
+        /// keeps the pointers of GetMipmap valid until the result is disposed.
+        /// Returns null if they are always valid
+        /// </summary>
+        public virtual IDisposable PinMipmaps()
+        {
+            return null;
+        }
     }
 }
@@ -37,16 +37,20 @@ namespace ImageFramework.DirectX
 
             var data = new DataBox[LayerMipmap.Mipmaps];
 
-            for (int curMipmap = 0; curMipmap < LayerMipmap.Mipmaps; ++curMipmap)
+            // the pointers must stay valid until the upload is done
+            using (image.PinMipmaps())
             {
-                var mip = image.GetMipmap(new LayerMipmapSlice(layer, curMipmap));
-                var idx = curMipmap;
-                data[idx].DataPointer = mip.Bytes;
-                data[idx].SlicePitch = (int)(mip.ByteSize / (uint)mip.Size.Depth);
-                data[idx].RowPitch = data[idx].SlicePitch / mip.Size.Height;
-            }
+                for (int curMipmap = 0; curMipmap < LayerMipmap.Mipmaps; ++curMipmap)
+                {
+                    var mip = image.GetMipmap(new LayerMipmapSlice(layer, curMipmap));
+                    var idx = curMipmap;
+                    data[idx].DataPointer = mip.Bytes;
+                    data[idx].SlicePitch = (int)(mip.ByteSize / (uint)mip.Size.Depth);
+                    data[idx].RowPitch = data[idx].SlicePitch / mip.Size.Height;
+                }
 
-            handle = new SharpDX.Direct3D11.Texture3D(Device.Get().Handle, CreateTextureDescription(false,true), data);
+                handle = new SharpDX.Direct3D11.Texture3D(Device.Get().Handle, CreateTextureDescription(false,true), data);
+            }
             CreateTextureViews(false,true);
         }
 
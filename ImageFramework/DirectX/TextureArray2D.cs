@@ -37,16 +37,20 @@ namespace ImageFramework.DirectX
             Format = image.Format.DxgiFormat;
 
             var data = new DataRectangle[LayerMipmap.Layers * LayerMipmap.Mipmaps];
-            foreach (var lm in LayerMipmap.Range)
+            // the pointers must stay valid until the upload is done
+            using (image.PinMipmaps())
             {
-                var mip = image.GetMipmap(lm);
-                var idx = GetSubresourceIndex(lm);
-                data[idx].DataPointer = mip.Bytes;
-                // The distance (in bytes) from the beginning of one line of a texture to the next line.
-                data[idx].Pitch = (int)(mip.ByteSize / (uint)mip.Size.Height);
-            }
+                foreach (var lm in LayerMipmap.Range)
+                {
+                    var mip = image.GetMipmap(lm);
+                    var idx = GetSubresourceIndex(lm);
+                    data[idx].DataPointer = mip.Bytes;
+                    // The distance (in bytes) from the beginning of one line of a texture to the next line.
+                    data[idx].Pitch = (int)(mip.ByteSize / (uint)mip.Size.Height);
+                }
 
-            handle = new Texture2D(Device.Get().Handle, CreateTextureDescription(false, true), data);
+                handle = new Texture2D(Device.Get().Handle, CreateTextureDescription(false, true), data);
+            }
 
             CreateTextureViews(false, true);
         }
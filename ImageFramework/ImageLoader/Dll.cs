@@ -14,12 +14,53 @@ namespace ImageFramework.ImageLoader
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern int image_open(string filename);
 
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int image_open_ex(int op, string filename);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int image_open_memory(byte[] data, UIntPtr size, string formatHint);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int image_open_memory_ex(int op, byte[] data, UIntPtr size, string formatHint);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int image_open_region(string filename, int layer, int mipmap, int x, int y, int width, int height);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int image_open_region_ex(int op, string filename, int layer, int mipmap, int x, int y, int width, int height);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int image_open_batch(string[] filenames, int n, [Out] int[] outIds);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr get_batch_error(int index, out int length);
+
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern int image_allocate(uint format, int width, int height, int depth, int layer, int mipmap);
 
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern void image_release(int id);
 
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool image_pin(int id, bool pinned);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern ulong image_get_memory_usage();
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr image_get_stats(int id, out int length);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr get_loader_stats(out int length);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void trace_begin();
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool trace_end(string filename);
+
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern void image_info(int id, out uint format, out uint originalFormat,
             out int nLayer, out int nMipmaps);
@@ -27,6 +68,16 @@ namespace ImageFramework.ImageLoader
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern void image_info_mipmap(int id, int mipmap, out int width, out int height, out int depth);
 
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool image_probe(string filename, out uint originalFormat, out int width, out int height,
+            out int depth, out int nLayer, out int nMipmaps);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool image_probe_ex(int op, string filename, out uint originalFormat, out int width, out int height,
+            out int depth, out int nLayer, out int nMipmaps);
+
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr image_get_mipmap(int id, int layer, int mipmap, out ulong size);
 
@@ -37,6 +88,10 @@ namespace ImageFramework.ImageLoader
         [return: MarshalAs(UnmanagedType.I1)]
         public static extern bool image_save(int id, string filename, string extension, uint format, int quality, float fps);
 
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool image_save_ex(int op, int id, string filename, string extension, uint format, int quality, float fps);
+
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr get_export_formats(string extension, out int nFormats);
 
@@ -49,12 +104,34 @@ namespace ImageFramework.ImageLoader
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern void set_progress_callback([MarshalAs(UnmanagedType.FunctionPtr)] ProgressDelegate pDelegate);
 
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int operation_create();
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void operation_release(int op);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void operation_set_progress_callback(int op, [MarshalAs(UnmanagedType.FunctionPtr)] ProgressDelegate pDelegate);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void operation_cancel(int op);
+
+        // progress in [0, 1] or -1 if the operation is invalid. op = 0 for the functions without operation
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern float image_poll_progress(int op, out IntPtr description);
+
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr operation_get_error(int op, out int length);
+
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern void set_global_parameter_i(string name, int value);
 
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr npy_get_shape(string filename, out uint nDims);
 
+        [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr npy_get_shape_ex(int op, string filename, out uint nDims);
+
         [DllImport(DllFilePath, CallingConvention = CallingConvention.Cdecl)]
         public static extern int noise_generate_white(int width, int height, int depth, int layer, int mipmaps, int seed);
 
@@ -67,6 +144,31 @@ namespace ImageFramework.ImageLoader
             return ptr.Equals(IntPtr.Zero) ? "" : Marshal.PtrToStringAnsi(ptr, length);
         }
 
+        public static string GetOperationError(int op)
+        {
+            var ptr = operation_get_error(op, out var length);
+            return ptr.Equals(IntPtr.Zero) ? "" : Marshal.PtrToStringAnsi(ptr, length);
+        }
+
+        public static string GetBatchError(int index)
+        {
+            var ptr = get_batch_error(index, out var length);
+            return ptr.Equals(IntPtr.Zero) ? "" : Marshal.PtrToStringAnsi(ptr, length);
+        }
+
+        // json with the stats of the image or null if the id is invalid
+        public static string GetImageStats(int id)
+        {
+            var ptr = image_get_stats(id, out var length);
+            return ptr.Equals(IntPtr.Zero) ? null : Marshal.PtrToStringAnsi(ptr, length);
+        }
+
+        public static string GetLoaderStats()
+        {
+            var ptr = get_loader_stats(out var length);
+            return ptr.Equals(IntPtr.Zero) ? "" : Marshal.PtrToStringAnsi(ptr, length);
+        }
+
         [DllImport("kernel32.dll", EntryPoint = "CopyMemory", SetLastError = false)]
         public static extern void CopyMemory(IntPtr dest, IntPtr src, uint count);
 
@@ -27,10 +27,18 @@ namespace ImageFramework.ImageLoader
             Format.R8G8B8A8_UNorm_SRgb,
             Format.R8G8B8A8_UNorm,
             Format.R8G8B8A8_SNorm,
+            // opt-in half precision staging (see UseHalfStaging)
+            Format.R16G16B16A16_Float,
             // extra format for thumbnails
             Format.B8G8R8A8_UNorm_SRgb
         };
 
+        static IO()
+        {
+            // the dll does not write the DXIMAGELOADER_TRACE file on unload (no file io under the loader lock)
+            AppDomain.CurrentDomain.ProcessExit += (sender, args) => Dll.trace_end(null);
+        }
+
         /// <summary>
         /// tries to load the image file and returns a list with loaded images
         /// (one image file can contain multiple images with multiple faces with multiple mipmaps)
@@ -45,6 +53,101 @@ namespace ImageFramework.ImageLoader
             return new DllImageData(res, file, new LayerMipmapCount(nLayer, nMipmaps), new ImageFormat((GliFormat)gliFormat), (GliFormat)originalFormat);
         }
 
+        /// <summary>
+        /// loads the image file with the given operation. Can be used concurrently with other operations
+        /// </summary>
+        public static DllImageData LoadImage(string file, Operation op)
+        {
+            var res = new Resource(file, op);
+            Dll.image_info(res.Id, out var gliFormat, out var originalFormat, out var nLayer, out var nMipmaps);
+
+            return new DllImageData(res, file, new LayerMipmapCount(nLayer, nMipmaps), new ImageFormat((GliFormat)gliFormat), (GliFormat)originalFormat);
+        }
+
+        /// <summary>
+        /// decodes an image file that is already in memory (e.g. extracted from an archive)
+        /// </summary>
+        /// <param name="data">encoded file contents</param>
+        /// <param name="formatHint">file extension without dot. Only used if the format can not be detected from the data</param>
+        public static DllImageData LoadImage(byte[] data, string formatHint = null)
+        {
+            var res = new Resource(data, formatHint);
+            Dll.image_info(res.Id, out var gliFormat, out var originalFormat, out var nLayer, out var nMipmaps);
+
+            return new DllImageData(res, "memory", new LayerMipmapCount(nLayer, nMipmaps), new ImageFormat((GliFormat)gliFormat), (GliFormat)originalFormat);
+        }
+
+        /// <summary>
+        /// loads only a rectangle of one layer and mipmap of the image file (e.g. for pixel inspection of huge images)
+        /// </summary>
+        /// <param name="file">filename</param>
+        /// <param name="lm">layer and mipmap that contain the rectangle</param>
+        /// <param name="x">left pixel of the rectangle in the mipmap</param>
+        /// <param name="y">top pixel of the rectangle in the mipmap</param>
+        /// <returns>single layer and mipmap image with the size of the rectangle</returns>
+        public static DllImageData LoadImageRegion(string file, LayerMipmapSlice lm, int x, int y, int width, int height)
+        {
+            var res = Resource.OpenRegion(file, lm, x, y, width, height);
+            Dll.image_info(res.Id, out var gliFormat, out var originalFormat, out var nLayer, out var nMipmaps);
+
+            return new DllImageData(res, file, new LayerMipmapCount(nLayer, nMipmaps), new ImageFormat((GliFormat)gliFormat), (GliFormat)originalFormat);
+        }
+
+        /// <summary>
+        /// loads multiple image files concurrently
+        /// </summary>
+        public static DllImageData[] LoadImages(string[] files)
+        {
+            var resources = Resource.OpenBatch(files);
+            var res = new DllImageData[files.Length];
+            for (int i = 0; i < files.Length; ++i)
+            {
+                Dll.image_info(resources[i].Id, out var gliFormat, out var originalFormat, out var nLayer, out var nMipmaps);
+                res[i] = new DllImageData(resources[i], files[i], new LayerMipmapCount(nLayer, nMipmaps), new ImageFormat((GliFormat)gliFormat), (GliFormat)originalFormat);
+            }
+
+            return res;
+        }
+
+        public class ProbeInfo
+        {
+            public Size3 Size { get; set; }
+            public LayerMipmapCount LayerMipmap { get; set; }
+            public GliFormat OriginalFormat { get; set; }
+        }
+
+        /// <summary>
+        /// reads size, layer/mipmap count and format from the file header without loading the image data
+        /// </summary>
+        public static ProbeInfo ProbeImage(string file)
+        {
+            if (!Dll.image_probe(file, out var originalFormat, out var width, out var height, out var depth, out var nLayer, out var nMipmaps))
+                throw new Exception(Dll.GetError());
+
+            return new ProbeInfo
+            {
+                Size = new Size3(width, height, depth),
+                LayerMipmap = new LayerMipmapCount(nLayer, nMipmaps),
+                OriginalFormat = (GliFormat)originalFormat
+            };
+        }
+
+        /// <summary>
+        /// reads the file header with the given operation. Can be used concurrently with other operations
+        /// </summary>
+        public static ProbeInfo ProbeImage(string file, Operation op)
+        {
+            if (!Dll.image_probe_ex(op.Id, file, out var originalFormat, out var width, out var height, out var depth, out var nLayer, out var nMipmaps))
+                throw new Exception(op.Error);
+
+            return new ProbeInfo
+            {
+                Size = new Size3(width, height, depth),
+                LayerMipmap = new LayerMipmapCount(nLayer, nMipmaps),
+                OriginalFormat = (GliFormat)originalFormat
+            };
+        }
+
         public static DllImageData LoadWhiteNoise(Size3 size, LayerMipmapCount lm, int seed)
         {
             var res = Resource.CreateWhiteNoise(size, lm, seed);
@@ -128,6 +231,15 @@ namespace ImageFramework.ImageLoader
                 throw new Exception(Dll.GetError());
         }
 
+        /// <summary>
+        /// saves the image with the given operation. Can be used concurrently with other operations
+        /// </summary>
+        public static void SaveImage(DllImageData image, string filename, string extension, GliFormat format, Operation op, int quality = 0, float fps = 0.0f)
+        {
+            if (!Dll.image_save_ex(op.Id, image.Resource.Id, filename, extension, (uint)format, quality, fps))
+                throw new Exception(op.Error);
+        }
+
         public static List<GliFormat> GetExportFormats(string extension)
         {
             var ptr = Dll.get_export_formats(extension, out var nFormats);
@@ -149,6 +261,50 @@ namespace ImageFramework.ImageLoader
             Dll.set_global_parameter_i(name, value);
         }
 
+        /// <summary>
+        /// if true, images that would be loaded as RGBA32_SFLOAT are loaded as RGBA16_SFLOAT (half the memory, reduced precision)
+        /// </summary>
+        public static bool UseHalfStaging
+        {
+            set => Dll.set_global_parameter_i("staging half", value ? 1 : 0);
+        }
+
+        /// <summary>
+        /// memory budget for all loaded images in MB (0 = unlimited). Least recently used images are
+        /// moved to a compressed scratch file if the budget is exceeded
+        /// </summary>
+        public static int MemoryBudget
+        {
+            set => Dll.set_global_parameter_i("memory budget", value);
+        }
+
+        /// <summary>
+        /// bytes that are currently held in memory by all loaded images
+        /// </summary>
+        public static ulong MemoryUsage => Dll.image_get_memory_usage();
+
+        /// <summary>
+        /// json with time and data per stage of all imports and exports (see get_loader_stats in interface.h)
+        /// </summary>
+        public static string LoaderStats => Dll.GetLoaderStats();
+
+        /// <summary>
+        /// starts recording a timeline of the loaders and exporters (see trace_begin in interface.h)
+        /// </summary>
+        public static void BeginTrace()
+        {
+            Dll.trace_begin();
+        }
+
+        /// <summary>
+        /// stops recording and writes the timeline as chrome trace json (open with ui.perfetto.dev)
+        /// </summary>
+        public static void EndTrace(string filename)
+        {
+            if (!Dll.trace_end(filename))
+                throw new Exception(Dll.GetError());
+        }
+
         /// <summary>
         /// returns the shape of a numpy array
         /// </summary>
@@ -164,5 +320,19 @@ namespace ImageFramework.ImageLoader
             Marshal.Copy(ptr, res, 0, (int)nDims);
             return res;
         }
+
+        /// <summary>
+        /// returns the shape of a numpy array. Can be used concurrently with other operations
+        /// </summary>
+        public static int[] NpyGetShape(string filename, Operation op)
+        {
+            var ptr = Dll.npy_get_shape_ex(op.Id, filename, out var nDims);
+            if (ptr == IntPtr.Zero)
+                throw new Exception(op.Error);
+
+            var res = new int[nDims];
+            Marshal.Copy(ptr, res, 0, (int)nDims);
+            return res;
+        }
     }
 }
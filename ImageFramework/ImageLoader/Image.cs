@@ -49,10 +49,20 @@ namespace ImageFramework.ImageLoader
 #endif
 
             res.Bytes = Dll.image_get_mipmap(Resource.Id, lm.Layer, lm.Mipmap, out res.ByteSize);
+            if (res.Bytes == IntPtr.Zero)
+                throw new Exception("error reading mipmap: " + Dll.GetError());
 
             return res;
         }
 
+        /// <summary>
+        /// the dll may spill the image to a scratch file if the memory budget is exceeded (see IO.MemoryBudget)
+        /// </summary>
+        public override IDisposable PinMipmaps()
+        {
+            return Resource.PinScope();
+        }
+
         public void Dispose()
         {
             Resource.Dispose();
@@ -23,6 +23,10 @@ namespace ImageFramework.ImageLoader
                     DxgiFormat = Format.R32G32B32A32_Float;
                     PixelSize = 4 * 4;
                     break;
+                case GliFormat.RGBA16_SFLOAT:
+                    DxgiFormat = Format.R16G16B16A16_Float;
+                    PixelSize = 4 * 2;
+                    break;
                 case GliFormat.RGBA8_SRGB:
                     DxgiFormat = Format.R8G8B8A8_UNorm_SRgb;
                     PixelSize = 4;
@@ -54,6 +58,10 @@ namespace ImageFramework.ImageLoader
                     GliFormat = GliFormat.RGBA32_SFLOAT;
                     PixelSize = 4 * 4;
                     break;
+                case Format.R16G16B16A16_Float:
+                    GliFormat = GliFormat.RGBA16_SFLOAT;
+                    PixelSize = 4 * 2;
+                    break;
                 case Format.R8G8B8A8_UNorm_SRgb:
                     GliFormat = GliFormat.RGBA8_SRGB;
                     PixelSize = 4;
@@ -0,0 +1,68 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+using ImageFramework.Model.Progress;
+
+namespace ImageFramework.ImageLoader
+{
+    /// <summary>
+    /// operation context of the image loader. Has its own error and progress.
+    /// Imports and exports that use different operations can run concurrently
+    /// </summary>
+    public class Operation : IDisposable
+    {
+        public int Id { get; private set; }
+
+        public Operation()
+        {
+            Id = Dll.operation_create();
+        }
+
+        /// <summary>
+        /// progress of the running import or export in [0, 1]
+        /// </summary>
+        public float Progress => Math.Max(Dll.image_poll_progress(Id, out _), 0.0f);
+
+        /// <summary>
+        /// description of the current step of the running import or export
+        /// </summary>
+        public string What
+        {
+            get
+            {
+                Dll.image_poll_progress(Id, out var description);
+                return description.Equals(IntPtr.Zero) ? "" : Marshal.PtrToStringAnsi(description);
+            }
+        }
+
+        /// <summary>
+        /// error of the last import or export that used this operation
+        /// </summary>
+        public string Error => Dll.GetOperationError(Id);
+
+        /// <summary>
+        /// aborts the running import or export. The operation cannot be used afterwards
+        /// </summary>
+        public void Cancel()
+        {
+            Dll.operation_cancel(Id);
+        }
+
+        ~Operation()
+        {
+            Dispose();
+        }
+
+        public void Dispose()
+        {
+            if (Id != 0)
+            {
+                Dll.operation_release(Id);
+                Id = 0;
+            }
+        }
+    }
+}
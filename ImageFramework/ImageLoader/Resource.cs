@@ -18,11 +18,75 @@ namespace ImageFramework.ImageLoader
                 throw new Exception("error in " + file + ": " + Dll.GetError());
         }
 
+        /// <summary>
+        /// opens the file with the given operation. Can be used concurrently with other operations
+        /// </summary>
+        public Resource(string file, Operation op)
+        {
+            Id = Dll.image_open_ex(op.Id, file);
+            if (Id == 0)
+                throw new Exception("error in " + file + ": " + op.Error);
+        }
+
+        /// <summary>
+        /// decodes an image file that is already in memory
+        /// </summary>
+        /// <param name="data">encoded file contents</param>
+        /// <param name="formatHint">file extension without dot. Only used if the format can not be detected from the data. May be null</param>
+        public Resource(byte[] data, string formatHint)
+        {
+            Id = Dll.image_open_memory(data, new UIntPtr((ulong)data.LongLength), formatHint);
+            if (Id == 0)
+                throw new Exception("error in memory image: " + Dll.GetError());
+        }
+
+        /// <summary>
+        /// decodes an image file that is already in memory with the given operation. Can be used concurrently with other operations
+        /// </summary>
+        public Resource(byte[] data, string formatHint, Operation op)
+        {
+            Id = Dll.image_open_memory_ex(op.Id, data, new UIntPtr((ulong)data.LongLength), formatHint);
+            if (Id == 0)
+                throw new Exception("error in memory image: " + op.Error);
+        }
+
         private Resource()
         {
             Id = 0;
         }
 
+        /// <summary>
+        /// opens only a rectangle of one layer and mipmap. The resource has a single layer and mipmap with the size of the rectangle
+        /// </summary>
+        public static Resource OpenRegion(string file, LayerMipmapSlice lm, int x, int y, int width, int height)
+        {
+            var res = new Resource();
+            res.Id = Dll.image_open_region(file, lm.Layer, lm.Mipmap, x, y, width, height);
+            if (res.Id == 0)
+                throw new Exception("error in " + file + ": " + Dll.GetError());
+            return res;
+        }
+
+        /// <summary>
+        /// opens all files concurrently. Throws if one of the files could not be opened
+        /// </summary>
+        public static Resource[] OpenBatch(string[] files)
+        {
+            var ids = new int[files.Length];
+            Dll.image_open_batch(files, files.Length, ids);
+
+            var res = ids.Select(id => new Resource { Id = id }).ToArray();
+            var failed = Array.FindIndex(ids, id => id == 0);
+            if (failed >= 0)
+            {
+                var error = "error in " + files[failed] + ": " + Dll.GetBatchError(failed);
+                foreach (var r in res) r.Dispose();
+                throw new Exception(error);
+            }
+
+            return res;
+        }
+
         public static Resource CreateWhiteNoise(Size3 size, LayerMipmapCount lm, int seed)
         {
             var res = new Resource();
@@ -48,6 +112,51 @@ namespace ImageFramework.ImageLoader
                 throw new Exception("error allocating image: " + Dll.GetError());
         }
 
+        /// <summary>
+        /// pinned resources stay in memory if the memory budget is exceeded (see IO.MemoryBudget)
+        /// </summary>
+        public void Pin(bool pinned)
+        {
+            if (!Dll.image_pin(Id, pinned))
+                throw new Exception("error pinning image: " + Dll.GetError());
+        }
+
+        /// <summary>
+        /// pins the resource until the result is disposed. Pins nest (see image_pin in interface.h)
+        /// </summary>
+        public IDisposable PinScope()
+        {
+            Pin(true);
+            return new Unpin(this);
+        }
+
+        private class Unpin : IDisposable
+        {
+            private Resource resource;
+
+            public Unpin(Resource resource)
+            {
+                this.resource = resource;
+            }
+
+            public void Dispose()
+            {
+                resource?.Pin(false);
+                resource = null;
+            }
+        }
+
+        /// <summary>
+        /// json with time and data per stage of the import and the exports of this resource (see image_get_stats in interface.h)
+        /// </summary>
+        public string GetStats()
+        {
+            var stats = Dll.GetImageStats(Id);
+            if (stats == null)
+                throw new Exception("error getting stats: " + Dll.GetError());
+            return stats;
+        }
+
         ~Resource()
         {
             Dispose();
@@ -94,11 +94,14 @@ namespace ImageFramework.Model.Export
             var img = IO.CreateImage(desc.StagingFormat, texture.Size.GetMip(lm.FirstMipmap), new LayerMipmapCount(nLayer, nMipmaps));
             
             // fill with data
-            foreach (var dstLm in img.LayerMipmap.Range)
+            using (img.PinMipmaps())
             {
-                var mip = img.GetMipmap(dstLm);
-                // transfer image data
-                texture.CopyPixels(new LayerMipmapSlice( lm.FirstLayer + dstLm.Layer, lm.FirstMipmap + dstLm.Mipmap), mip.Bytes, (uint)mip.ByteSize);
+                foreach (var dstLm in img.LayerMipmap.Range)
+                {
+                    var mip = img.GetMipmap(dstLm);
+                    // transfer image data
+                    texture.CopyPixels(new LayerMipmapSlice( lm.FirstLayer + dstLm.Layer, lm.FirstMipmap + dstLm.Mipmap), mip.Bytes, (uint)mip.ByteSize);
+                }
             }
 
             return Task.Run(() =>
@@ -141,15 +141,15 @@ namespace ImageFramework.Model
                                         Colors.White, cfg.Label2, TextAlignment.Trailing);
                             }
 
-                            // copy frame from gpu to cpu
-                            var dstMip = images[idx].GetMipmap(LayerMipmapSlice.Mip0);
-                            var dstPtr = dstMip.Bytes;
-                            var dstSize = dstMip.ByteSize;
-
                             // wait for previous task to finish before writing it to the file
                             if (tasks[idx] != null) await tasks[idx];
 
-                            frame.CopyPixels(LayerMipmapSlice.Mip0, dstPtr, (uint)dstSize);
+                            // copy frame from gpu to cpu
+                            using (images[idx].PinMipmaps())
+                            {
+                                var dstMip = images[idx].GetMipmap(LayerMipmapSlice.Mip0);
+                                frame.CopyPixels(LayerMipmapSlice.Mip0, dstMip.Bytes, (uint)dstMip.ByteSize);
+                            }
                             var filename = $"{cfg.TmpDirectory}\\frame{i:D4}";
 
                             // write to file
@@ -47,7 +47,7 @@ namespace ImageFramework.Model
             public ITexture Image { get; private set; }
             public int NumMipmaps => Image.NumMipmaps;
             public int NumLayers => Image.NumLayers;
-            public bool IsHdr => Image.Format == Format.R32G32B32A32_Float;
+            public bool IsHdr => Image.Format == Format.R32G32B32A32_Float || Image.Format == Format.R16G16B16A16_Float;
             public string Filename { get; }
             // name that will be displayed
             public string Alias { get; internal set; }
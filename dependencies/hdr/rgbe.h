@@ -45,7 +45,7 @@
 
 #include <sstream>
 #include <stdio.h>
-#include "interface.h"
+#include "operation_context.h"
 
 typedef struct {
     int valid;            /* indicate which fields are valid */
@@ -67,22 +67,32 @@ typedef struct {
 #define RGBE_RETURN_SUCCESS 0
 #define RGBE_RETURN_FAILURE -1
 
+/* input for the read routines. The file is read into memory by the caller */
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    size_t pos; /* current read position */
+} rgbe_input;
+
 /* read or write headers */
 /* you may set rgbe_header_info to null if you want to */
 void RGBE_WriteHeader(FILE* fp, int width, int height, rgbe_header_info* info);
-void RGBE_ReadHeader(FILE* fp, int* width, int* height, rgbe_header_info* info);
+void RGBE_ReadHeader(rgbe_input* in, int* width, int* height, rgbe_header_info* info);
 
 /* read or write pixels */
 /* can read or write pixels in chunks of any size including single pixels*/
-void RGBE_WritePixels(FILE* fp, float* data, int numpixels);
-void RGBE_ReadPixels(FILE* fp, float* data, int numpixels);
+void RGBE_WritePixels(FILE* fp, float* data, int numpixels, OperationContext& ctx);
+void RGBE_ReadPixels(rgbe_input* in, float* data, int numpixels, OperationContext& ctx);
 
 /* read or write run length encoded files */
 /* must be called to read or write whole scanlines */
 void RGBE_WritePixels_RLE(FILE* fp, float* data, int scanline_width,
-    int num_scanlines);
-void RGBE_ReadPixels_RLE(FILE* fp, float* data, int scanline_width,
-    int num_scanlines);
+    int num_scanlines, OperationContext& ctx);
+void RGBE_ReadPixels_RLE(rgbe_input* in, float* data, int scanline_width,
+    int num_scanlines, OperationContext& ctx);
+/* reads a rectangular region of a whole image, see definition below */
+void RGBE_ReadPixels_RLE_Region(rgbe_input* in, float* data, int scanline_width, int first_scanline,
+    int num_scanlines, int x, int width, OperationContext& ctx);
 
 
 
@@ -204,6 +214,31 @@ rgbe2float(float* red, float* green, float* blue, unsigned char rgbe[4])
         *red = *green = *blue = 0.0;
 }
 
+/* fgets replacement for rgbe_input. Returns NULL if no character was read */
+static char* rgbe_gets(char* buf, int size, rgbe_input* in)
+{
+    if (in->pos >= in->size || size <= 0)
+        return NULL;
+    int i = 0;
+    while (i < size - 1 && in->pos < in->size) {
+        char c = static_cast<char>(in->data[in->pos++]);
+        buf[i++] = c;
+        if (c == '\n') break;
+    }
+    buf[i] = 0;
+    return buf;
+}
+
+/* fread replacement for rgbe_input. Returns false if less than size bytes are available */
+static bool rgbe_read(void* dst, size_t size, rgbe_input* in)
+{
+    if (in->size - in->pos < size)
+        return false;
+    memcpy(dst, in->data + in->pos, size);
+    in->pos += size;
+    return true;
+}
+
 /* default minimal header. modify if you want more information in header */
 void RGBE_WriteHeader(FILE* fp, int width, int height, rgbe_header_info* info)
 {
@@ -229,7 +264,7 @@ void RGBE_WriteHeader(FILE* fp, int width, int height, rgbe_header_info* info)
 }
 
 /* minimal header reading.  modify if you want to parse more information */
-void RGBE_ReadHeader(FILE* fp, int* width, int* height, rgbe_header_info* info)
+void RGBE_ReadHeader(rgbe_input* in, int* width, int* height, rgbe_header_info* info)
 {
     char buf[128];
     float tempf;
@@ -240,7 +275,7 @@ void RGBE_ReadHeader(FILE* fp, int* width, int* height, rgbe_header_info* info)
         info->programtype[0] = 0;
         info->gamma = info->exposure = 1.0;
     }
-    if (fgets(buf, sizeof(buf) / sizeof(buf[0]), fp) == NULL)
+    if (rgbe_gets(buf, sizeof(buf) / sizeof(buf[0]), in) == NULL)
         throw rgbe_error(rgbe_read_error, NULL);
     if ((buf[0] != '#') || (buf[1] != '?')) {
         /* if you want to require the magic token then uncomment the next line */
@@ -254,7 +289,7 @@ void RGBE_ReadHeader(FILE* fp, int* width, int* height, rgbe_header_info* info)
             info->programtype[i] = buf[i + 2];
         }
         info->programtype[i] = 0;
-        if (fgets(buf, sizeof(buf) / sizeof(buf[0]), fp) == 0)
+        if (rgbe_gets(buf, sizeof(buf) / sizeof(buf[0]), in) == 0)
             throw rgbe_error(rgbe_read_error, NULL);
     }
 
@@ -277,15 +312,15 @@ void RGBE_ReadHeader(FILE* fp, int* width, int* height, rgbe_header_info* info)
             info->exposure = tempf;
             info->valid |= RGBE_VALID_EXPOSURE;
         }
-        if (fgets(buf, sizeof(buf) / sizeof(buf[0]), fp) == 0)
+        if (rgbe_gets(buf, sizeof(buf) / sizeof(buf[0]), in) == 0)
             throw rgbe_error(rgbe_read_error, NULL);
     }
-    //if (fgets(buf, sizeof(buf) / sizeof(buf[0]), fp) == 0)
+    //if (rgbe_gets(buf, sizeof(buf) / sizeof(buf[0]), in) == 0)
     //    throw rgbe_error(rgbe_read_error, NULL);
     //if (strcmp(buf, "\n") != 0)
     //    throw rgbe_error(rgbe_format_error,
     //        "missing blank line after FORMAT specifier");
-    if (fgets(buf, sizeof(buf) / sizeof(buf[0]), fp) == 0)
+    if (rgbe_gets(buf, sizeof(buf) / sizeof(buf[0]), in) == 0)
         throw rgbe_error(rgbe_read_error, NULL);
     if (sscanf(buf, "-Y %d +X %d", height, width) < 2)
         throw rgbe_error(rgbe_format_error, "missing image size specifier");
@@ -294,7 +329,7 @@ void RGBE_ReadHeader(FILE* fp, int* width, int* height, rgbe_header_info* info)
 /* simple write routine that does not use run length encoding */
 /* These routines can be made faster by allocating a larger buffer and
    fread-ing and fwrite-ing the data in larger chunks */
-void RGBE_WritePixels(FILE* fp, float* data, int numpixels)
+void RGBE_WritePixels(FILE* fp, float* data, int numpixels, OperationContext& ctx)
 {
     unsigned char rgbe[4];
 
@@ -306,24 +341,24 @@ void RGBE_WritePixels(FILE* fp, float* data, int numpixels)
         if (fwrite(rgbe, sizeof(rgbe), 1, fp) < 1)
             throw rgbe_error(rgbe_write_error, NULL);
 
-        if (numpixels % 1000 == 0) set_progress(((maxPixels - numpixels) * 100) / maxPixels);
+        if (numpixels % 1000 == 0) ctx.setProgress(((maxPixels - numpixels) * 100) / maxPixels);
     }
 }
 
 /* simple read routine.  will not correctly handle run length encoding */
-void RGBE_ReadPixels(FILE* fp, float* data, int numpixels)
+void RGBE_ReadPixels(rgbe_input* in, float* data, int numpixels, OperationContext& ctx)
 {
     unsigned char rgbe[4];
 
     auto maxPixels = numpixels;
     while (numpixels-- > 0) {
-        if (fread(rgbe, sizeof(rgbe), 1, fp) < 1)
+        if (!rgbe_read(rgbe, sizeof(rgbe), in))
             throw rgbe_error(rgbe_read_error, NULL);
         rgbe2float(&data[RGBE_DATA_RED], &data[RGBE_DATA_GREEN],
             &data[RGBE_DATA_BLUE], rgbe);
         data += RGBE_DATA_SIZE;
 
-        if(numpixels % 1000 == 0) set_progress(((maxPixels - numpixels) * 100) / maxPixels);
+        if(numpixels % 1000 == 0) ctx.setProgress(((maxPixels - numpixels) * 100) / maxPixels);
     }
 }
 
@@ -332,13 +367,13 @@ void RGBE_ReadPixels(FILE* fp, float* data, int numpixels)
 /* save some space.  For each scanline, each channel (r,g,b,e) is */
 /* encoded separately for better compression. */
 
-static void RGBE_WriteBytes_RLE(FILE* fp, unsigned char* data, int numbytes)
+static void RGBE_WriteBytes_RLE(FILE* fp, unsigned char* data, int numbytes, OperationContext& ctx)
 {
 #define MINRUNLENGTH 4
     int cur, beg_run, run_count, old_run_count, nonrun_count;
     unsigned char buf[2];
 
-    set_progress(0);
+    ctx.setProgress(0);
 
     cur = 0;
     while (cur < numbytes) {
@@ -382,27 +417,27 @@ static void RGBE_WriteBytes_RLE(FILE* fp, unsigned char* data, int numbytes)
             cur += run_count;
         }
 
-        set_progress((cur * 100) / numbytes);
+        ctx.setProgress((cur * 100) / numbytes);
     }
 #undef MINRUNLENGTH
 }
 
 void RGBE_WritePixels_RLE(FILE* fp, float* data, int scanline_width,
-    int num_scanlines)
+    int num_scanlines, OperationContext& ctx)
 {
     unsigned char rgbe[4];
     std::unique_ptr<unsigned char[]> buffer;
     int i;
 
-    set_progress(0);
+    ctx.setProgress(0);
 
     if ((scanline_width < 8) || (scanline_width > 0x7fff))
         /* run length encoding is not allowed so write flat*/
-        return RGBE_WritePixels(fp, data, scanline_width * num_scanlines);
+        return RGBE_WritePixels(fp, data, scanline_width * num_scanlines, ctx);
     buffer.reset(new unsigned char[4 * scanline_width]);
     if (buffer == NULL)
         /* no buffer space so write flat */
-        return RGBE_WritePixels(fp, data, scanline_width * num_scanlines);
+        return RGBE_WritePixels(fp, data, scanline_width * num_scanlines, ctx);
     while (num_scanlines-- > 0) {
         rgbe[0] = 2;
         rgbe[1] = 2;
@@ -423,24 +458,72 @@ void RGBE_WritePixels_RLE(FILE* fp, float* data, int scanline_width,
         /* write out each of the four channels separately run length encoded */
         /* first red, then green, then blue, then exponent */
         for (i = 0; i < 4; i++) {
-            RGBE_WriteBytes_RLE(fp, &buffer[i * scanline_width], scanline_width);
+            RGBE_WriteBytes_RLE(fp, &buffer[i * scanline_width], scanline_width, ctx);
         }
     }
 }
 
-void RGBE_ReadPixels_RLE(FILE* fp, float* data, int scanline_width,
-    int num_scanlines)
+/* reads the run length encoded channels of one scanline into scanline_buffer (4 * scanline_width bytes).
+   The scanline header was already read */
+static void rgbe_read_scanline_rle(rgbe_input* in, unsigned char* scanline_buffer, int scanline_width)
 {
-    unsigned char rgbe[4], * ptr, * ptr_end;
+    unsigned char* ptr, * ptr_end;
     int i, count;
     unsigned char buf[2];
 
-    set_progress(0);
+    ptr = &scanline_buffer[0];
+    /* read each of the four channels for the scanline into the buffer */
+    for (i = 0; i < 4; i++) {
+        ptr_end = &scanline_buffer[(i + 1) * scanline_width];
+        while (ptr < ptr_end) {
+            if (!rgbe_read(buf, sizeof(buf[0]) * 2, in)) {
+                throw rgbe_error(rgbe_read_error, NULL);
+            }
+            if (buf[0] > 128) {
+                /* a run of the same value */
+                count = buf[0] - 128;
+                if ((count == 0) || (count > ptr_end - ptr)) {
+                    throw rgbe_error(rgbe_format_error, "bad scanline data");
+                }
+                while (count-- > 0)
+                    *ptr++ = buf[1];
+            }
+            else {
+                /* a non-run */
+                count = buf[0];
+                if ((count == 0) || (count > ptr_end - ptr)) {
+                    throw rgbe_error(rgbe_format_error, "bad scanline data");
+                }
+                *ptr++ = buf[1];
+                if (--count > 0) {
+                    if (!rgbe_read(ptr, sizeof(*ptr) * count, in)) {
+                        throw rgbe_error(rgbe_read_error, NULL);
+                    }
+                    ptr += count;
+                }
+            }
+        }
+    }
+}
+
+/* returns true if rgbe is the header of a run length encoded scanline */
+static bool rgbe_is_rle_header(const unsigned char rgbe[4])
+{
+    return (rgbe[0] == 2) && (rgbe[1] == 2) && !(rgbe[2] & 0x80);
+}
+
+void RGBE_ReadPixels_RLE(rgbe_input* in, float* data, int scanline_width,
+    int num_scanlines, OperationContext& ctx)
+{
+    unsigned char rgbe[4];
+    int i;
+
+    ctx.setProgress(0);
 
     if ((scanline_width < 8) || (scanline_width > 0x7fff))
     {
         /* run length encoding is not allowed so read flat*/
-        RGBE_ReadPixels(fp, data, scanline_width * num_scanlines);
+        RGBE_ReadPixels(in, data, scanline_width * num_scanlines, ctx);
         return;
     }
 
@@ -449,15 +532,15 @@ void RGBE_ReadPixels_RLE(FILE* fp, float* data, int scanline_width,
     auto maxScanlines = num_scanlines;
     /* read in each successive scanline */
     while (num_scanlines > 0) {
-        if (fread(rgbe, sizeof(rgbe), 1, fp) < 1) {
+        if (!rgbe_read(rgbe, sizeof(rgbe), in)) {
             throw rgbe_error(rgbe_read_error, NULL);
         }
-        if ((rgbe[0] != 2) || (rgbe[1] != 2) || (rgbe[2] & 0x80)) {
+        if (!rgbe_is_rle_header(rgbe)) {
             /* this file is not run length encoded */
             rgbe2float(&data[RGBE_DATA_RED], &data[RGBE_DATA_GREEN], &data[RGBE_DATA_BLUE], rgbe);
             data += RGBE_DATA_SIZE;
             scanline_buffer.reset();
-            RGBE_ReadPixels(fp, data, scanline_width * num_scanlines - 1);
+            RGBE_ReadPixels(in, data, scanline_width * num_scanlines - 1, ctx);
             return;
         }
         if ((((int)rgbe[2]) << 8 | rgbe[3]) != scanline_width) {
@@ -468,39 +551,8 @@ void RGBE_ReadPixels_RLE(FILE* fp, float* data, int scanline_width,
         if (scanline_buffer == NULL)
             throw rgbe_error(rgbe_memory_error, "unable to allocate buffer space");
 
-        ptr = &scanline_buffer[0];
-        /* read each of the four channels for the scanline into the buffer */
-        for (i = 0; i < 4; i++) {
-            ptr_end = &scanline_buffer[(i + 1) * scanline_width];
-            while (ptr < ptr_end) {
-                if (fread(buf, sizeof(buf[0]) * 2, 1, fp) < 1) {
-                    throw rgbe_error(rgbe_read_error, NULL);
-                }
-                if (buf[0] > 128) {
-                    /* a run of the same value */
-                    count = buf[0] - 128;
-                    if ((count == 0) || (count > ptr_end - ptr)) {
-                        throw rgbe_error(rgbe_format_error, "bad scanline data");
-                    }
-                    while (count-- > 0)
-                        *ptr++ = buf[1];
-                }
-                else {
-                    /* a non-run */
-                    count = buf[0];
-                    if ((count == 0) || (count > ptr_end - ptr)) {
-                        throw rgbe_error(rgbe_format_error, "bad scanline data");
-                    }
-                    *ptr++ = buf[1];
-                    if (--count > 0) {
-                        if (fread(ptr, sizeof(*ptr) * count, 1, fp) < 1) {
-                            throw rgbe_error(rgbe_read_error, NULL);
-                        }
-                        ptr += count;
-                    }
-                }
-            }
-        }
+        rgbe_read_scanline_rle(in, &scanline_buffer[0], scanline_width);
+
         /* now convert data from buffer into floats */
         for (i = 0; i < scanline_width; i++) {
             rgbe[0] = scanline_buffer[i];
@@ -513,6 +565,75 @@ void RGBE_ReadPixels_RLE(FILE* fp, float* data, int scanline_width,
         }
         num_scanlines--;
 
-        set_progress(((maxScanlines - num_scanlines) * 100) / maxScanlines);
+        ctx.setProgress(((maxScanlines - num_scanlines) * 100) / maxScanlines);
+    }
+}
+
+/* reads the pixels [x, x + width) of the scanlines [first_scanline, first_scanline + num_scanlines).
+   Run length encoded scanlines above the region are decoded and discarded, flat scanlines are skipped.
+   Scanlines below the region are not read */
+void RGBE_ReadPixels_RLE_Region(rgbe_input* in, float* data, int scanline_width, int first_scanline,
+    int num_scanlines, int x, int width, OperationContext& ctx)
+{
+    unsigned char rgbe[4];
+    int i;
+    const int end_scanline = first_scanline + num_scanlines;
+
+    ctx.setProgress(0);
+
+    /* run length encoding is not allowed for these widths */
+    bool flat = (scanline_width < 8) || (scanline_width > 0x7fff);
+    std::unique_ptr<unsigned char[]> scanline_buffer;
+
+    for (int y = 0; y < end_scanline; ++y) {
+        if (!flat) {
+            if (!rgbe_read(rgbe, sizeof(rgbe), in)) {
+                throw rgbe_error(rgbe_read_error, NULL);
+            }
+            if (!rgbe_is_rle_header(rgbe)) {
+                /* this file is not run length encoded. rgbe was the first pixel of the scanline */
+                in->pos -= sizeof(rgbe);
+                flat = true;
+            }
+        }
+
+        if (flat) {
+            /* flat pixels can be addressed directly */
+            const size_t start = in->pos;
+            for (int row = y > first_scanline ? y : first_scanline; row < end_scanline; ++row) {
+                in->pos = start + (size_t(row - y) * scanline_width + x) * sizeof(rgbe);
+                float* dst = data + size_t(row - first_scanline) * width * RGBE_DATA_SIZE;
+                for (i = 0; i < width; i++) {
+                    if (!rgbe_read(rgbe, sizeof(rgbe), in))
+                        throw rgbe_error(rgbe_read_error, NULL);
+                    rgbe2float(&dst[RGBE_DATA_RED], &dst[RGBE_DATA_GREEN], &dst[RGBE_DATA_BLUE], rgbe);
+                    dst += RGBE_DATA_SIZE;
+                }
+                ctx.setProgress(((row + 1) * 100) / end_scanline);
+            }
+            return;
+        }
+
+        if ((((int)rgbe[2]) << 8 | rgbe[3]) != scanline_width) {
+            throw rgbe_error(rgbe_format_error, "wrong scanline width");
+        }
+        if (scanline_buffer == NULL)
+            scanline_buffer.reset(new unsigned char[4 * scanline_width]);
+
+        rgbe_read_scanline_rle(in, &scanline_buffer[0], scanline_width);
+
+        if (y >= first_scanline) {
+            float* dst = data + size_t(y - first_scanline) * width * RGBE_DATA_SIZE;
+            for (i = x; i < x + width; i++) {
+                rgbe[0] = scanline_buffer[i];
+                rgbe[1] = scanline_buffer[i + scanline_width];
+                rgbe[2] = scanline_buffer[i + 2 * scanline_width];
+                rgbe[3] = scanline_buffer[i + 3 * scanline_width];
+                rgbe2float(&dst[RGBE_DATA_RED], &dst[RGBE_DATA_GREEN], &dst[RGBE_DATA_BLUE], rgbe);
+                dst += RGBE_DATA_SIZE;
+            }
+        }
+
+        ctx.setProgress(((y + 1) * 100) / end_scanline);
     }
 }
\ No newline at end of file